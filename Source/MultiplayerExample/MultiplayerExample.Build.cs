@@ -15,9 +15,10 @@ public class MultiplayerExample : ModuleRules
                 "InputCore",
                 "Json",
                 "JsonUtilities",
+                "NetCore",
                 "OnlineSubsystemUtils",
 				"GameplayTags"
             });
-        PrivateDependencyModuleNames.AddRange(new string[] { "HTTP", "UMG" });
+        PrivateDependencyModuleNames.AddRange(new string[] { "HTTP", "HTTPServer", "ReplicationGraph", "SignificanceManager", "Sockets", "UMG" });
     }
 }
@@ -59,17 +59,8 @@ void UAsync_DeleteCharacter::Activate()
 			
 			if (UHttpAPI::ValidateResponse(Response))
 			{
-				TArray<FCharacterData> CachedCharacterList = GI->GetCharacterList();
-				for (int32 i = 0; i < CachedCharacterList.Num(); i++)
-				{
-					if (CachedCharacterList[i].ID == DeleteCharacterRequest.id)
-					{
-						CachedCharacterList.RemoveAt(i);
-					}
-				}
-
-				GI->UpdateCharacterList(CachedCharacterList);
-				OnComplete(true, CachedCharacterList);
+				GI->RemoveCharacter(DeleteCharacterRequest.id);
+				OnComplete(true, GI->GetCharacterList());
 			}
 			else
 			{
@@ -69,8 +69,9 @@ void UAsync_GetCharacter::Activate()
 				}
 
 				UE_LOG(LogTemp, Error, TEXT("Failed to create a CharacterData struct from the json received from GetCharacter"));
-				OnComplete({});
 			}
+
+			OnComplete({});
 		});
 	}
 #else
@@ -24,9 +24,7 @@
 
 #include "Async/Async_GetCharacters.h"
 
-#include "Core/HttpApi.h"
 #include "Core/MGameInstance.h"
-#include "Interfaces/IHttpResponse.h"
 #include "UserInterface/HUDs/MLoginHUD.h"
 
 UAsync_GetCharacters* UAsync_GetCharacters::WaitGetCharacters(ALoginController* InCaller)
@@ -41,55 +39,45 @@ void UAsync_GetCharacters::Activate()
 #if !UE_SERVER
 	if (Caller->IsLocalController())
 	{
-		if (UHttpAPI* API = Caller->GetGameInstance()->GetSubsystem<UHttpAPI>())
+		UMGameInstance* GI = Caller->GetGameInstance<UMGameInstance>();
+
+		// The login success path already pipelined the request, use its result if it landed during the map load
+		bool bPrefetchSuccessful = false;
+		if (GI->ConsumePrefetchedCharacterList(bPrefetchSuccessful))
 		{
-			URequest* Request = API->CreateNewRequest(TEXT("getAllCharacters"));
-			API->SetHeaders(Request);
-			API->SetAuthHeader(Request, Caller->GetGameInstance<UMGameInstance>()->GetToken().IdToken);
-			API->GET(Request);
+			OnCharacterListFetched(bPrefetchSuccessful);
+			return;
+		}
+
+		GI->OnCharacterListFetched.AddUObject(this, &ThisClass::OnCharacterListFetched);
+		GI->FetchCharacterList();
+	}
+#endif
+}
 
-			if (Caller->GetGameInstance<UMGameInstance>()->IsDebugMode())
-			{
-				UHttpAPI::DebugRequest(Request);
-			}
+void UAsync_GetCharacters::OnCharacterListFetched(const bool bSuccessful)
+{
+	UMGameInstance* GI = Caller->GetGameInstance<UMGameInstance>();
+	GI->OnCharacterListFetched.RemoveAll(this);
 
-			UHttpAPI::BindLambdaResponse(Request, [&](FHttpRequestPtr, FHttpResponsePtr Response, bool)
-			{
-				if (Caller->GetGameInstance<UMGameInstance>()->IsDebugMode())
-				{
-					UHttpAPI::DebugResponse(Response);
-				}
-				
-				if (UHttpAPI::ValidateResponse(Response))
-				{
-					TArray<FCharacterData> CharacterList;
-					TSharedPtr<FJsonObject> JsonObject = MakeShareable(new FJsonObject);
-					const TSharedRef<TJsonReader<TCHAR>> JsonReader = TJsonReaderFactory<TCHAR>::Create(Response->GetContentAsString());
-					if (FJsonSerializer::Deserialize(JsonReader, JsonObject) && JsonObject.IsValid())
-					{
-						const TArray<TSharedPtr<FJsonValue>> ObjArray = JsonObject->GetArrayField(TEXT("data"));
-						FJsonObjectConverter::JsonArrayToUStruct(ObjArray, &CharacterList, 0, 0);
-					}
+	bool bConsumed = false;
+	GI->ConsumePrefetchedCharacterList(bConsumed);
 
-					if (CharacterList.Num())
-					{
-						Caller->GetGameInstance<UMGameInstance>()->UpdateCharacterList(CharacterList);
-						Caller->GetHUD<ALoginHUD>()->PushCharacterListToWidget(CharacterList);
-						this->OnComplete(EResponseType::Success);
-					}
-					else
-					{
-						this->OnComplete(EResponseType::Empty);
-					}
-				}
-				else
-				{
-					this->OnComplete(EResponseType::Failed);
-				}
-			});
-		}
+	if (!bSuccessful)
+	{
+		this->OnComplete(EResponseType::Failed);
+		return;
+	}
+
+	if (GI->GetCharacterList().Num())
+	{
+		Caller->GetHUD<ALoginHUD>()->PushCharacterListToWidget(GI->GetCharacterList());
+		this->OnComplete(EResponseType::Success);
+	}
+	else
+	{
+		this->OnComplete(EResponseType::Empty);
 	}
-#endif
 }
 
 void UAsync_GetCharacters::OnComplete(const EResponseType& ResponseType) const
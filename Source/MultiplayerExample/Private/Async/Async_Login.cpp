@@ -49,6 +49,10 @@ void UAsync_Login::Activate()
 			{
 				API->SetHeaders(Request);
 				API->POST<FUserCredentials>(Request, &UserCredentials);
+
+				// Open the connection to the API host and load the character select map while the login is in flight
+				API->WarmupConnection();
+				GameInstance->PreloadMap(GameInstance->GetMenuMap(EMenuMap::CharacterSelect));
 				
 				if (GameInstance->IsDebugMode())
 				{
@@ -79,6 +83,12 @@ void UAsync_Login::Activate()
 						
 						LoginResponse = NewCredentials;
 						GameInstance->SetNewToken(NewCredentials);
+
+						// Pipeline the character list so it loads alongside the character select map
+						if (bSuccess)
+						{
+							GameInstance->FetchCharacterList();
+						}
 					}
 
 					this->bSuccessful = bSuccess;
@@ -24,7 +24,9 @@
 
 #include "Async/Async_UpdateInventory.h"
 
+#include "Core/CharacterCache.h"
 #include "Core/HttpApi.h"
+#include "Core/InventoryJournal.h"
 #include "Core/MGameInstance.h"
 #include "Interfaces/IHttpResponse.h"
 #include "Player/MPlayerController.h"
@@ -42,11 +44,24 @@ void UAsync_UpdateInventory::Activate()
 {
 #if UE_SERVER || UE_EDITOR
 	UMGameInstance* GI = Controller->GetGameInstance<UMGameInstance>();
+	const AMPlayerController* Owner = Cast<AMPlayerController>(Controller);
+	const FString BearerToken = Owner ? Owner->GetBackendToken() : GI->GetToken().IdToken;
+
+	// Acknowledged at local disk latency, the journal gets the change to the backend even if the server goes down
+	UInventoryJournal* Journal = GI->GetSubsystem<UInventoryJournal>();
+	if (Journal && Journal->IsAccepting())
+	{
+		RegisterWithGameInstance(GI);
+		Journal->Append(UpdateInventoryRequest.id, BearerToken, UpdateInventoryRequest.NewItem,
+		                FSimpleDelegate::CreateUObject(this, &ThisClass::OnJournaled));
+		return;
+	}
+
 	if (UHttpAPI* API = GI->GetSubsystem<UHttpAPI>())
 	{
 		URequest* Request = API->CreateNewRequest(TEXT("updateInventory"));
 		API->SetHeaders(Request);
-		API->SetAuthHeader(Request, GI->GetToken().IdToken);
+		API->SetAuthHeader(Request, BearerToken);
 		API->POST<FUpdateInventoryRequest>(Request, &UpdateInventoryRequest);
 
 		if (GI->IsDebugMode())
@@ -54,34 +69,96 @@ void UAsync_UpdateInventory::Activate()
 			UHttpAPI::DebugRequest(Request);
 		}
 
-		UHttpAPI::BindLambdaResponse(Request, [&](FHttpRequestPtr, FHttpResponsePtr Response, bool)
+		// The node and the game instance may both be gone by the time the backend answers
+		RegisterWithGameInstance(GI);
+		TWeakObjectPtr<UAsync_UpdateInventory> WeakThis(this);
+		TWeakObjectPtr<UMGameInstance> WeakGI(GI);
+		UHttpAPI::BindLambdaResponse(Request, [WeakThis, WeakGI](FHttpRequestPtr, FHttpResponsePtr Response, bool)
 		{
-			if (GI->IsDebugMode())
+			if (WeakThis.IsValid() && WeakGI.IsValid())
 			{
-				UHttpAPI::DebugResponse(Response);
+				WeakThis->OnUpdateResponse(WeakGI.Get(), Response);
 			}
-
-			if (UHttpAPI::ValidateResponse(Response))
-			{
-				TArray<FInventoryJson> Inventory;
-				TSharedPtr<FJsonObject> JsonObject = MakeShareable(new FJsonObject);
-				const TSharedRef<TJsonReader<TCHAR>> JsonReader = TJsonReaderFactory<TCHAR>::Create(Response->GetContentAsString());
-				if (FJsonSerializer::Deserialize(JsonReader, JsonObject) && JsonObject.IsValid())
-				{
-					const TArray<TSharedPtr<FJsonValue>> ObjArray = JsonObject->GetArrayField(TEXT("data"));
-					FJsonObjectConverter::JsonArrayToUStruct(ObjArray, &Inventory, 0, 0);
-				}
-
-				OnComplete(Inventory);
-			}
-
-			if (AMPlayerController* PC = Cast<AMPlayerController>(Controller))
-				OnComplete(PC->GetPlayerState<AMPlayerState>()->GetInventory());
 		});
 	}
 #endif
 }
 
+void UAsync_UpdateInventory::OnUpdateResponse(UMGameInstance* GI, FHttpResponsePtr Response)
+{
+	SetReadyToDestroy();
+
+	if (GI->IsDebugMode())
+	{
+		UHttpAPI::DebugResponse(Response);
+	}
+
+	if (UHttpAPI::ValidateResponse(Response))
+	{
+		TArray<FInventoryJson> Inventory;
+		TSharedPtr<FJsonObject> JsonObject = MakeShareable(new FJsonObject);
+		const TSharedRef<TJsonReader<TCHAR>> JsonReader = TJsonReaderFactory<TCHAR>::Create(Response->GetContentAsString());
+		if (FJsonSerializer::Deserialize(JsonReader, JsonObject) && JsonObject.IsValid())
+		{
+			const TArray<TSharedPtr<FJsonValue>> ObjArray = JsonObject->GetArrayField(TEXT("data"));
+			FJsonObjectConverter::JsonArrayToUStruct(ObjArray, &Inventory, 0, 0);
+		}
+
+		// Write through so a reconnect served from the cache sees the new inventory
+		if (UCharacterCache* Cache = GI->GetSubsystem<UCharacterCache>())
+		{
+			Cache->UpdateInventory(UpdateInventoryRequest.id, Inventory);
+		}
+
+		OnComplete(Inventory);
+		return;
+	}
+
+	// The backend state is unknown now, the next connect has to fetch it again
+	if (UCharacterCache* Cache = GI->GetSubsystem<UCharacterCache>())
+	{
+		Cache->Invalidate(UpdateInventoryRequest.id);
+	}
+
+	// Not applied here either, the player keeps the inventory the server already had
+	AMPlayerController* PC = Cast<AMPlayerController>(Controller);
+	if (AMPlayerState* PS = PC ? PC->GetPlayerState<AMPlayerState>() : nullptr)
+	{
+		OnComplete(PS->GetInventory());
+	}
+}
+
+void UAsync_UpdateInventory::OnJournaled()
+{
+	SetReadyToDestroy();
+
+	AMPlayerController* PC = Cast<AMPlayerController>(Controller);
+	AMPlayerState* PS = PC ? PC->GetPlayerState<AMPlayerState>() : nullptr;
+	if (!PS)
+	{
+		return;
+	}
+
+	// Applied the same way the backend applies it, adding to an existing stack or starting a new one
+	TArray<FInventoryJson> Inventory = PS->GetInventory();
+	const FInventoryJson& NewItem = UpdateInventoryRequest.NewItem;
+	if (FInventoryJson* Existing = Inventory.FindByPredicate([&NewItem](const FInventoryJson& Item) { return Item.ItemId == NewItem.ItemId; }))
+	{
+		Existing->ItemCount += NewItem.ItemCount;
+	}
+	else
+	{
+		Inventory.Add(NewItem);
+	}
+
+	if (UCharacterCache* Cache = PC->GetGameInstance()->GetSubsystem<UCharacterCache>())
+	{
+		Cache->UpdateInventory(UpdateInventoryRequest.id, Inventory);
+	}
+
+	OnComplete(Inventory);
+}
+
 void UAsync_UpdateInventory::OnComplete(const TArray<FInventoryJson> NewInventory)
 {
 	OnUpdateInventoryComplete.Broadcast(NewInventory);
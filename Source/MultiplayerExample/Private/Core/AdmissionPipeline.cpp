@@ -0,0 +1,293 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Core/AdmissionPipeline.h"
+
+#include "GameFramework/Controller.h"
+
+void FAdmissionPipeline::Enqueue(AController* Controller, const FString& CharacterID, const FString& BearerToken)
+{
+	if (!Controller || Tickets.Contains(Controller))
+	{
+		return;
+	}
+
+	FTicket& Ticket = AddTicket(Controller);
+	Ticket.CharacterID = CharacterID;
+	Ticket.BearerToken = BearerToken;
+	EnterStage(Ticket, EAdmissionStage::Queued);
+	WaitingQueue.Add(Controller);
+
+	StartFetches();
+}
+
+void FAdmissionPipeline::EnqueueForSpawn(AController* Controller, const FCharacterData& Character)
+{
+	if (!Controller || Tickets.Contains(Controller))
+	{
+		return;
+	}
+
+	FTicket& Ticket = AddTicket(Controller);
+	Ticket.CharacterID = Character.ID;
+	Ticket.Character = Character;
+	EnterStage(Ticket, EAdmissionStage::Spawning);
+	PushSpawn(Controller, Ticket);
+}
+
+void FAdmissionPipeline::OnFetchComplete(AController* Controller, const FCharacterData& Character)
+{
+	FTicket* Ticket = Tickets.Find(Controller);
+	if (!Ticket || Ticket->Stage != EAdmissionStage::Fetching)
+	{
+		return;
+	}
+
+	--FetchesInFlight;
+	LeaveStage(*Ticket);
+
+	Ticket->Character = Character;
+	EnterStage(*Ticket, EAdmissionStage::Spawning);
+	PushSpawn(Controller, *Ticket);
+
+	StartFetches();
+}
+
+void FAdmissionPipeline::OnFetchFailed(AController* Controller)
+{
+	if (RemoveTicket(Controller))
+	{
+		++Stats.Failed;
+		Failed.ExecuteIfBound(Controller);
+		StartFetches();
+	}
+}
+
+void FAdmissionPipeline::Remove(AController* Controller)
+{
+	RemoveTicket(Controller);
+	StartFetches();
+}
+
+bool FAdmissionPipeline::RemoveTicket(const TObjectKey<AController> Key)
+{
+	FTicket Ticket;
+	if (!Tickets.RemoveAndCopyValue(Key, Ticket))
+	{
+		return false;
+	}
+
+	if (Ticket.Stage == EAdmissionStage::Fetching)
+	{
+		--FetchesInFlight;
+	}
+
+	LeaveStage(Ticket);
+	WaitingQueue.Remove(Key);
+	return true;
+}
+
+FAdmissionPipeline::FTicket& FAdmissionPipeline::AddTicket(AController* Controller)
+{
+	FTicket& Ticket = Tickets.Add(Controller);
+	Ticket.Controller = Controller;
+	Ticket.AdmissionStartTime = FPlatformTime::Seconds();
+	return Ticket;
+}
+
+void FAdmissionPipeline::PushSpawn(const TObjectKey<AController> Key, const FTicket& Ticket)
+{
+	SpawnQueue.HeapPush({Key, Ticket.AdmissionStartTime});
+}
+
+void FAdmissionPipeline::Tick()
+{
+	ExpireFetches();
+	StartFetches();
+	SpawnReady();
+}
+
+void FAdmissionPipeline::StartFetches()
+{
+	while (FetchesInFlight < MaxConcurrentFetches && WaitingQueue.Num() > 0)
+	{
+		const TObjectKey<AController> Key = WaitingQueue[0];
+		WaitingQueue.RemoveAt(0, 1, false);
+
+		FTicket* Ticket = Tickets.Find(Key);
+		if (!Ticket)
+		{
+			continue;
+		}
+
+		AController* Controller = Ticket->Controller.Get();
+		if (!Controller)
+		{
+			LeaveStage(*Ticket);
+			Tickets.Remove(Key);
+			continue;
+		}
+
+		LeaveStage(*Ticket);
+		EnterStage(*Ticket, EAdmissionStage::Fetching);
+		++FetchesInFlight;
+
+		StartFetch.ExecuteIfBound(Controller, Ticket->CharacterID, Ticket->BearerToken);
+	}
+}
+
+void FAdmissionPipeline::SpawnReady()
+{
+	if (SpawnQueue.Num() == 0)
+	{
+		return;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double Deadline = StartTime + SpawnBudgetMs / 1000.0;
+
+	// Players that have to wait for a spawn point go back into the queue after the slice, the rest still spawn
+	TArray<FSpawnEntry, TInlineAllocator<16>> Deferred;
+
+	int32 Spawned = 0;
+	while (SpawnQueue.Num() > 0 && ((Spawned == 0 && Deferred.Num() == 0) || FPlatformTime::Seconds() < Deadline))
+	{
+		FSpawnEntry Entry;
+		SpawnQueue.HeapPop(Entry, false);
+
+		FTicket* Found = Tickets.Find(Entry.Key);
+		if (!Found || Found->Stage != EAdmissionStage::Spawning || Found->AdmissionStartTime != Entry.AdmissionStartTime)
+		{
+			continue;
+		}
+
+		// Every spawn point is taken, wait for one to free up unless the player has waited too long already
+		if (CanSpawn.IsBound() && !CanSpawn.Execute() && StartTime - Found->StageStartTime < MaxSpawnWait)
+		{
+			Deferred.Add(Entry);
+			continue;
+		}
+
+		FTicket Ticket = MoveTemp(*Found);
+		Tickets.Remove(Entry.Key);
+		LeaveStage(Ticket);
+
+		if (AController* Controller = Ticket.Controller.Get())
+		{
+			++Stats.Admitted;
+			++Spawned;
+			Spawn.ExecuteIfBound(Controller, Ticket.Character);
+		}
+	}
+
+	if (Deferred.Num() > 0)
+	{
+		++Stats.SaturatedFrames;
+		for (const FSpawnEntry& Entry : Deferred)
+		{
+			SpawnQueue.HeapPush(Entry);
+		}
+	}
+
+	if (Spawned > 0)
+	{
+		const float FrameMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		Stats.SpawnFrameMs = FrameMs;
+		Stats.MaxSpawnFrameMs = FMath::Max(Stats.MaxSpawnFrameMs, FrameMs);
+		Stats.SpawnsLastFrame = Spawned;
+		if (FrameMs > SpawnBudgetMs)
+		{
+			++Stats.OverBudgetFrames;
+		}
+	}
+}
+
+void FAdmissionPipeline::ExpireFetches()
+{
+	const double Now = FPlatformTime::Seconds();
+
+	TArray<TObjectKey<AController>> Expired;
+	for (const TPair<TObjectKey<AController>, FTicket>& Pair : Tickets)
+	{
+		if (Pair.Value.Stage == EAdmissionStage::Fetching && Now - Pair.Value.StageStartTime > FetchTimeout)
+		{
+			Expired.Add(Pair.Key);
+		}
+	}
+
+	for (const TObjectKey<AController>& Key : Expired)
+	{
+		AController* Controller = Tickets[Key].Controller.Get();
+		UE_LOG(LogTemp, Warning, TEXT("Character fetch for %s timed out after %.1fs"), *GetNameSafe(Controller), FetchTimeout);
+
+		RemoveTicket(Key);
+		++Stats.Failed;
+		if (Controller)
+		{
+			Failed.ExecuteIfBound(Controller);
+		}
+	}
+}
+
+void FAdmissionPipeline::EnterStage(FTicket& Ticket, const EAdmissionStage Stage)
+{
+	Ticket.Stage = Stage;
+	Ticket.StageStartTime = FPlatformTime::Seconds();
+	++GetStageStats(Stage).Current;
+}
+
+void FAdmissionPipeline::LeaveStage(FTicket& Ticket)
+{
+	FAdmissionStageStats& StageStats = GetStageStats(Ticket.Stage);
+	--StageStats.Current;
+	StageStats.Record(FPlatformTime::Seconds() - Ticket.StageStartTime);
+}
+
+FAdmissionStageStats& FAdmissionPipeline::GetStageStats(const EAdmissionStage Stage)
+{
+	switch (Stage)
+	{
+	case EAdmissionStage::Fetching:	return Stats.Fetching;
+	case EAdmissionStage::Spawning:	return Stats.Spawning;
+	default:						return Stats.Queued;
+	}
+}
+
+void FAdmissionPipeline::DumpStats() const
+{
+	auto DumpStage = [](const TCHAR* Name, const FAdmissionStageStats& Stage)
+	{
+		UE_LOG(LogTemp, Display, TEXT("  %-9s current %4d  completed %6d  avg %7.3fs  max %7.3fs"), Name, Stage.Current,
+		       Stage.Completed, Stage.AverageSeconds, Stage.MaxSeconds);
+	};
+
+	UE_LOG(LogTemp, Display, TEXT("Admission: %d admitted, %d failed, %d/%d fetches in flight"), Stats.Admitted,
+	       Stats.Failed, FetchesInFlight, MaxConcurrentFetches);
+	DumpStage(TEXT("Queued"), Stats.Queued);
+	DumpStage(TEXT("Fetching"), Stats.Fetching);
+	DumpStage(TEXT("Spawning"), Stats.Spawning);
+	UE_LOG(LogTemp, Display, TEXT("  Spawn slice: %d spawned in %.3fms (max %.3fms, budget %.3fms, %d ticks over budget, %d ticks saturated)"),
+	       Stats.SpawnsLastFrame, Stats.SpawnFrameMs, Stats.MaxSpawnFrameMs, SpawnBudgetMs, Stats.OverBudgetFrames,
+	       Stats.SaturatedFrames);
+}
@@ -0,0 +1,140 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Core/AutosaveScheduler.h"
+
+#include "Player/MPlayerState.h"
+
+void FAutosaveScheduler::Initialize(const float InInterval, const int32 InNumSlots)
+{
+	Stats = FAutosaveStats();
+	Stats.Interval = FMath::Max(InInterval, 1.f);
+	Stats.NumSlots = FMath::Clamp(InNumSlots, 1, FMath::CeilToInt(Stats.Interval));
+
+	SlotDuration = Stats.Interval / Stats.NumSlots;
+	LastSlotIndex = INDEX_NONE;
+
+	Slots.Reset();
+	Slots.SetNum(Stats.NumSlots);
+	SlotOfPlayer.Reset();
+}
+
+void FAutosaveScheduler::Register(AMPlayerState* PlayerState)
+{
+	if (!PlayerState || Slots.Num() == 0 || SlotOfPlayer.Contains(PlayerState))
+	{
+		return;
+	}
+
+	const int32 Slot = GetSlot(PlayerState);
+	Slots[Slot].Add(PlayerState);
+	SlotOfPlayer.Add(PlayerState, Slot);
+	UpdateOccupancy();
+}
+
+void FAutosaveScheduler::Unregister(AMPlayerState* PlayerState)
+{
+	int32 Slot;
+	if (SlotOfPlayer.RemoveAndCopyValue(PlayerState, Slot))
+	{
+		Slots[Slot].RemoveSwap(PlayerState);
+		UpdateOccupancy();
+	}
+}
+
+void FAutosaveScheduler::Tick(const double Now)
+{
+	if (Slots.Num() == 0)
+	{
+		return;
+	}
+
+	const int64 SlotIndex = FMath::FloorToDouble(Now / SlotDuration);
+	if (LastSlotIndex == INDEX_NONE)
+	{
+		LastSlotIndex = SlotIndex;
+		return;
+	}
+
+	// A long hitch can skip slots, catch up on each of them but never go around more than once
+	const int64 FirstSlotIndex = FMath::Max(LastSlotIndex + 1, SlotIndex - Slots.Num() + 1);
+	for (int64 Index = FirstSlotIndex; Index <= SlotIndex; ++Index)
+	{
+		SaveSlot(Index % Slots.Num());
+	}
+
+	LastSlotIndex = SlotIndex;
+}
+
+int32 FAutosaveScheduler::GetSlot(const AMPlayerState* PlayerState) const
+{
+	return GetTypeHash(PlayerState->GetCharacterData().ID) % Slots.Num();
+}
+
+void FAutosaveScheduler::SaveSlot(const int32 Slot)
+{
+	for (const TWeakObjectPtr<AMPlayerState>& WeakPS : Slots[Slot])
+	{
+		AMPlayerState* PS = WeakPS.Get();
+		if (!PS || !PS->IsPersistenceDirty())
+		{
+			continue;
+		}
+
+		++Stats.SavesIssued;
+		PS->SyncPlayerState();
+	}
+}
+
+void FAutosaveScheduler::RecordSaveConfirmed(const float SaveLag)
+{
+	Stats.AverageSaveLag += (SaveLag - Stats.AverageSaveLag) / ++Stats.SavesConfirmed;
+	Stats.MaxSaveLag = FMath::Max(Stats.MaxSaveLag, SaveLag);
+}
+
+void FAutosaveScheduler::UpdateOccupancy()
+{
+	Stats.Players = SlotOfPlayer.Num();
+	Stats.MaxSlotOccupancy = 0;
+	Stats.MinSlotOccupancy = MAX_int32;
+
+	for (const TArray<TWeakObjectPtr<AMPlayerState>>& Slot : Slots)
+	{
+		Stats.MaxSlotOccupancy = FMath::Max(Stats.MaxSlotOccupancy, Slot.Num());
+		Stats.MinSlotOccupancy = FMath::Min(Stats.MinSlotOccupancy, Slot.Num());
+	}
+
+	if (Slots.Num() == 0)
+	{
+		Stats.MinSlotOccupancy = 0;
+	}
+}
+
+void FAutosaveScheduler::DumpStats() const
+{
+	UE_LOG(LogTemp, Display, TEXT("Autosave: every %.0fs over %d slots (%.2fs each), %d players, %d-%d per slot"), Stats.Interval,
+	       Stats.NumSlots, SlotDuration, Stats.Players, Stats.MinSlotOccupancy, Stats.MaxSlotOccupancy);
+	UE_LOG(LogTemp, Display, TEXT("  %d saves issued, %d confirmed, dirty to confirmed avg %.1fs max %.1fs"), Stats.SavesIssued,
+	       Stats.SavesConfirmed, Stats.AverageSaveLag, Stats.MaxSaveLag);
+}
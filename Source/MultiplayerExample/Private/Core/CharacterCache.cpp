@@ -0,0 +1,250 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Core/CharacterCache.h"
+
+#include "Misc/Base64.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Entries"), STAT_CharacterCacheEntries, STATGROUP_CharacterCache);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hits"), STAT_CharacterCacheHits, STATGROUP_CharacterCache);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Misses"), STAT_CharacterCacheMisses, STATGROUP_CharacterCache);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Evictions"), STAT_CharacterCacheEvictions, STATGROUP_CharacterCache);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Expirations"), STAT_CharacterCacheExpirations, STATGROUP_CharacterCache);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Hit Rate"), STAT_CharacterCacheHitRate, STATGROUP_CharacterCache);
+DECLARE_MEMORY_STAT(TEXT("Memory"), STAT_CharacterCacheMemory, STATGROUP_CharacterCache);
+
+static FAutoConsoleCommandWithWorld DumpCharacterCacheStatsCommand(
+	TEXT("MP.CharacterCache.Stats"),
+	TEXT("Logs the hit rate and memory use of the server side character cache"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+		if (const UCharacterCache* Cache = GameInstance ? GameInstance->GetSubsystem<UCharacterCache>() : nullptr)
+		{
+			Cache->DumpStats();
+		}
+	}));
+
+bool UCharacterCache::ShouldCreateSubsystem(UObject* Outer) const
+{
+#if UE_SERVER || UE_EDITOR
+	return true;
+#else
+	return false;
+#endif
+}
+
+void UCharacterCache::Initialize(FSubsystemCollectionBase& Collection)
+{
+	int32 MaxEntries = DefaultMaxEntries;
+
+	FConfigFile GameConfig;
+	if (FConfigCacheIni::LoadLocalIniFile(GameConfig, TEXT("DefaultGame"), false))
+	{
+		GameConfig.GetInt(TEXT("CharacterCache"), TEXT("MaxEntries"), MaxEntries);
+		GameConfig.GetFloat(TEXT("CharacterCache"), TEXT("TTLSeconds"), TTLSeconds);
+	}
+
+	Entries.Empty(FMath::Max(1, MaxEntries));
+	Stats = FCharacterCacheStats();
+	Stats.MaxEntries = Entries.Max();
+}
+
+const FCharacterData* UCharacterCache::Find(const FString& CharacterID, const FString& BearerToken)
+{
+	const FEntry* Entry = Entries.FindAndTouch(CharacterID);
+	if (Entry && FPlatformTime::Seconds() >= Entry->ExpiresAt)
+	{
+		Evict(CharacterID);
+		++Stats.Expirations;
+		Entry = nullptr;
+	}
+
+	if (Entry && Entry->BearerToken == BearerToken)
+	{
+		++Stats.Hits;
+		UpdateStats();
+		return &Entry->Character;
+	}
+
+	++Stats.Misses;
+	UpdateStats();
+	return nullptr;
+}
+
+void UCharacterCache::Store(const FCharacterData& Character, const FString& BearerToken)
+{
+	if (!Character.IsValid())
+	{
+		return;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	double ExpiresAt = Now + TTLSeconds;
+
+	FDateTime TokenExpiry;
+	if (GetTokenExpiry(BearerToken, TokenExpiry))
+	{
+		ExpiresAt = FMath::Min(ExpiresAt, Now + (TokenExpiry - FDateTime::UtcNow()).GetTotalSeconds());
+	}
+
+	// The token is about to expire, the next connect has to go through the backend anyway
+	if (ExpiresAt <= Now)
+	{
+		Invalidate(Character.ID);
+		return;
+	}
+
+	FEntry Entry;
+	Entry.Character = Character;
+	Entry.BearerToken = BearerToken;
+	Entry.ExpiresAt = ExpiresAt;
+	Entry.MemoryBytes = GetMemoryBytes(Entry);
+
+	if (const FEntry* Existing = Entries.Find(Character.ID))
+	{
+		Stats.MemoryBytes -= Existing->MemoryBytes;
+	}
+	else if (Entries.Num() >= Entries.Max())
+	{
+		Stats.MemoryBytes -= Entries.RemoveLeastRecent().MemoryBytes;
+		++Stats.Evictions;
+	}
+
+	Stats.MemoryBytes += Entry.MemoryBytes;
+	Entries.Add(Character.ID, Entry);
+	UpdateStats();
+}
+
+void UCharacterCache::UpdateInventory(const FString& CharacterID, const TArray<FInventoryJson>& Inventory)
+{
+	const FEntry* Existing = Entries.Find(CharacterID);
+	if (!Existing)
+	{
+		return;
+	}
+
+	FEntry Entry = *Existing;
+	Entry.Character.Inventory = Inventory;
+	Entry.MemoryBytes = GetMemoryBytes(Entry);
+
+	Stats.MemoryBytes += Entry.MemoryBytes - Existing->MemoryBytes;
+	Entries.Add(CharacterID, Entry);
+	UpdateStats();
+}
+
+void UCharacterCache::Invalidate(const FString& CharacterID)
+{
+	if (Entries.Contains(CharacterID))
+	{
+		Evict(CharacterID);
+		++Stats.Invalidations;
+		UpdateStats();
+	}
+}
+
+void UCharacterCache::Evict(const FString& CharacterID)
+{
+	if (const FEntry* Entry = Entries.Find(CharacterID))
+	{
+		Stats.MemoryBytes -= Entry->MemoryBytes;
+		Entries.Remove(CharacterID);
+	}
+}
+
+bool UCharacterCache::GetTokenExpiry(const FString& BearerToken, FDateTime& OutExpiryUtc)
+{
+	FString Token = BearerToken;
+	Token.RemoveFromStart(TEXT("Bearer "));
+
+	TArray<FString> Parts;
+	if (Token.ParseIntoArray(Parts, TEXT("."), false) != 3)
+	{
+		return false;
+	}
+
+	// The payload is base64url without padding
+	FString Payload = Parts[1].Replace(TEXT("-"), TEXT("+")).Replace(TEXT("_"), TEXT("/"));
+	while (Payload.Len() % 4 != 0)
+	{
+		Payload.AppendChar(TEXT('='));
+	}
+
+	TArray<uint8> Decoded;
+	if (!FBase64::Decode(Payload, Decoded))
+	{
+		return false;
+	}
+
+	const FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Decoded.GetData()), Decoded.Num());
+	const FString Json(Converted.Length(), Converted.Get());
+
+	TSharedPtr<FJsonObject> Claims;
+	const TSharedRef<TJsonReader<TCHAR>> JsonReader = TJsonReaderFactory<TCHAR>::Create(Json);
+	int64 Expiry = 0;
+	if (!FJsonSerializer::Deserialize(JsonReader, Claims) || !Claims.IsValid() || !Claims->TryGetNumberField(TEXT("exp"), Expiry))
+	{
+		return false;
+	}
+
+	OutExpiryUtc = FDateTime::FromUnixTimestamp(Expiry);
+	return true;
+}
+
+int64 UCharacterCache::GetMemoryBytes(const FEntry& Entry)
+{
+	const FCharacterData& Character = Entry.Character;
+
+	int64 Bytes = sizeof(FEntry) + Character.ID.GetAllocatedSize() * 2 + Character.Name.GetAllocatedSize() +
+		Entry.BearerToken.GetAllocatedSize() + Character.Inventory.GetAllocatedSize();
+
+	for (const FInventoryJson& Item : Character.Inventory)
+	{
+		Bytes += Item.ItemId.GetAllocatedSize();
+	}
+
+	return Bytes;
+}
+
+void UCharacterCache::UpdateStats()
+{
+	Stats.Entries = Entries.Num();
+
+	SET_DWORD_STAT(STAT_CharacterCacheEntries, Stats.Entries);
+	SET_DWORD_STAT(STAT_CharacterCacheHits, Stats.Hits);
+	SET_DWORD_STAT(STAT_CharacterCacheMisses, Stats.Misses);
+	SET_DWORD_STAT(STAT_CharacterCacheEvictions, Stats.Evictions);
+	SET_DWORD_STAT(STAT_CharacterCacheExpirations, Stats.Expirations);
+	SET_FLOAT_STAT(STAT_CharacterCacheHitRate, Stats.GetHitRate());
+	SET_MEMORY_STAT(STAT_CharacterCacheMemory, Stats.MemoryBytes);
+}
+
+void UCharacterCache::DumpStats() const
+{
+	UE_LOG(LogTemp, Display, TEXT("CharacterCache: %d/%d entries, %lld bytes, hit rate %.1f%% (%d hits, %d misses), %d evictions, %d invalidations, %d expirations"),
+	       Stats.Entries, Stats.MaxEntries, Stats.MemoryBytes, Stats.GetHitRate() * 100.f, Stats.Hits, Stats.Misses,
+	       Stats.Evictions, Stats.Invalidations, Stats.Expirations);
+}
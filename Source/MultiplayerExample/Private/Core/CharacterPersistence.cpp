@@ -0,0 +1,333 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Core/CharacterPersistence.h"
+
+#include "Containers/Ticker.h"
+#include "Core/CharacterCache.h"
+#include "Core/HttpApi.h"
+#include "Core/MGameInstance.h"
+#include "GameFramework/GameStateBase.h"
+#include "HttpManager.h"
+#include "HttpModule.h"
+#include "Interfaces/IHttpResponse.h"
+#include "Player/MPlayerController.h"
+#include "Player/MPlayerState.h"
+#include "Types/ApiTypes.h"
+
+static FAutoConsoleCommandWithWorld DumpPersistenceStatsCommand(
+	TEXT("MP.Persistence.Stats"),
+	TEXT("Logs the result of the last persistence flush"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+		if (const UCharacterPersistence* Persistence = GameInstance ? GameInstance->GetSubsystem<UCharacterPersistence>() : nullptr)
+		{
+			Persistence->DumpStats();
+		}
+	}));
+
+bool UCharacterPersistence::ShouldCreateSubsystem(UObject* Outer) const
+{
+#if UE_SERVER || UE_EDITOR
+	return true;
+#else
+	return false;
+#endif
+}
+
+void UCharacterPersistence::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Collection.InitializeDependency(UHttpAPI::StaticClass());
+
+	FConfigFile GameConfig;
+	if (FConfigCacheIni::LoadLocalIniFile(GameConfig, TEXT("DefaultGame"), false))
+	{
+		GameConfig.GetInt(TEXT("CharacterPersistence"), TEXT("MaxInFlight"), MaxInFlight);
+		GameConfig.GetFloat(TEXT("CharacterPersistence"), TEXT("RequestTimeout"), RequestTimeout);
+	}
+
+	MaxInFlight = FMath::Max(1, MaxInFlight);
+	RequestTimeout = FMath::Max(0.1f, RequestTimeout);
+
+	TickHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::Tick));
+}
+
+void UCharacterPersistence::Deinitialize()
+{
+	FTicker::GetCoreTicker().RemoveTicker(TickHandle);
+}
+
+TArray<AMPlayerState*> UCharacterPersistence::GetPlayerStates(const UWorld* World)
+{
+	TArray<AMPlayerState*> PlayerStates;
+
+	const AGameStateBase* GameState = World ? World->GetGameState() : nullptr;
+	if (GameState)
+	{
+		for (APlayerState* PlayerState : GameState->PlayerArray)
+		{
+			if (AMPlayerState* PS = Cast<AMPlayerState>(PlayerState))
+			{
+				PlayerStates.Add(PS);
+			}
+		}
+	}
+
+	return PlayerStates;
+}
+
+void UCharacterPersistence::Flush(const TArray<AMPlayerState*>& PlayerStates, FOnPersistenceFlushed OnComplete)
+{
+	StartFlush(PlayerStates, OnComplete);
+}
+
+TSharedRef<UCharacterPersistence::FFlush> UCharacterPersistence::StartFlush(const TArray<AMPlayerState*>& PlayerStates, FOnPersistenceFlushed OnComplete)
+{
+	TSharedRef<FFlush> NewFlush = MakeShared<FFlush>();
+	NewFlush->StartTime = FPlatformTime::Seconds();
+	NewFlush->OnComplete = OnComplete;
+
+	for (AMPlayerState* PS : PlayerStates)
+	{
+		// updateInventory adds to what the backend has, sending a change again while it is in flight would apply it twice
+		if (!PS || !PS->IsPersistenceDirty() || !PS->GetCharacterData().IsValid() || SavingPlayers.Contains(PS))
+		{
+			continue;
+		}
+
+		const AMPlayerController* PC = Cast<AMPlayerController>(PS->GetOwner());
+		const FString BearerToken = PC ? PC->GetBackendToken() : FString();
+
+		for (const FInventoryJson& Item : PS->GetUnsavedItems())
+		{
+			FSave& Save = NewFlush->Saves.AddDefaulted_GetRef();
+			Save.PlayerState = PS;
+			Save.CharacterID = PS->GetCharacterData().ID;
+			Save.BearerToken = BearerToken;
+			Save.Item = Item;
+		}
+
+		SavingPlayers.Add(PS, PS->GetUnsavedItems().Num());
+	}
+
+	NewFlush->Pending = NewFlush->Saves.Num();
+	if (NewFlush->Pending == 0)
+	{
+		FinishFlush(NewFlush);
+		return NewFlush;
+	}
+
+	Flushes.Add(NewFlush);
+	SendQueued(NewFlush);
+	return NewFlush;
+}
+
+FPersistenceFlushResult UCharacterPersistence::FlushBlocking(const TArray<AMPlayerState*>& PlayerStates)
+{
+	const TSharedRef<FFlush> BlockingFlush = StartFlush(PlayerStates, FOnPersistenceFlushed());
+
+	// Nothing else will tick the http manager while the server is going down, pump it here like FHttpManager::Flush does.
+	// Saves of earlier flushes are waited for as well, their player states are about to be destroyed with the world.
+	double LastTime = FPlatformTime::Seconds();
+	while (HasSavesInFlight())
+	{
+		FPlatformProcess::Sleep(0.005f);
+
+		const double Now = FPlatformTime::Seconds();
+		FHttpModule::Get().GetHttpManager().Tick(Now - LastTime);
+		Tick(Now - LastTime);
+		LastTime = Now;
+	}
+
+	return BlockingFlush->Result;
+}
+
+bool UCharacterPersistence::Tick(float DeltaTime)
+{
+	const double Now = FPlatformTime::Seconds();
+
+	// Finishing a flush removes it from the list
+	const TArray<TSharedRef<FFlush>> Active = Flushes;
+	for (const TSharedRef<FFlush>& Flush : Active)
+	{
+		ExpireSaves(Flush, Now);
+		SendQueued(Flush);
+	}
+
+	return true;
+}
+
+void UCharacterPersistence::SendQueued(const TSharedRef<FFlush>& Flush)
+{
+	while (Flush->InFlight < MaxInFlight && Flush->NextToSend < Flush->Saves.Num())
+	{
+		SendSave(Flush, Flush->NextToSend++);
+	}
+}
+
+void UCharacterPersistence::SendSave(const TSharedRef<FFlush>& Flush, const int32 SaveIndex)
+{
+	FSave& Save = Flush->Saves[SaveIndex];
+	Save.SentTime = FPlatformTime::Seconds();
+	++Flush->InFlight;
+
+	UHttpAPI* API = GetGameInstance()->GetSubsystem<UHttpAPI>();
+	if (!API)
+	{
+		OnSaveComplete(Flush, SaveIndex, nullptr, false);
+		return;
+	}
+
+	FUpdateInventoryRequest UpdateRequest;
+	UpdateRequest.id = Save.CharacterID;
+	UpdateRequest.NewItem = Save.Item;
+
+	URequest* Request = API->CreateNewRequest(TEXT("updateInventory"));
+	API->SetHeaders(Request);
+	API->SetAuthHeader(Request, Save.BearerToken);
+	Save.Request = Request;
+
+	const UMGameInstance* GI = Cast<UMGameInstance>(GetGameInstance());
+	if (GI && GI->IsDebugMode())
+	{
+		UHttpAPI::DebugRequest(Request);
+	}
+
+	TWeakObjectPtr<UCharacterPersistence> WeakThis(this);
+	UHttpAPI::BindLambdaResponse(Request, [WeakThis, Flush, SaveIndex](FHttpRequestPtr, FHttpResponsePtr Response, bool bSuccessful)
+	{
+		if (WeakThis.IsValid())
+		{
+			WeakThis->OnSaveComplete(Flush, SaveIndex, Response, bSuccessful);
+		}
+	});
+
+	API->POST<FUpdateInventoryRequest>(Request, &UpdateRequest);
+}
+
+void UCharacterPersistence::OnSaveComplete(const TSharedRef<FFlush>& Flush, const int32 SaveIndex, FHttpResponsePtr Response, const bool bSuccessful)
+{
+	FSave& Save = Flush->Saves[SaveIndex];
+	if (Save.bDone)
+	{
+		return;
+	}
+
+	const UMGameInstance* GI = Cast<UMGameInstance>(GetGameInstance());
+	if (GI && GI->IsDebugMode() && Response.IsValid())
+	{
+		UHttpAPI::DebugResponse(Response);
+	}
+
+	if (bSuccessful && Response.IsValid() && UHttpAPI::ValidateResponse(Response))
+	{
+		++Flush->Result.Succeeded;
+
+		AMPlayerState* PS = Save.PlayerState.Get();
+		const double DirtyTime = PS ? PS->GetPersistenceDirtyTime() : 0.0;
+		if (PS && PS->ConfirmPersisted(Save.Item))
+		{
+			OnCharacterSaved.Broadcast(PS, PS->GetWorld()->GetRealTimeSeconds() - DirtyTime);
+		}
+
+		// The response is the inventory the backend now has, keep the cache in step like UAsync_UpdateInventory does
+		TArray<FInventoryJson> Inventory;
+		TSharedPtr<FJsonObject> JsonObject = MakeShareable(new FJsonObject);
+		const TSharedRef<TJsonReader<TCHAR>> JsonReader = TJsonReaderFactory<TCHAR>::Create(Response->GetContentAsString());
+		UCharacterCache* Cache = GetGameInstance()->GetSubsystem<UCharacterCache>();
+		if (Cache && FJsonSerializer::Deserialize(JsonReader, JsonObject) && JsonObject.IsValid() && JsonObject->HasTypedField<EJson::Array>(TEXT("data")))
+		{
+			FJsonObjectConverter::JsonArrayToUStruct(JsonObject->GetArrayField(TEXT("data")), &Inventory, 0, 0);
+			Cache->UpdateInventory(Save.CharacterID, Inventory);
+		}
+	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Saving %d x %s for %s failed with %d, it is sent again on the next flush"), Save.Item.ItemCount,
+		       *Save.Item.ItemId, *Save.CharacterID, Response.IsValid() ? Response->GetResponseCode() : 0);
+		++Flush->Result.Failed;
+	}
+
+	FinishSave(Flush, Save);
+	SendQueued(Flush);
+}
+
+void UCharacterPersistence::ExpireSaves(const TSharedRef<FFlush>& Flush, const double Now)
+{
+	for (FSave& Save : Flush->Saves)
+	{
+		if (Save.bDone || !Save.Request || Now - Save.SentTime < RequestTimeout)
+		{
+			continue;
+		}
+
+		// Finished first, cancelling may complete the request synchronously
+		++Flush->Result.TimedOut;
+		URequest* Request = Save.Request;
+		FinishSave(Flush, Save);
+		Request->CancelRequest();
+	}
+}
+
+void UCharacterPersistence::FinishSave(const TSharedRef<FFlush>& Flush, FSave& Save)
+{
+	Save.bDone = true;
+	--Flush->InFlight;
+	--Flush->Pending;
+
+	int32* Remaining = SavingPlayers.Find(Save.PlayerState);
+	if (Remaining && --*Remaining <= 0)
+	{
+		SavingPlayers.Remove(Save.PlayerState);
+	}
+
+	if (Flush->Pending == 0)
+	{
+		Flushes.Remove(Flush);
+		FinishFlush(Flush);
+	}
+}
+
+void UCharacterPersistence::FinishFlush(const TSharedRef<FFlush>& Flush)
+{
+	Flush->Result.Seconds = FPlatformTime::Seconds() - Flush->StartTime;
+	LastFlushResult = Flush->Result;
+
+	if (Flush->Saves.Num() > 0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Persistence flush: %d saved, %d failed, %d timed out in %.2fs"), Flush->Result.Succeeded,
+		       Flush->Result.Failed, Flush->Result.TimedOut, Flush->Result.Seconds);
+	}
+
+	Flush->OnComplete.ExecuteIfBound(Flush->Result);
+}
+
+void UCharacterPersistence::DumpStats() const
+{
+	UE_LOG(LogTemp, Display, TEXT("Last persistence flush: %d saved, %d failed, %d timed out in %.2fs (%d in flight at most, %.1fs request timeout)"),
+	       LastFlushResult.Succeeded, LastFlushResult.Failed, LastFlushResult.TimedOut, LastFlushResult.Seconds,
+	       MaxInFlight, RequestTimeout);
+	UE_LOG(LogTemp, Display, TEXT("  %d flushes with %d player states still saving"), Flushes.Num(), SavingPlayers.Num());
+}
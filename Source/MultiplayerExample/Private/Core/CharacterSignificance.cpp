@@ -0,0 +1,179 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Core/CharacterSignificance.h"
+
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerState.h"
+#include "Player/MPlayerCharacter.h"
+#include "SignificanceManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("MP Character Significance"), STAT_CharacterSignificance_Update, STATGROUP_Game);
+
+const FName FCharacterSignificance::Tag(TEXT("MultiplayerExampleCharacter"));
+
+namespace
+{
+	/*
+	 *	Significance is the number of LODs finer than the coarsest one, so the best score over all viewpoints picks the
+	 *	finest LOD any observer needs
+	 **/
+	float GetSignificance(USignificanceManager::FManagedObjectInfo* ObjectInfo, const FTransform& Viewpoint)
+	{
+		const auto* Character = Cast<AMultiplayerExampleCharacter>(ObjectInfo->GetObject());
+		if (!Character || Character->MovementLODs.Num() == 0)
+		{
+			return 0.f;
+		}
+
+		// Capsules cannot overlap, a viewpoint this close is the character's own
+		const float DistanceSquared = FVector::DistSquared(Character->GetActorLocation(), Viewpoint.GetLocation());
+		if (DistanceSquared < 1.f)
+		{
+			return 0.f;
+		}
+
+		const int32 NumLODs = Character->MovementLODs.Num();
+		for (int32 LOD = 0; LOD < NumLODs; ++LOD)
+		{
+			if (DistanceSquared <= FMath::Square(Character->MovementLODs[LOD].MaxDistance))
+			{
+				return NumLODs - 1 - LOD;
+			}
+		}
+
+		return 0.f;
+	}
+
+	void PostSignificance(USignificanceManager::FManagedObjectInfo* ObjectInfo, float OldSignificance, const float Significance, bool bFinal)
+	{
+		if (auto* Character = Cast<AMultiplayerExampleCharacter>(ObjectInfo->GetObject()))
+		{
+			Character->SetMovementLOD(Character->MovementLODs.Num() - 1 - FMath::RoundToInt(Significance));
+		}
+	}
+}
+
+void FCharacterSignificance::Register(AMultiplayerExampleCharacter* Character)
+{
+	UWorld* World = Character->GetWorld();
+	if (!World || World->GetNetMode() != NM_DedicatedServer)
+	{
+		return;
+	}
+
+	if (USignificanceManager* Manager = USignificanceManager::Get(World))
+	{
+		Manager->RegisterObject(Character, Tag, &GetSignificance, USignificanceManager::EPostSignificanceType::Sequential,
+		                        &PostSignificance);
+	}
+}
+
+void FCharacterSignificance::Unregister(AMultiplayerExampleCharacter* Character)
+{
+	UWorld* World = Character->GetWorld();
+	if (USignificanceManager* Manager = World ? USignificanceManager::Get(World) : nullptr)
+	{
+		Manager->UnregisterObject(Character);
+	}
+}
+
+void FCharacterSignificance::Initialize(UWorld* InWorld)
+{
+	World = InWorld;
+	Viewpoints.Reset();
+	LastUpdateTime = 0.0;
+	Stats = FCharacterSignificanceStats();
+}
+
+void FCharacterSignificance::Tick()
+{
+	if (!World.IsValid() || World->GetNetMode() != NM_DedicatedServer)
+	{
+		return;
+	}
+
+	const double Now = World->GetRealTimeSeconds();
+	if (Now - LastUpdateTime < UpdateInterval)
+	{
+		return;
+	}
+
+	LastUpdateTime = Now;
+
+	USignificanceManager* Manager = USignificanceManager::Get(World.Get());
+	const AGameStateBase* GameState = World->GetGameState();
+	if (!Manager || !GameState)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_CharacterSignificance_Update);
+	const double StartTime = FPlatformTime::Seconds();
+
+	Viewpoints.Reset(GameState->PlayerArray.Num());
+	for (const APlayerState* PS : GameState->PlayerArray)
+	{
+		if (const APawn* Pawn = PS ? PS->GetPawn() : nullptr)
+		{
+			Viewpoints.Add(Pawn->GetActorTransform());
+		}
+	}
+
+	// With nobody connected every character drops to the coarsest LOD
+	Manager->Update(Viewpoints);
+
+	const TArray<USignificanceManager::FManagedObjectInfo*>& Objects = Manager->GetManagedObjects(Tag);
+
+	Stats.Characters = Objects.Num();
+	Stats.Viewpoints = Viewpoints.Num();
+	Stats.CharactersPerLOD.Reset();
+
+	for (const USignificanceManager::FManagedObjectInfo* ObjectInfo : Objects)
+	{
+		if (const auto* Character = Cast<AMultiplayerExampleCharacter>(ObjectInfo->GetObject()))
+		{
+			const int32 LOD = Character->GetMovementLOD();
+			if (LOD >= Stats.CharactersPerLOD.Num())
+			{
+				Stats.CharactersPerLOD.SetNumZeroed(LOD + 1);
+			}
+
+			++Stats.CharactersPerLOD[LOD];
+		}
+	}
+
+	Stats.UpdateMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+}
+
+void FCharacterSignificance::DumpStats() const
+{
+	UE_LOG(LogTemp, Display, TEXT("Character significance: %d characters, %d viewpoints, update %.3fms"), Stats.Characters,
+	       Stats.Viewpoints, Stats.UpdateMs);
+
+	for (int32 LOD = 0; LOD < Stats.CharactersPerLOD.Num(); ++LOD)
+	{
+		UE_LOG(LogTemp, Display, TEXT("  LOD %d: %d characters"), LOD, Stats.CharactersPerLOD[LOD]);
+	}
+}
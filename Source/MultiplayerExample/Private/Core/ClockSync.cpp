@@ -0,0 +1,136 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Core/ClockSync.h"
+
+static FAutoConsoleCommand SimulateClockSyncCommand(
+	TEXT("MP.Clock.Simulate"),
+	TEXT("Runs the clock estimator against simulated asymmetric latency with a known offset. Usage: MP.Clock.Simulate [LatencyMs=100] [JitterMs=30] [Samples=60]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const double Latency = (Args.Num() > 0 ? FMath::Max(0.f, FCString::Atof(*Args[0])) : 100.f) / 1000.0;
+		const double Jitter = (Args.Num() > 1 ? FMath::Max(0.f, FCString::Atof(*Args[1])) : 30.f) / 1000.0;
+		const int32 NumSamples = Args.Num() > 2 ? FMath::Max(1, FCString::Atoi(*Args[2])) : 60;
+
+		FRandomStream Stream(1);
+		FClockSyncEstimator Estimator;
+
+		// The server started 1234.5s before the client, each leg gets half the latency plus its own queuing delay
+		constexpr double TrueOffset = 1234.5;
+		double LocalTime = 0.0;
+		double WorstError = 0.0;
+
+		for (int32 Index = 0; Index < NumSamples; ++Index)
+		{
+			LocalTime += 1.0;
+
+			const double Up = Latency / 2.0 + Stream.FRand() * Jitter;
+			const double Down = Latency / 2.0 + Stream.FRand() * Jitter;
+
+			const double ServerTime = LocalTime + Up + TrueOffset;
+			Estimator.AddSample(LocalTime, ServerTime, LocalTime + Up + Down);
+
+			if (Index >= Estimator.WindowSize)
+			{
+				WorstError = FMath::Max(WorstError, FMath::Abs(Estimator.GetOffset() - TrueOffset));
+			}
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("Clock sync simulation: %.0fms latency, up to %.0fms jitter per leg, %d samples"), Latency * 1000.0,
+		       Jitter * 1000.0, NumSamples);
+		UE_LOG(LogTemp, Display, TEXT("  final error %.2fms, worst error after the first window %.2fms"),
+		       FMath::Abs(Estimator.GetOffset() - TrueOffset) * 1000.0, WorstError * 1000.0);
+		Estimator.DumpStats();
+	}));
+
+void FClockSyncEstimator::Reset()
+{
+	Samples.Reset();
+	NextSample = 0;
+	bHasEstimate = false;
+	Offset = 0.0;
+	Stats = FClockSyncStats();
+}
+
+void FClockSyncEstimator::AddSample(const double SendTime, const double ServerTime, const double ReceiveTime)
+{
+	const double RoundTrip = ReceiveTime - SendTime;
+	if (RoundTrip < 0.0)
+	{
+		return;
+	}
+
+	FSample Sample;
+	Sample.RoundTrip = RoundTrip;
+	Sample.Offset = ServerTime + RoundTrip / 2.0 - ReceiveTime;
+
+	if (Samples.Num() < FMath::Max(1, WindowSize))
+	{
+		Samples.Add(Sample);
+	}
+	else
+	{
+		Samples[NextSample] = Sample;
+		NextSample = (NextSample + 1) % Samples.Num();
+	}
+
+	const FSample* Best = &Samples[0];
+	double OffsetSum = 0.0;
+	for (const FSample& Each : Samples)
+	{
+		Best = Each.RoundTrip < Best->RoundTrip ? &Each : Best;
+		OffsetSum += Each.Offset;
+	}
+
+	const double OffsetMean = OffsetSum / Samples.Num();
+	double Variance = 0.0;
+	for (const FSample& Each : Samples)
+	{
+		Variance += FMath::Square(Each.Offset - OffsetMean);
+	}
+
+	if (!bHasEstimate || FMath::Abs(Best->Offset - Offset) > SnapThreshold)
+	{
+		Offset = Best->Offset;
+		bHasEstimate = true;
+		++Stats.Snaps;
+	}
+	else
+	{
+		Offset += (Best->Offset - Offset) * SlewRate;
+	}
+
+	++Stats.Samples;
+	Stats.OffsetMs = Offset * 1000.0;
+	Stats.JitterMs = FMath::Sqrt(Variance / Samples.Num()) * 1000.0;
+	Stats.MinRoundTripMs = Best->RoundTrip * 1000.0;
+	Stats.LastRoundTripMs = RoundTrip * 1000.0;
+	Stats.ErrorBoundMs = Best->RoundTrip * 500.0;
+}
+
+void FClockSyncEstimator::DumpStats() const
+{
+	UE_LOG(LogTemp, Display, TEXT("Clock sync: offset %.2fms +- %.2fms, jitter %.2fms, round trip min %.1fms last %.1fms, %d samples, %d snaps"),
+	       Stats.OffsetMs, Stats.ErrorBoundMs, Stats.JitterMs, Stats.MinRoundTripMs, Stats.LastRoundTripMs, Stats.Samples, Stats.Snaps);
+}
@@ -97,6 +97,24 @@ URequest* UHttpAPI::CreateLoginRequest()
 	return NewRequest;
 }
 
+void UHttpAPI::WarmupConnection()
+{
+	if (RequestExists(FName(TEXT("warmup"))))
+	{
+		return;
+	}
+
+	URequest* NewRequest = NewObject<URequest>();
+	NewRequest->SetRequestName(TEXT("warmup"));
+	NewRequest->SetURL(Route.GetAPIRoute());
+	NewRequest->SetHeader(TEXT("User-Agent"), TEXT("X-UnrealEngine-Agent"));
+	NewRequest->SetHeader(TEXT("Connection"), TEXT("keep-alive"));
+	NewRequest->SetVerb(URequest::HEAD);
+	BindLambdaResponse(NewRequest, [](FHttpRequestPtr, FHttpResponsePtr, bool) {});
+	ActiveRequests.Emplace(NewRequest);
+	NewRequest->ProcessRequest();
+}
+
 void UHttpAPI::SetHeaders(URequest* InRequest) const
 {
 	if (InRequest)
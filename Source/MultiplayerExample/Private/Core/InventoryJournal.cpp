@@ -0,0 +1,471 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Core/InventoryJournal.h"
+
+#include "Core/HttpApi.h"
+#include "Core/MGameInstance.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Interfaces/IHttpResponse.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Guid.h"
+#include "Misc/Paths.h"
+#include "Player/MPlayerState.h"
+
+static FAutoConsoleCommandWithWorld DumpInventoryJournalStatsCommand(
+	TEXT("MP.Journal.Stats"),
+	TEXT("Logs the backlog and flush timings of the inventory journal"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+		if (const UInventoryJournal* Journal = GameInstance ? GameInstance->GetSubsystem<UInventoryJournal>() : nullptr)
+		{
+			Journal->DumpStats();
+		}
+	}));
+
+bool UInventoryJournal::ShouldCreateSubsystem(UObject* Outer) const
+{
+	// Created wherever a server can run, the journal itself only opens once a dedicated or listen server calls Start
+	return !IsRunningClientOnly();
+}
+
+void UInventoryJournal::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Collection.InitializeDependency(UHttpAPI::StaticClass());
+
+	FConfigFile GameConfig;
+	if (FConfigCacheIni::LoadLocalIniFile(GameConfig, TEXT("DefaultGame"), false))
+	{
+		GameConfig.GetInt(TEXT("InventoryJournal"), TEXT("MaxReplayInFlight"), MaxReplayInFlight);
+		GameConfig.GetFloat(TEXT("InventoryJournal"), TEXT("ReplayInterval"), ReplayInterval);
+		GameConfig.GetFloat(TEXT("InventoryJournal"), TEXT("MaxReplayBackoff"), MaxReplayBackoff);
+		GameConfig.GetInt(TEXT("InventoryJournal"), TEXT("CompactThreshold"), CompactThreshold);
+		GameConfig.GetInt(TEXT("InventoryJournal"), TEXT("MaxConsecutiveRejections"), MaxConsecutiveRejections);
+	}
+
+	MaxReplayInFlight = FMath::Max(1, MaxReplayInFlight);
+	MaxConsecutiveRejections = FMath::Max(1, MaxConsecutiveRejections);
+}
+
+void UInventoryJournal::Start(UWorld* World)
+{
+	if (bStarted || !World)
+	{
+		return;
+	}
+
+	const ENetMode NetMode = World->GetNetMode();
+	if (NetMode != NM_DedicatedServer && NetMode != NM_ListenServer)
+	{
+		return;
+	}
+
+	bStarted = true;
+
+	// Only one server can listen on a port, so servers sharing a machine or a PIE session never share a file, while a
+	// server restarted on the same port picks up what its previous run left behind.
+	// The net driver moves to the next port when the configured one is taken, so its bound address wins over the URL.
+	int32 Port = World->URL.Port;
+	FString PortString;
+	const UNetDriver* NetDriver = World->GetNetDriver();
+	if (NetDriver && NetDriver->LowLevelGetNetworkNumber().Split(TEXT(":"), nullptr, &PortString, ESearchCase::IgnoreCase, ESearchDir::FromEnd))
+	{
+		Port = FCString::Atoi(*PortString);
+	}
+
+	JournalPath = FPaths::ProjectSavedDir() / TEXT("Journal") / FString::Printf(TEXT("Inventory_%d.journal"), Port);
+
+	Load();
+
+	if (!OpenFile())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to open the inventory journal at %s, inventory changes go straight to the backend"), *GetJournalPath());
+		return;
+	}
+
+	// Rewrites the file so a torn last line from a crash is dropped before new entries are appended after it
+	Compact();
+
+	TickHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::Tick));
+}
+
+void UInventoryJournal::Deinitialize()
+{
+	FTicker::GetCoreTicker().RemoveTicker(TickHandle);
+
+	FlushToDisk();
+	File.Reset();
+}
+
+bool UInventoryJournal::IsAccepting() const
+{
+	return IsOpen() && FPlatformTime::Seconds() >= RejectingUntil;
+}
+
+int64 UInventoryJournal::Append(const FString& CharacterID, const FString& BearerToken, const FInventoryJson& Item, FSimpleDelegate OnDurable)
+{
+	FInventoryMutation& Mutation = Buffered.AddDefaulted_GetRef();
+	Mutation.seq = NextSequence++;
+	Mutation.id = CharacterID;
+	Mutation.token = BearerToken;
+	Mutation.item = Item;
+
+	WriteBuffer += ToLine(Mutation);
+	BufferedCallbacks.Add(OnDurable);
+
+	++Stats.Appended;
+	Stats.Buffered = Buffered.Num();
+	return Mutation.seq;
+}
+
+bool UInventoryJournal::Tick(float DeltaTime)
+{
+	FlushToDisk();
+
+	if (ReplayInFlight == 0 && Pending.Num() > 0 && FPlatformTime::Seconds() >= NextReplayTime)
+	{
+		ReplayPending();
+	}
+
+	return true;
+}
+
+bool UInventoryJournal::OpenFile()
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(GetJournalPath()));
+
+	File.Reset(PlatformFile.OpenWrite(*GetJournalPath(), true));
+	return File.IsValid();
+}
+
+void UInventoryJournal::Load()
+{
+	TArray<FString> Lines;
+	FFileHelper::LoadFileToStringArray(Lines, *GetJournalPath());
+
+	for (const FString& Line : Lines)
+	{
+		TSharedPtr<FJsonObject> JsonObject = MakeShareable(new FJsonObject);
+		const TSharedRef<TJsonReader<TCHAR>> JsonReader = TJsonReaderFactory<TCHAR>::Create(Line);
+		if (!FJsonSerializer::Deserialize(JsonReader, JsonObject) || !JsonObject.IsValid())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Skipping unreadable inventory journal entry: %s"), *Line);
+			continue;
+		}
+
+		if (JsonObject->HasField(TEXT("journal")))
+		{
+			JournalID = JsonObject->GetStringField(TEXT("journal"));
+			NextSequence = FMath::Max<int64>(NextSequence, JsonObject->GetNumberField(TEXT("seq")));
+			continue;
+		}
+
+		FInventoryMutation Mutation;
+		if (FJsonObjectConverter::JsonObjectToUStruct(JsonObject.ToSharedRef(), &Mutation, 0, 0))
+		{
+			NextSequence = FMath::Max(NextSequence, Mutation.seq + 1);
+			Pending.Add(Mutation);
+		}
+	}
+
+	if (JournalID.IsEmpty())
+	{
+		JournalID = FGuid::NewGuid().ToString(EGuidFormats::Digits);
+	}
+
+	Stats.Pending = Pending.Num();
+	if (Pending.Num() > 0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Inventory journal %s has %d unconfirmed mutations to replay"), *JournalID, Pending.Num());
+	}
+}
+
+void UInventoryJournal::FlushToDisk()
+{
+	if (!File.IsValid() || Buffered.Num() == 0)
+	{
+		return;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	const FTCHARToUTF8 Utf8(*WriteBuffer);
+	const bool bWritten = File->Write(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length()) && File->Flush(true);
+	if (!bWritten)
+	{
+		// Keep the mutations buffered and unacknowledged, the next tick tries again
+		UE_LOG(LogTemp, Error, TEXT("Failed to write %d mutations to the inventory journal"), Buffered.Num());
+		return;
+	}
+
+	const float FlushMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	Stats.AverageFlushMs += (FlushMs - Stats.AverageFlushMs) / ++Stats.Flushes;
+
+	Pending.Append(MoveTemp(Buffered));
+	Buffered.Reset();
+	WriteBuffer.Reset();
+
+	TArray<FSimpleDelegate> Callbacks = MoveTemp(BufferedCallbacks);
+	BufferedCallbacks.Reset();
+
+	Stats.Buffered = 0;
+	Stats.Pending = Pending.Num();
+
+	for (const FSimpleDelegate& Callback : Callbacks)
+	{
+		Callback.ExecuteIfBound();
+	}
+}
+
+void UInventoryJournal::ReplayPending()
+{
+	bRoundHadRetries = false;
+	bSendingRound = true;
+
+	// Copied first, a request that fails synchronously removes its entry from Pending while the round is being sent
+	TArray<FInventoryMutation> Round(Pending.GetData(), FMath::Min(Pending.Num(), MaxReplayInFlight));
+	for (const FInventoryMutation& Mutation : Round)
+	{
+		++ReplayInFlight;
+		SendMutation(Mutation);
+	}
+
+	bSendingRound = false;
+	if (ReplayInFlight == 0)
+	{
+		FinishReplayRound();
+	}
+}
+
+void UInventoryJournal::SendMutation(const FInventoryMutation& Mutation)
+{
+	UHttpAPI* API = GetGameInstance()->GetSubsystem<UHttpAPI>();
+	if (!API)
+	{
+		OnReplayResponse(Mutation.seq, EReplayResult::Retry, 0);
+		return;
+	}
+
+	FUpdateInventoryRequest UpdateRequest;
+	UpdateRequest.id = Mutation.id;
+	UpdateRequest.NewItem = Mutation.item;
+
+	URequest* Request = API->CreateNewRequest(TEXT("updateInventory"));
+	API->SetHeaders(Request);
+	API->SetAuthHeader(Request, Mutation.token);
+
+	const UMGameInstance* GI = Cast<UMGameInstance>(GetGameInstance());
+	if (GI && GI->IsDebugMode())
+	{
+		UHttpAPI::DebugRequest(Request);
+	}
+
+	TWeakObjectPtr<UInventoryJournal> WeakThis(this);
+	const int64 Sequence = Mutation.seq;
+	UHttpAPI::BindLambdaResponse(Request, [WeakThis, Sequence](FHttpRequestPtr, FHttpResponsePtr Response, bool bSuccessful)
+	{
+		if (WeakThis.IsValid())
+		{
+			const UMGameInstance* GI = Cast<UMGameInstance>(WeakThis->GetGameInstance());
+			if (GI && GI->IsDebugMode() && Response.IsValid())
+			{
+				UHttpAPI::DebugResponse(Response);
+			}
+
+			WeakThis->OnReplayResponse(Sequence, ClassifyResponse(Response, bSuccessful), Response.IsValid() ? Response->GetResponseCode() : 0);
+		}
+	});
+
+	API->POST<FUpdateInventoryRequest>(Request, &UpdateRequest);
+}
+
+UInventoryJournal::EReplayResult UInventoryJournal::ClassifyResponse(FHttpResponsePtr Response, const bool bSuccessful)
+{
+	if (!bSuccessful || !Response.IsValid())
+	{
+		return EReplayResult::Retry;
+	}
+
+	const int32 Code = Response->GetResponseCode();
+	if (EHttpResponseCodes::IsOk(Code))
+	{
+		return EReplayResult::Confirmed;
+	}
+
+	// The backend or something in front of it is struggling, the same request can succeed later
+	if (Code >= EHttpResponseCodes::ServerError || Code == EHttpResponseCodes::RequestTimeout || Code == EHttpResponseCodes::TooManyRequests)
+	{
+		return EReplayResult::Retry;
+	}
+
+	// Every other answer, including an expired token, will never change for this entry
+	return EReplayResult::Rejected;
+}
+
+void UInventoryJournal::OnReplayResponse(const int64 Sequence, const EReplayResult Result, const int32 ResponseCode)
+{
+	--ReplayInFlight;
+
+	const int32 Index = Pending.IndexOfByPredicate([Sequence](const FInventoryMutation& Mutation) { return Mutation.seq == Sequence; });
+	if (Index != INDEX_NONE)
+	{
+		if (Result == EReplayResult::Retry)
+		{
+			bRoundHadRetries = true;
+		}
+		else
+		{
+			if (Result == EReplayResult::Confirmed)
+			{
+				ConsecutiveRejections = 0;
+				++Stats.Confirmed;
+			}
+			else
+			{
+				DeadLetter(Pending[Index], ResponseCode);
+			}
+
+			Pending.RemoveAt(Index);
+			++RemovedSinceCompact;
+			Stats.Pending = Pending.Num();
+		}
+	}
+
+	if (ReplayInFlight == 0 && !bSendingRound)
+	{
+		FinishReplayRound();
+	}
+}
+
+void UInventoryJournal::FinishReplayRound()
+{
+	if (bRoundHadRetries)
+	{
+		// Back off while the backend is down, the mutations are safe on disk
+		ReplayBackoff = FMath::Clamp(ReplayBackoff * 2.f, ReplayInterval, MaxReplayBackoff);
+		NextReplayTime = FPlatformTime::Seconds() + ReplayBackoff;
+		++Stats.ReplayFailures;
+		UE_LOG(LogTemp, Warning, TEXT("Inventory journal replay could not reach the backend, %d mutations pending, retrying in %.1fs"),
+		       Pending.Num(), ReplayBackoff);
+	}
+	else
+	{
+		ReplayBackoff = 0.f;
+		NextReplayTime = 0.0;
+	}
+
+	if (Pending.Num() == 0 || RemovedSinceCompact >= CompactThreshold)
+	{
+		Compact();
+	}
+}
+
+void UInventoryJournal::DeadLetter(const FInventoryMutation& Mutation, const int32 ResponseCode)
+{
+	UE_LOG(LogTemp, Error, TEXT("Backend rejected journaled inventory mutation %lld for %s with %d, moved it to the dead letter file"),
+	       Mutation.seq, *Mutation.id, ResponseCode);
+
+	const FString DeadLetterPath = GetJournalPath() + TEXT(".deadletter");
+	FFileHelper::SaveStringToFile(ToLine(Mutation), *DeadLetterPath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM,
+	                              &IFileManager::Get(), FILEWRITE_Append);
+	++Stats.DeadLettered;
+
+	// The player's inventory already contains the change, the persistence flush is the only other way it reaches the backend
+	const AGameStateBase* GameState = GetWorld() ? GetWorld()->GetGameState() : nullptr;
+	if (GameState)
+	{
+		for (APlayerState* PlayerState : GameState->PlayerArray)
+		{
+			AMPlayerState* PS = Cast<AMPlayerState>(PlayerState);
+			if (PS && PS->GetCharacterData().ID == Mutation.id)
+			{
+				PS->MarkPersistenceDirty(Mutation.item);
+			}
+		}
+	}
+
+	// Stop acknowledging at disk latency while the backend refuses everything, callers go back to direct sends
+	if (++ConsecutiveRejections >= MaxConsecutiveRejections)
+	{
+		RejectingUntil = FPlatformTime::Seconds() + MaxReplayBackoff;
+		ConsecutiveRejections = 0;
+		UE_LOG(LogTemp, Error, TEXT("Inventory journal bypassed for %.1fs after %d rejected mutations in a row"), MaxReplayBackoff,
+		       MaxConsecutiveRejections);
+	}
+}
+
+void UInventoryJournal::Compact()
+{
+	// Unconfirmed entries plus the header, buffered entries are appended to the new file on the next flush
+	FString Contents = GetHeaderLine();
+	for (const FInventoryMutation& Mutation : Pending)
+	{
+		Contents += ToLine(Mutation);
+	}
+
+	const FString TempPath = GetJournalPath() + TEXT(".tmp");
+	if (!FFileHelper::SaveStringToFile(Contents, *TempPath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to compact the inventory journal, keeping the old file"));
+		return;
+	}
+
+	File.Reset();
+	IFileManager::Get().Move(*GetJournalPath(), *TempPath, true);
+
+	if (!OpenFile())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to reopen the inventory journal after compaction"));
+		return;
+	}
+
+	RemovedSinceCompact = 0;
+	++Stats.Compactions;
+}
+
+FString UInventoryJournal::GetHeaderLine() const
+{
+	// Written on every compaction so sequences keep increasing for this journal ID after confirmed entries are dropped
+	return FString::Printf(TEXT("{\"journal\":\"%s\",\"seq\":%lld}\n"), *JournalID, NextSequence);
+}
+
+FString UInventoryJournal::ToLine(const FInventoryMutation& Mutation)
+{
+	FString Line;
+	FJsonObjectConverter::UStructToJsonObjectString(Mutation, Line, 0, 0, 0, nullptr, false);
+	return Line + TEXT("\n");
+}
+
+void UInventoryJournal::DumpStats() const
+{
+	UE_LOG(LogTemp, Display, TEXT("Inventory journal %s: %d buffered, %d pending, %d appended, %d confirmed"), *JournalID,
+	       Stats.Buffered, Stats.Pending, Stats.Appended, Stats.Confirmed);
+	UE_LOG(LogTemp, Display, TEXT("  %d flushes (avg %.3fms), %d replay failures, %d dead lettered, %d compactions"), Stats.Flushes,
+	       Stats.AverageFlushMs, Stats.ReplayFailures, Stats.DeadLettered, Stats.Compactions);
+}
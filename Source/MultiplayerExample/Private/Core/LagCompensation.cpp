@@ -0,0 +1,488 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Core/LagCompensation.h"
+
+#include "Components/CapsuleComponent.h"
+#include "Core/MGameEngine.h"
+#include "Player/MPlayerCharacter.h"
+
+DECLARE_CYCLE_STAT(TEXT("MP Lag Compensation Record"), STAT_LagCompensation_Record, STATGROUP_Game);
+DECLARE_CYCLE_STAT(TEXT("MP Lag Compensation Query"), STAT_LagCompensation_Query, STATGROUP_Game);
+
+static FAutoConsoleCommandWithWorld DumpLagCompensationStatsCommand(
+	TEXT("MP.LagComp.Stats"),
+	TEXT("Logs the lag compensation history size, memory and query cost"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const ULagCompensation* LagCompensation = World ? World->GetSubsystem<ULagCompensation>() : nullptr)
+		{
+			LagCompensation->DumpStats();
+		}
+	}));
+
+static FAutoConsoleCommand BenchLagCompensationCommand(
+	TEXT("MP.LagComp.Bench"),
+	TEXT("Times batched rewind queries against a synthetic history. Usage: MP.LagComp.Bench [Characters=100] [Rays=32] [Iterations=1000]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumCharacters = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 100;
+		const int32 NumRays = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 32;
+		const int32 Iterations = Args.Num() > 2 ? FMath::Max(1, FCString::Atoi(*Args[2])) : 1000;
+
+		FRandomStream Stream(1);
+		FLagCompensationBuffer Buffer;
+		Buffer.Initialize(NumCharacters, ULagCompensation::DefaultMaxFrames);
+
+		// Characters spread over a 100m square walking at running speed, recorded at 30Hz
+		TArray<FVector> Locations;
+		for (int32 Index = 0; Index < NumCharacters; ++Index)
+		{
+			Buffer.AcquireSlot();
+			Locations.Add(FVector(Stream.FRandRange(-5000.f, 5000.f), Stream.FRandRange(-5000.f, 5000.f), 100.f));
+		}
+
+		constexpr double FrameTime = 1.0 / 30.0;
+		for (int32 Frame = 0; Frame < ULagCompensation::DefaultMaxFrames; ++Frame)
+		{
+			Buffer.BeginFrame(Frame * FrameTime);
+			for (int32 Index = 0; Index < NumCharacters; ++Index)
+			{
+				Locations[Index] += FVector(Stream.FRandRange(-20.f, 20.f), Stream.FRandRange(-20.f, 20.f), 0.f);
+				Buffer.Write(Index, Locations[Index], 42.f, 96.f);
+			}
+		}
+
+		TArray<FLagCompensationRay> Rays;
+		TArray<FLagCompensationHit> Hits;
+		int64 NumHits = 0;
+
+		double Seconds = 0.0;
+		for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			Rays.Reset();
+			for (int32 Index = 0; Index < NumRays; ++Index)
+			{
+				FLagCompensationRay& Ray = Rays.AddDefaulted_GetRef();
+				Ray.IgnoreSlot = Stream.RandRange(0, NumCharacters - 1);
+				Ray.Start = Locations[Ray.IgnoreSlot];
+				Ray.End = Ray.Start + Stream.VRand() * 10000.f;
+			}
+
+			const double Time = Stream.FRandRange(static_cast<float>(Buffer.GetOldestTime()), static_cast<float>(Buffer.GetNewestTime()));
+
+			const double StartTime = FPlatformTime::Seconds();
+			Buffer.RewindAndTest(Time, Rays, Hits);
+			Seconds += FPlatformTime::Seconds() - StartTime;
+
+			for (const FLagCompensationHit& Hit : Hits)
+			{
+				NumHits += Hit.IsHit() ? 1 : 0;
+			}
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("Lag compensation: %d characters, %d frames, %.1fKB"), NumCharacters, Buffer.GetNumFrames(),
+		       Buffer.GetAllocatedSize() / 1024.0);
+		UE_LOG(LogTemp, Display, TEXT("  %d queries of %d rays: %.2fus per query, %.3fus per ray, %lld hits"), Iterations, NumRays,
+		       Seconds * 1000000.0 / Iterations, Seconds * 1000000.0 / (static_cast<double>(Iterations) * NumRays), NumHits);
+	}));
+
+void FLagCompensationBuffer::Initialize(const int32 InMaxSlots, const int32 InMaxFrames)
+{
+	MaxSlots = FMath::Max(1, InMaxSlots);
+	MaxFrames = FMath::Max(2, InMaxFrames);
+	NumFrames = 0;
+	Head = INDEX_NONE;
+	FrameCounter = 0;
+
+	const int32 NumEntries = MaxSlots * MaxFrames;
+
+	FrameTimes.SetNumZeroed(MaxFrames);
+	X.SetNumZeroed(NumEntries);
+	Y.SetNumZeroed(NumEntries);
+	Z.SetNumZeroed(NumEntries);
+	Radius.SetNumZeroed(NumEntries);
+	HalfHeight.SetNumZeroed(NumEntries);
+	Recorded.SetNumZeroed(NumEntries);
+
+	SlotReleasedFrame.Init(-MaxFrames, MaxSlots);
+	SlotInUse.Init(false, MaxSlots);
+
+	RewindSlots.Reset(MaxSlots);
+	RewindX.Reset(MaxSlots);
+	RewindY.Reset(MaxSlots);
+	RewindZ.Reset(MaxSlots);
+	RewindRadius.Reset(MaxSlots);
+	RewindHalfHeight.Reset(MaxSlots);
+}
+
+void FLagCompensationBuffer::Release()
+{
+	*this = FLagCompensationBuffer();
+}
+
+int32 FLagCompensationBuffer::AcquireSlot()
+{
+	for (int32 Slot = 0; Slot < MaxSlots; ++Slot)
+	{
+		if (!SlotInUse[Slot] && FrameCounter - SlotReleasedFrame[Slot] >= MaxFrames)
+		{
+			SlotInUse[Slot] = true;
+			return Slot;
+		}
+	}
+
+	return INDEX_NONE;
+}
+
+void FLagCompensationBuffer::ReleaseSlot(const int32 Slot)
+{
+	if (SlotInUse.IsValidIndex(Slot) && SlotInUse[Slot])
+	{
+		SlotInUse[Slot] = false;
+		SlotReleasedFrame[Slot] = FrameCounter;
+	}
+}
+
+void FLagCompensationBuffer::BeginFrame(const double Time)
+{
+	Head = (Head + 1) % MaxFrames;
+	NumFrames = FMath::Min(NumFrames + 1, MaxFrames);
+	++FrameCounter;
+
+	FrameTimes[Head] = Time;
+	FMemory::Memzero(&Recorded[Head * MaxSlots], MaxSlots);
+}
+
+void FLagCompensationBuffer::Write(const int32 Slot, const FVector& Location, const float InRadius, const float InHalfHeight)
+{
+	check(Head != INDEX_NONE && Slot >= 0 && Slot < MaxSlots);
+
+	const int32 Index = Head * MaxSlots + Slot;
+	X[Index] = Location.X;
+	Y[Index] = Location.Y;
+	Z[Index] = Location.Z;
+	Radius[Index] = InRadius;
+	HalfHeight[Index] = InHalfHeight;
+	Recorded[Index] = 1;
+}
+
+double FLagCompensationBuffer::GetOldestTime() const
+{
+	return NumFrames > 0 ? FrameTimes[(Head - NumFrames + 1 + MaxFrames) % MaxFrames] : 0.0;
+}
+
+double FLagCompensationBuffer::GetNewestTime() const
+{
+	return NumFrames > 0 ? FrameTimes[Head] : 0.0;
+}
+
+SIZE_T FLagCompensationBuffer::GetAllocatedSize() const
+{
+	return FrameTimes.GetAllocatedSize() + X.GetAllocatedSize() + Y.GetAllocatedSize() + Z.GetAllocatedSize() +
+		Radius.GetAllocatedSize() + HalfHeight.GetAllocatedSize() + Recorded.GetAllocatedSize() +
+		SlotReleasedFrame.GetAllocatedSize() + SlotInUse.GetAllocatedSize() + RewindSlots.GetAllocatedSize() +
+		RewindX.GetAllocatedSize() + RewindY.GetAllocatedSize() + RewindZ.GetAllocatedSize() +
+		RewindRadius.GetAllocatedSize() + RewindHalfHeight.GetAllocatedSize();
+}
+
+int32 FLagCompensationBuffer::Rewind(const double Time)
+{
+	RewindSlots.Reset();
+	RewindX.Reset();
+	RewindY.Reset();
+	RewindZ.Reset();
+	RewindRadius.Reset();
+	RewindHalfHeight.Reset();
+
+	if (NumFrames == 0 || Time < GetOldestTime())
+	{
+		return INDEX_NONE;
+	}
+
+	// Frames by age, 0 is the newest. Find the newest frame at or before Time, a time past the newest frame uses it as is
+	int32 Low = 0;
+	int32 High = NumFrames - 1;
+	while (Low < High)
+	{
+		const int32 Mid = (Low + High) / 2;
+		if (FrameTimes[(Head - Mid + MaxFrames) % MaxFrames] <= Time)
+		{
+			High = Mid;
+		}
+		else
+		{
+			Low = Mid + 1;
+		}
+	}
+
+	const int32 Before = (Head - Low + MaxFrames) % MaxFrames;
+	const int32 After = Low > 0 ? (Head - Low + 1 + MaxFrames) % MaxFrames : Before;
+
+	const double Span = FrameTimes[After] - FrameTimes[Before];
+	const float Alpha = Span > 0.0 ? FMath::Clamp(static_cast<float>((Time - FrameTimes[Before]) / Span), 0.f, 1.f) : 0.f;
+
+	const int32 BeforeRow = Before * MaxSlots;
+	const int32 AfterRow = After * MaxSlots;
+
+	for (int32 Slot = 0; Slot < MaxSlots; ++Slot)
+	{
+		const bool bBefore = Recorded[BeforeRow + Slot] != 0;
+		const bool bAfter = Recorded[AfterRow + Slot] != 0;
+		if (!bBefore && !bAfter)
+		{
+			continue;
+		}
+
+		// Spawned or removed in between, use the one frame it exists in
+		const int32 From = bBefore ? BeforeRow + Slot : AfterRow + Slot;
+		const int32 To = bAfter ? AfterRow + Slot : BeforeRow + Slot;
+
+		RewindSlots.Add(Slot);
+		RewindX.Add(FMath::Lerp(X[From], X[To], Alpha));
+		RewindY.Add(FMath::Lerp(Y[From], Y[To], Alpha));
+		RewindZ.Add(FMath::Lerp(Z[From], Z[To], Alpha));
+		RewindRadius.Add(FMath::Lerp(Radius[From], Radius[To], Alpha));
+		RewindHalfHeight.Add(FMath::Lerp(HalfHeight[From], HalfHeight[To], Alpha));
+	}
+
+	return RewindSlots.Num();
+}
+
+bool FLagCompensationBuffer::RewindAndTest(const double Time, const TArrayView<const FLagCompensationRay> Rays, TArray<FLagCompensationHit>& OutHits)
+{
+	OutHits.Reset(Rays.Num());
+	OutHits.AddDefaulted(Rays.Num());
+
+	const int32 NumCapsules = Rewind(Time);
+	if (NumCapsules == INDEX_NONE)
+	{
+		return false;
+	}
+
+	for (int32 RayIndex = 0; RayIndex < Rays.Num(); ++RayIndex)
+	{
+		const FLagCompensationRay& Ray = Rays[RayIndex];
+		const FVector RayMin = Ray.Start.ComponentMin(Ray.End);
+		const FVector RayMax = Ray.Start.ComponentMax(Ray.End);
+
+		FLagCompensationHit& Hit = OutHits[RayIndex];
+		float BestDistanceSquared = MAX_flt;
+
+		for (int32 Index = 0; Index < NumCapsules; ++Index)
+		{
+			const float CapsuleRadius = RewindRadius[Index];
+			const float CapsuleHalfHeight = RewindHalfHeight[Index];
+
+			// Bounds first, most capsules are nowhere near the ray
+			if (RewindX[Index] + CapsuleRadius < RayMin.X || RewindX[Index] - CapsuleRadius > RayMax.X ||
+				RewindY[Index] + CapsuleRadius < RayMin.Y || RewindY[Index] - CapsuleRadius > RayMax.Y ||
+				RewindZ[Index] + CapsuleHalfHeight < RayMin.Z || RewindZ[Index] - CapsuleHalfHeight > RayMax.Z)
+			{
+				continue;
+			}
+
+			if (RewindSlots[Index] == Ray.IgnoreSlot)
+			{
+				continue;
+			}
+
+			// Characters stay upright, the capsule is a vertical segment inflated by its radius
+			const float SegmentHalfHeight = FMath::Max(CapsuleHalfHeight - CapsuleRadius, 0.f);
+			const FVector Center(RewindX[Index], RewindY[Index], RewindZ[Index]);
+
+			FVector OnRay, OnAxis;
+			FMath::SegmentDistToSegmentSafe(Ray.Start, Ray.End, Center - FVector(0.f, 0.f, SegmentHalfHeight),
+			                                Center + FVector(0.f, 0.f, SegmentHalfHeight), OnRay, OnAxis);
+
+			if (FVector::DistSquared(OnRay, OnAxis) > FMath::Square(CapsuleRadius))
+			{
+				continue;
+			}
+
+			const float DistanceSquared = FVector::DistSquared(Ray.Start, OnRay);
+			if (DistanceSquared < BestDistanceSquared)
+			{
+				BestDistanceSquared = DistanceSquared;
+				Hit.Slot = RewindSlots[Index];
+				Hit.Location = OnRay;
+				Hit.Distance = FMath::Sqrt(DistanceSquared);
+			}
+		}
+	}
+
+	return true;
+}
+
+bool ULagCompensation::ShouldCreateSubsystem(UObject* Outer) const
+{
+#if UE_SERVER || UE_EDITOR
+	return Super::ShouldCreateSubsystem(Outer);
+#else
+	return false;
+#endif
+}
+
+void ULagCompensation::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	int32 MaxCharacters = DefaultMaxCharacters;
+	int32 MaxFrames = DefaultMaxFrames;
+
+	FConfigFile GameConfig;
+	if (FConfigCacheIni::LoadLocalIniFile(GameConfig, TEXT("DefaultGame"), false))
+	{
+		GameConfig.GetInt(TEXT("LagCompensation"), TEXT("MaxCharacters"), MaxCharacters);
+		GameConfig.GetInt(TEXT("LagCompensation"), TEXT("MaxFrames"), MaxFrames);
+	}
+
+	Stats = FLagCompensationStats();
+	Stats.MaxCharacters = FMath::Max(1, MaxCharacters);
+	Stats.Frames = FMath::Max(2, MaxFrames);
+
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &ThisClass::OnWorldPostActorTick);
+	ServerIdleHandle = UMGameEngine::OnServerIdleChanged().AddUObject(this, &ThisClass::OnServerIdleChanged);
+}
+
+void ULagCompensation::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	UMGameEngine::OnServerIdleChanged().Remove(ServerIdleHandle);
+
+	Super::Deinitialize();
+}
+
+void ULagCompensation::Register(AMultiplayerExampleCharacter* Character)
+{
+	if (!Character || SlotOfCharacter.Contains(Character))
+	{
+		return;
+	}
+
+	// Allocated on first use so worlds without players, such as menus, hold nothing
+	if (Buffer.GetMaxSlots() == 0)
+	{
+		Buffer.Initialize(Stats.MaxCharacters, Stats.Frames);
+		CharacterInSlot.SetNum(Buffer.GetMaxSlots());
+		Stats.MemoryBytes = Buffer.GetAllocatedSize();
+	}
+
+	const int32 Slot = Buffer.AcquireSlot();
+	if (Slot == INDEX_NONE)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Lag compensation is full (%d characters), %s is not recorded"), Buffer.GetMaxSlots(),
+		       *Character->GetName());
+		return;
+	}
+
+	SlotOfCharacter.Add(Character, Slot);
+	CharacterInSlot[Slot] = Character;
+	Stats.Characters = SlotOfCharacter.Num();
+}
+
+void ULagCompensation::Unregister(AMultiplayerExampleCharacter* Character)
+{
+	int32 Slot;
+	if (SlotOfCharacter.RemoveAndCopyValue(Character, Slot))
+	{
+		Buffer.ReleaseSlot(Slot);
+		CharacterInSlot[Slot].Reset();
+		Stats.Characters = SlotOfCharacter.Num();
+	}
+}
+
+bool ULagCompensation::RewindAndTest(const float Time, const TArray<FLagCompensationRay>& Rays, TArray<FLagCompensationHit>& OutHits)
+{
+	SCOPE_CYCLE_COUNTER(STAT_LagCompensation_Query);
+
+	const double StartTime = FPlatformTime::Seconds();
+	const bool bInHistory = Buffer.RewindAndTest(Time, Rays, OutHits);
+	const float QueryUs = (FPlatformTime::Seconds() - StartTime) * 1000000.0;
+
+	Stats.Rays += Rays.Num();
+	Stats.QueriesOutsideHistory += bInHistory ? 0 : 1;
+	Stats.AverageQueryUs += (QueryUs - Stats.AverageQueryUs) / ++Stats.Queries;
+	Stats.MaxQueryUs = FMath::Max(Stats.MaxQueryUs, QueryUs);
+
+	return bInHistory;
+}
+
+AMultiplayerExampleCharacter* ULagCompensation::GetCharacter(const int32 Slot) const
+{
+	return CharacterInSlot.IsValidIndex(Slot) ? CharacterInSlot[Slot].Get() : nullptr;
+}
+
+int32 ULagCompensation::GetSlot(const AMultiplayerExampleCharacter* Character) const
+{
+	const int32* Slot = SlotOfCharacter.Find(Character);
+	return Slot ? *Slot : INDEX_NONE;
+}
+
+void ULagCompensation::OnWorldPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (InWorld != GetWorld() || SlotOfCharacter.Num() == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_LagCompensation_Record);
+	const double StartTime = FPlatformTime::Seconds();
+
+	Buffer.BeginFrame(InWorld->GetTimeSeconds());
+
+	for (const TPair<TWeakObjectPtr<AMultiplayerExampleCharacter>, int32>& Pair : SlotOfCharacter)
+	{
+		const AMultiplayerExampleCharacter* Character = Pair.Key.Get();
+		const UCapsuleComponent* Capsule = Character ? Character->GetCapsuleComponent() : nullptr;
+		if (Capsule)
+		{
+			Buffer.Write(Pair.Value, Capsule->GetComponentLocation(), Capsule->GetScaledCapsuleRadius(), Capsule->GetScaledCapsuleHalfHeight());
+		}
+	}
+
+	const float RecordUs = (FPlatformTime::Seconds() - StartTime) * 1000000.0;
+	Stats.AverageRecordUs += (RecordUs - Stats.AverageRecordUs) / ++RecordedFrames;
+	Stats.HistorySeconds = Buffer.GetNewestTime() - Buffer.GetOldestTime();
+}
+
+void ULagCompensation::OnServerIdleChanged(const bool bIdle)
+{
+	// Nobody left to rewind, allocated again by the next character to register
+	if (bIdle && SlotOfCharacter.Num() == 0)
+	{
+		Buffer.Release();
+		CharacterInSlot.Empty();
+		Stats.MemoryBytes = 0;
+		Stats.HistorySeconds = 0.f;
+	}
+}
+
+void ULagCompensation::DumpStats() const
+{
+	UE_LOG(LogTemp, Display, TEXT("Lag compensation: %d/%d characters, %d frames covering %.2fs, %.1fKB"), Stats.Characters,
+	       Stats.MaxCharacters, Stats.Frames, Stats.HistorySeconds, Stats.MemoryBytes / 1024.0);
+	UE_LOG(LogTemp, Display, TEXT("  record avg %.2fus, %d queries (%d outside history) of %d rays, avg %.2fus max %.2fus"),
+	       Stats.AverageRecordUs, Stats.Queries, Stats.QueriesOutsideHistory, Stats.Rays, Stats.AverageQueryUs, Stats.MaxQueryUs);
+}
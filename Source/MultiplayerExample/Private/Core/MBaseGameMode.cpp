@@ -25,9 +25,18 @@
 #include "Core/MBaseGameMode.h"
 
 #include "Async/Async_UpdateInventory.h"
+#include "Core/CharacterCache.h"
+#include "Core/CharacterPersistence.h"
+#include "Core/HttpApi.h"
+#include "Core/InventoryJournal.h"
+#include "Core/MGameEngine.h"
+#include "Core/ServerDirectory.h"
 #include "GameFramework/CheatManager.h"
 #include "GameFramework/GameSession.h"
 #include "GameFramework/PlayerState.h"
+#include "HttpServerModule.h"
+#include "HttpServerResponse.h"
+#include "IHttpRouter.h"
 #include "Kismet/GameplayStatics.h"
 #include "Player/MPlayerCharacter.h"
 #include "Player/MPlayerController.h"
@@ -35,10 +44,308 @@
 
 FExampleGameModeEvents::FReadyToSpawnPlayer FExampleGameModeEvents::ReadyToSpawnPlayerEvent;
 
+static FAutoConsoleCommandWithWorld DumpAdmissionStatsCommand(
+	TEXT("MP.Admission.Stats"),
+	TEXT("Logs the per stage timings of the player admission pipeline"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const auto* GameMode = World ? World->GetAuthGameMode<AMultiplayerExampleGameMode>() : nullptr)
+		{
+			GameMode->DumpAdmissionStats();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld DumpSpawnStatsCommand(
+	TEXT("MP.Spawn.Stats"),
+	TEXT("Logs player start reservations and allocation counts"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const auto* GameMode = World ? World->GetAuthGameMode<AMultiplayerExampleGameMode>() : nullptr)
+		{
+			GameMode->DumpSpawnStats();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld DumpAutosaveStatsCommand(
+	TEXT("MP.Autosave.Stats"),
+	TEXT("Logs autosave slot occupancy and save lag"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const auto* GameMode = World ? World->GetAuthGameMode<AMultiplayerExampleGameMode>() : nullptr)
+		{
+			GameMode->DumpAutosaveStats();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld DumpNetFrequencyStatsCommand(
+	TEXT("MP.NetFrequency.Stats"),
+	TEXT("Logs the update frequency chosen for every player character and player state, and why"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const auto* GameMode = World ? World->GetAuthGameMode<AMultiplayerExampleGameMode>() : nullptr)
+		{
+			GameMode->DumpNetFrequencyStats();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld DumpSignificanceStatsCommand(
+	TEXT("MP.Significance.Stats"),
+	TEXT("Logs how many characters are at each movement LOD"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const auto* GameMode = World ? World->GetAuthGameMode<AMultiplayerExampleGameMode>() : nullptr)
+		{
+			GameMode->DumpSignificanceStats();
+		}
+	}));
+
 AMultiplayerExampleGameMode::AMultiplayerExampleGameMode()
 {
+	PrimaryActorTick.bCanEverTick = true;
+
 	bUseSeamlessTravel = false;
-	FExampleGameModeEvents::ReadyToSpawnPlayerEvent.AddUObject(this, &ThisClass::PerformInitialSpawn);
+	MaxConcurrentFetches = 16;
+	SpawnBudgetMs = 2.f;
+	FetchTimeout = 15.f;
+	SpawnCellSize = 200.f;
+	SpawnReservationTimeout = 2.f;
+	MaxSpawnWait = 10.f;
+	AutosaveInterval = 300.f;
+	AutosaveSlots = 60;
+	SignificanceInterval = 0.25f;
+}
+
+void AMultiplayerExampleGameMode::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Only the game mode in play listens, class defaults never admit anyone and would drop every player's data as late
+	if (!HasAnyFlags(RF_ClassDefaultObject))
+	{
+		ReadyToSpawnPlayerHandle = FExampleGameModeEvents::ReadyToSpawnPlayerEvent.AddUObject(this, &ThisClass::OnReadyToSpawnPlayer);
+	}
+
+	Admission.MaxConcurrentFetches = FMath::Max(1, MaxConcurrentFetches);
+	Admission.SpawnBudgetMs = FMath::Max(0.f, SpawnBudgetMs);
+	Admission.FetchTimeout = FetchTimeout;
+	Admission.MaxSpawnWait = MaxSpawnWait;
+	Admission.StartFetch.BindUObject(this, &ThisClass::StartCharacterFetch);
+	Admission.Spawn.BindUObject(this, &ThisClass::PerformInitialSpawn);
+	Admission.Failed.BindUObject(this, &ThisClass::OnAdmissionFailed);
+	Admission.CanSpawn.BindLambda([this]() { return SpawnPoints.IsEmpty() || SpawnPoints.HasFreeStart(); });
+
+	SpawnPoints.CellSize = SpawnCellSize;
+	SpawnPoints.ReservationTimeout = SpawnReservationTimeout;
+	SpawnPoints.Initialize(GetWorld());
+
+	// Replays whatever the last run on this port left unconfirmed before new players change their inventories
+	if (UInventoryJournal* Journal = GetGameInstance()->GetSubsystem<UInventoryJournal>())
+	{
+		Journal->Start(GetWorld());
+	}
+
+	Autosave.Initialize(AutosaveInterval, AutosaveSlots);
+	if (UCharacterPersistence* Persistence = GetGameInstance()->GetSubsystem<UCharacterPersistence>())
+	{
+		CharacterSavedHandle = Persistence->OnCharacterSaved.AddUObject(this, &ThisClass::OnCharacterSaved);
+	}
+
+	NetFrequency.Settings = NetFrequencySettings;
+	NetFrequency.Initialize(GetWorld());
+
+	Significance.UpdateInterval = SignificanceInterval;
+	Significance.Initialize(GetWorld());
+
+	ServerIdleHandle = UMGameEngine::OnServerIdleChanged().AddUObject(this, &ThisClass::OnServerIdleChanged);
+
+	if (GetNetMode() == NM_DedicatedServer)
+	{
+		StartStatusEndpoint();
+	}
+}
+
+void AMultiplayerExampleGameMode::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	StopStatusEndpoint();
+	UMGameEngine::OnServerIdleChanged().Remove(ServerIdleHandle);
+	FExampleGameModeEvents::ReadyToSpawnPlayerEvent.Remove(ReadyToSpawnPlayerHandle);
+
+	// Last chance to save anyone not covered by a travel flush or logout, the process may exit right after this
+	if (UCharacterPersistence* Persistence = GetGameInstance()->GetSubsystem<UCharacterPersistence>())
+	{
+		Persistence->FlushBlocking(UCharacterPersistence::GetPlayerStates(GetWorld()));
+		Persistence->OnCharacterSaved.Remove(CharacterSavedHandle);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AMultiplayerExampleGameMode::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	SpawnPoints.Tick(GetWorld()->GetRealTimeSeconds());
+	Admission.Tick();
+	Autosave.Tick(GetWorld()->GetRealTimeSeconds());
+	NetFrequency.Tick(GetWorld()->GetRealTimeSeconds());
+	Significance.Tick();
+}
+
+void AMultiplayerExampleGameMode::RequestAdmission(AController* Controller, const FString& CharacterID, const FString& BearerToken)
+{
+	// Players reconnecting with a token the backend already accepted go straight to the spawn stage
+	UCharacterCache* Cache = GetGameInstance()->GetSubsystem<UCharacterCache>();
+	if (const FCharacterData* Cached = Cache ? Cache->Find(CharacterID, BearerToken) : nullptr)
+	{
+		Admission.EnqueueForSpawn(Controller, *Cached);
+		return;
+	}
+
+	Admission.Enqueue(Controller, CharacterID, BearerToken);
+}
+
+void AMultiplayerExampleGameMode::NotifyCharacterFetchFailed(AController* Controller)
+{
+	Admission.OnFetchFailed(Controller);
+}
+
+void AMultiplayerExampleGameMode::OnReadyToSpawnPlayer(AController* Controller, FCharacterData Character)
+{
+	// Every spawn goes through the pipeline. A response for a player it no longer tracks arrived after the fetch
+	// timed out or the player left, they were already sent back to the login screen.
+	if (!Admission.Contains(Controller))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Dropping late character data for %s, the player is no longer being admitted"), *GetNameSafe(Controller));
+		return;
+	}
+
+	Admission.OnFetchComplete(Controller, Character);
+}
+
+void AMultiplayerExampleGameMode::StartCharacterFetch(AController* Controller, const FString& CharacterID, const FString& BearerToken)
+{
+	if (AMPlayerController* PC = Cast<AMPlayerController>(Controller))
+	{
+		PC->FetchCharacter(CharacterID, BearerToken);
+	}
+	else
+	{
+		Admission.OnFetchFailed(Controller);
+	}
+}
+
+void AMultiplayerExampleGameMode::OnAdmissionFailed(AController* Controller)
+{
+	if (AMPlayerController* PC = Cast<AMPlayerController>(Controller))
+	{
+		PC->Client_DisconnectAndGotoLoginScreen();
+	}
+}
+
+void AMultiplayerExampleGameMode::OnServerIdleChanged(const bool bIdle)
+{
+	// Per player bookkeeping is rebuilt as players arrive
+	if (bIdle)
+	{
+		NetFrequency.Initialize(GetWorld());
+		Significance.Initialize(GetWorld());
+	}
+}
+
+void AMultiplayerExampleGameMode::OnCharacterSaved(AMPlayerState* PlayerState, const float SaveLag)
+{
+	Autosave.RecordSaveConfirmed(SaveLag);
+}
+
+void AMultiplayerExampleGameMode::Logout(AController* Exiting)
+{
+	Admission.Remove(Exiting);
+	SpawnPoints.Release(Exiting);
+
+	AMPlayerState* PS = Exiting ? Exiting->GetPlayerState<AMPlayerState>() : nullptr;
+	Autosave.Unregister(PS);
+
+	UCharacterPersistence* Persistence = GetGameInstance()->GetSubsystem<UCharacterPersistence>();
+	if (PS && Persistence && PS->IsPersistenceDirty())
+	{
+		Persistence->Flush({PS});
+	}
+
+	Super::Logout(Exiting);
+}
+
+void AMultiplayerExampleGameMode::ProcessServerTravel(const FString& URL, const bool bAbsolute)
+{
+	// Travel is not seamless, every player state is destroyed with the current world
+	if (UCharacterPersistence* Persistence = GetGameInstance()->GetSubsystem<UCharacterPersistence>())
+	{
+		Persistence->FlushBlocking(UCharacterPersistence::GetPlayerStates(GetWorld()));
+	}
+
+	Super::ProcessServerTravel(URL, bAbsolute);
+}
+
+void AMultiplayerExampleGameMode::StartStatusEndpoint()
+{
+	int32 PortOffset = UServerDirectory::DefaultStatusPortOffset;
+
+	FConfigFile GameConfig;
+	if (FConfigCacheIni::LoadLocalIniFile(GameConfig, TEXT("DefaultGame"), false))
+	{
+		GameConfig.GetInt(TEXT("ServerDirectory"), TEXT("StatusPortOffset"), PortOffset);
+	}
+
+	StatusPort = GetWorld()->URL.Port + PortOffset;
+	TSharedPtr<IHttpRouter> Router = FHttpServerModule::Get().GetHttpRouter(StatusPort);
+	if (!Router.IsValid())
+	{
+		UE_LOG(LogGameMode, Error, TEXT("Failed to create the status endpoint on port %d"), StatusPort);
+		return;
+	}
+
+	TWeakObjectPtr<AMultiplayerExampleGameMode> WeakThis(this);
+	StatusRouteHandle = Router->BindRoute(FHttpPath(TEXT("/status")), EHttpServerRequestVerbs::VERB_GET,
+		[WeakThis](const FHttpServerRequest&, const FHttpResultCallback& OnComplete)
+		{
+			FServerStatusResponse Status;
+			if (WeakThis.IsValid())
+			{
+				Status.Players = WeakThis->GetNumPlayers();
+				Status.MaxPlayers = WeakThis->GameSession ? WeakThis->GameSession->MaxPlayers : 0;
+			}
+
+			if (UMGameEngine* Engine = Cast<UMGameEngine>(GEngine))
+			{
+				Status.IdleWaitMs = Engine->GetStatusIdleWaitMs();
+				Engine->NotifyStatusRequest();
+
+				const FServerTickStats& TickStats = Engine->GetServerTickStats();
+				Status.bIdle = TickStats.bIdle;
+				Status.TickRate = TickStats.TickRate;
+				Status.IdleCpuPercent = TickStats.IdleCpuPercent;
+				Status.ActiveCpuPercent = TickStats.ActiveCpuPercent;
+			}
+
+			OnComplete(FHttpServerResponse::Create(UHttpAPI::FromStruct(Status), TEXT("application/json")));
+			return true;
+		});
+
+	FHttpServerModule::Get().StartAllListeners();
+	UE_LOG(LogGameMode, Log, TEXT("Status endpoint listening on port %d"), StatusPort);
+}
+
+void AMultiplayerExampleGameMode::StopStatusEndpoint()
+{
+	if (StatusRouteHandle.IsValid())
+	{
+		TSharedPtr<IHttpRouter> Router = FHttpServerModule::Get().GetHttpRouter(StatusPort);
+		if (Router.IsValid())
+		{
+			Router->UnbindRoute(StatusRouteHandle);
+		}
+
+		StatusRouteHandle.Reset();
+	}
 }
 
 void AMultiplayerExampleGameMode::PostLogin(APlayerController* NewPlayer)
@@ -115,7 +422,13 @@ void AMultiplayerExampleGameMode::PerformInitialSpawn(AController* Controller, F
 			PC->Client_DisconnectAndGotoLoginScreen();
 		}
 
-		AActor* StartSpot = FindPlayerStart(Controller);
+		// Without a free start the stock start search is used, the spawn then goes through the engine's overlap adjustment
+		AActor* StartSpot = SpawnPoints.Allocate(Controller);
+		if (!StartSpot)
+		{
+			StartSpot = FindPlayerStart(Controller);
+		}
+
 		if (!StartSpot)
 		{
 			if (Controller->StartSpot.IsValid())
@@ -129,6 +442,7 @@ void AMultiplayerExampleGameMode::PerformInitialSpawn(AController* Controller, F
 		{
 			UE_LOG(LogGameMode, Error, TEXT("PerformFirstPlayerSpawn: Failed to find a player spot, aborting"));
 			PC->Client_DisconnectAndGotoLoginScreen();
+			return;
 		}
 
 		const FRotator SpawnRotation = StartSpot->GetActorRotation();
@@ -148,6 +462,7 @@ void AMultiplayerExampleGameMode::PerformInitialSpawn(AController* Controller, F
 
 		if (!Controller->GetPawn())
 		{
+			SpawnPoints.Release(Controller);
 			Controller->FailedToSpawnPawn();
 			PC->Client_DisconnectAndGotoLoginScreen();
 			return;
@@ -162,8 +477,8 @@ void AMultiplayerExampleGameMode::PerformInitialSpawn(AController* Controller, F
 		if (AMPlayerState* PS = Controller->GetPlayerState<AMPlayerState>())
 		{
 			PS->SetCharacterData(Character);
-			PS->OnRep_CharacterData();
 			ChangeName(Controller, Character.Name, true);
+			Autosave.Register(PS);
 		}
 		else
 		{
@@ -178,6 +493,29 @@ void AMultiplayerExampleGameMode::PerformInitialSpawn(AController* Controller, F
 	}
 }
 
+APawn* AMultiplayerExampleGameMode::SpawnDefaultPawnAtTransform_Implementation(AController* NewPlayer, const FTransform& SpawnTransform)
+{
+	FActorSpawnParameters SpawnInfo;
+	SpawnInfo.Instigator = GetInstigator();
+	SpawnInfo.ObjectFlags |= RF_Transient;
+
+	// Nobody else stands on a clear reserved start, skip the encroachment fix-up the default handling does per spawn
+	SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+	if (SpawnPoints.IsReservedStartClear(NewPlayer))
+	{
+		SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	}
+
+	UClass* PawnClass = GetDefaultPawnClassForController(NewPlayer);
+	APawn* ResultPawn = GetWorld()->SpawnActor<APawn>(PawnClass, SpawnTransform, SpawnInfo);
+	if (!ResultPawn)
+	{
+		UE_LOG(LogGameMode, Warning, TEXT("SpawnDefaultPawnAtTransform: Couldn't spawn Pawn of type %s at %s"), *GetNameSafe(PawnClass), *SpawnTransform.ToHumanReadableString());
+	}
+
+	return ResultPawn;
+}
+
 void AMultiplayerExampleGameMode::HandleMatchHasStarted()
 {
 	GameSession->HandleMatchHasStarted();
@@ -0,0 +1,204 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Core/MGameEngine.h"
+
+#include "Engine/NetDriver.h"
+#include "IpNetDriver.h"
+#include "Misc/App.h"
+#include "Sockets.h"
+
+UMGameEngine::FServerIdleChanged UMGameEngine::ServerIdleChangedEvent;
+
+static FAutoConsoleCommand DumpServerTickStatsCommand(
+	TEXT("MP.Server.TickStats"),
+	TEXT("Logs the dedicated server tick rate and CPU usage while idle and active"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		if (const UMGameEngine* Engine = Cast<UMGameEngine>(GEngine))
+		{
+			Engine->DumpServerTickStats();
+		}
+	}));
+
+UMGameEngine::UMGameEngine()
+{
+	ServerTickRate = 30.f;
+	IdleServerTickRate = 1.f;
+	IdleDelay = 10.f;
+	StatusWakeSeconds = 2.f;
+}
+
+void UMGameEngine::Tick(const float DeltaSeconds, const bool bIdleMode)
+{
+	Super::Tick(DeltaSeconds, bIdleMode);
+
+	if (!IsRunningDedicatedServer())
+	{
+		return;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	if (GetNumConnections() > 0)
+	{
+		NoConnectionsSince = 0.0;
+		if (bServerIdle)
+		{
+			SetServerIdle(false);
+		}
+	}
+	else
+	{
+		if (NoConnectionsSince == 0.0)
+		{
+			NoConnectionsSince = Now;
+		}
+
+		if (!bServerIdle && Now - NoConnectionsSince >= IdleDelay)
+		{
+			SetServerIdle(true);
+		}
+	}
+
+	const float CpuPercent = FPlatformTime::GetCPUTime().CPUTimePct;
+	if (bServerIdle)
+	{
+		TickStats.IdleSeconds += DeltaSeconds;
+		TickStats.IdleCpuPercent += (CpuPercent - TickStats.IdleCpuPercent) * DeltaSeconds / FMath::Max(TickStats.IdleSeconds, KINDA_SMALL_NUMBER);
+	}
+	else
+	{
+		TickStats.ActiveSeconds += DeltaSeconds;
+		TickStats.ActiveCpuPercent += (CpuPercent - TickStats.ActiveCpuPercent) * DeltaSeconds / FMath::Max(TickStats.ActiveSeconds, KINDA_SMALL_NUMBER);
+	}
+
+	TickStats.bIdle = bServerIdle;
+	TickStats.TickRate = bServerIdle ? IdleServerTickRate : ServerTickRate;
+}
+
+float UMGameEngine::GetMaxTickRate(const float DeltaTime, const bool bAllowFrameRateSmoothing) const
+{
+	if (!IsRunningDedicatedServer() || ServerTickRate <= 0.f)
+	{
+		return Super::GetMaxTickRate(DeltaTime, bAllowFrameRateSmoothing);
+	}
+
+	// A packet ended the idle wait, tick now rather than sleeping out the rest of the idle period
+	if (IsIdleWaiting() && !bWokenByPacket)
+	{
+		return IdleServerTickRate;
+	}
+
+	return ServerTickRate;
+}
+
+void UMGameEngine::UpdateTimeAndHandleMaxTickRate()
+{
+	bWokenByPacket = false;
+	bLastWaitWasIdle = IsRunningDedicatedServer() && IsIdleWaiting();
+
+	if (bLastWaitWasIdle)
+	{
+		const double Remaining = 1.0 / IdleServerTickRate - (FPlatformTime::Seconds() - FApp::GetCurrentTime());
+		if (Remaining > 0.0 && WaitForPacket(Remaining))
+		{
+			bWokenByPacket = true;
+			++TickStats.PacketWakeUps;
+		}
+	}
+
+	Super::UpdateTimeAndHandleMaxTickRate();
+}
+
+bool UMGameEngine::IsIdleWaiting() const
+{
+	return bServerIdle && IdleServerTickRate > 0.f && FPlatformTime::Seconds() >= StatusAwakeUntil;
+}
+
+void UMGameEngine::NotifyStatusRequest()
+{
+	if (IsIdleWaiting())
+	{
+		++TickStats.StatusWakeUps;
+	}
+
+	StatusAwakeUntil = FPlatformTime::Seconds() + StatusWakeSeconds;
+}
+
+float UMGameEngine::GetStatusIdleWaitMs() const
+{
+	return bLastWaitWasIdle ? 1000.f / IdleServerTickRate : 0.f;
+}
+
+int32 UMGameEngine::GetNumConnections() const
+{
+	const UWorld* World = GetGameWorld();
+	const UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+	return NetDriver ? NetDriver->ClientConnections.Num() : 0;
+}
+
+void UMGameEngine::SetServerIdle(const bool bIdle)
+{
+	bServerIdle = bIdle;
+
+	if (bIdle)
+	{
+		++TickStats.IdleTransitions;
+		UE_LOG(LogTemp, Log, TEXT("No players for %.0fs, server ticking at %.1fHz"), IdleDelay, IdleServerTickRate);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Log, TEXT("Player connected, server ticking at %.1fHz"), ServerTickRate);
+	}
+
+	ServerIdleChangedEvent.Broadcast(bIdle);
+
+	// After listeners released their pools, so the freed memory goes back to the OS as well
+	if (bIdle)
+	{
+		GMalloc->Trim(true);
+	}
+}
+
+bool UMGameEngine::WaitForPacket(const double Seconds) const
+{
+	const UWorld* World = GetGameWorld();
+	UIpNetDriver* NetDriver = World ? Cast<UIpNetDriver>(World->GetNetDriver()) : nullptr;
+	FSocket* Socket = NetDriver ? NetDriver->GetSocket() : nullptr;
+	if (!Socket)
+	{
+		return false;
+	}
+
+	return Socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromSeconds(Seconds));
+}
+
+void UMGameEngine::DumpServerTickStats() const
+{
+	UE_LOG(LogTemp, Display, TEXT("Server tick: %s at %.1fHz, %d idle transitions, %d packet wake ups, %d status wake ups"),
+	       TickStats.bIdle ? TEXT("idle") : TEXT("active"), TickStats.TickRate, TickStats.IdleTransitions, TickStats.PacketWakeUps,
+	       TickStats.StatusWakeUps);
+	UE_LOG(LogTemp, Display, TEXT("  idle %.0fs at %.2f%% CPU, active %.0fs at %.2f%% CPU"), TickStats.IdleSeconds, TickStats.IdleCpuPercent,
+	       TickStats.ActiveSeconds, TickStats.ActiveCpuPercent);
+}
@@ -24,6 +24,11 @@
 
 #include "Core/MGameInstance.h"
 
+#include "Core/HttpApi.h"
+#include "Interfaces/IHttpResponse.h"
+#include "Misc/PackageName.h"
+#include "UObject/UObjectGlobals.h"
+
 namespace MGameInstanceState
 {
 	const FName STATE_Login = FName(TEXT("STATE_LoginScreen"));
@@ -53,9 +58,198 @@ void UMGameInstance::SetDebugModeEnabled(const bool bNewDebug)
 	bDebugEnabled = bNewDebug;
 }
 
-void UMGameInstance::UpdateCharacterList(const FCharacterData& NewCharacter)
+FCharacterHandle UMGameInstance::UpdateCharacterList(const FCharacterData& NewCharacter)
+{
+	return Characters.AddOrUpdate(NewCharacter);
+}
+
+bool UMGameInstance::K2_FindCharacter(const FString& CharacterID, FCharacterData& OutCharacter) const
+{
+	if (const FCharacterData* Character = Characters.Find(CharacterID))
+	{
+		OutCharacter = *Character;
+		return true;
+	}
+
+	return false;
+}
+
+void UMGameInstance::FetchCharacterList()
+{
+#if !UE_SERVER
+	if (CharacterListFetch == ECharacterListFetch::InFlight)
+	{
+		return;
+	}
+
+	// Waiters such as UAsync_GetCharacters only complete on the broadcast
+	if (!LoginToken.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Can't fetch the character list without a valid login"));
+		FinishCharacterListFetch(false);
+		return;
+	}
+
+	CharacterListFetch = ECharacterListFetch::InFlight;
+
+	if (bCharacterSyncUnavailable)
+	{
+		FetchFullCharacterList();
+	}
+	else
+	{
+		SyncCharacterList();
+	}
+#endif
+}
+
+void UMGameInstance::SyncCharacterList()
+{
+#if !UE_SERVER
+	UHttpAPI* API = GetSubsystem<UHttpAPI>();
+	if (!API)
+	{
+		FinishCharacterListFetch(false);
+		return;
+	}
+
+	// Only the characters that changed since our cached revision come back
+	URequest* Request = API->CreateNewRequest(TEXT("syncCharacters"));
+	API->SetHeaders(Request);
+	API->SetAuthHeader(Request, LoginToken.IdToken);
+	const FSyncCharactersRequest SyncRequest(Characters.GetRevision());
+	API->POST<FSyncCharactersRequest>(Request, &SyncRequest);
+
+	if (IsDebugMode())
+	{
+		UHttpAPI::DebugRequest(Request);
+	}
+
+	UHttpAPI::BindLambdaResponse(Request, [this](FHttpRequestPtr, FHttpResponsePtr Response, bool bSuccess)
+	{
+		if (IsDebugMode())
+		{
+			UHttpAPI::DebugResponse(Response);
+		}
+
+		// The player logged out while the request was in flight
+		if (CharacterListFetch != ECharacterListFetch::InFlight)
+		{
+			return;
+		}
+
+		bool bValid = false;
+		if (bSuccess && UHttpAPI::ValidateResponse(Response))
+		{
+			FSyncCharactersResponse Sync;
+			TSharedPtr<FJsonObject> JsonObject = MakeShareable(new FJsonObject);
+			const TSharedRef<TJsonReader<TCHAR>> JsonReader = TJsonReaderFactory<TCHAR>::Create(Response->GetContentAsString());
+			if (FJsonSerializer::Deserialize(JsonReader, JsonObject) && JsonObject.IsValid())
+			{
+				const TSharedPtr<FJsonObject> Obj = JsonObject->GetObjectField(TEXT("data"));
+				bValid = Obj.IsValid() && FJsonObjectConverter::JsonObjectToUStruct<FSyncCharactersResponse>(Obj.ToSharedRef(), &Sync, 0, 0);
+			}
+
+			// A delta older than what we have arrived late, the store is already ahead of it
+			const bool bApplied = bValid && Characters.ApplyDelta(Sync.changed, Sync.removed, Sync.revision, Sync.full);
+			if (IsDebugMode() && bValid)
+			{
+				UE_LOG(LogTemp, Display, TEXT("Synced characters to revision %lld (full %d, %d changed, %d removed, applied %d)"),
+				       Sync.revision, Sync.full, Sync.changed.Num(), Sync.removed.Num(), bApplied);
+			}
+		}
+
+		if (bValid)
+		{
+			FinishCharacterListFetch(true);
+			return;
+		}
+
+		// Whatever the backend answered, it will answer the same next time. Only a request that never got a response is
+		// worth another sync, everything else uses getAllCharacters for the rest of the session.
+		if (Response.IsValid())
+		{
+			bCharacterSyncUnavailable = true;
+		}
+
+		UE_LOG(LogTemp, Warning, TEXT("Character sync failed with %d, falling back to the full character list"),
+		       Response.IsValid() ? Response->GetResponseCode() : 0);
+		FetchFullCharacterList();
+	});
+#endif
+}
+
+void UMGameInstance::FetchFullCharacterList()
+{
+#if !UE_SERVER
+	UHttpAPI* API = GetSubsystem<UHttpAPI>();
+	if (!API)
+	{
+		FinishCharacterListFetch(false);
+		return;
+	}
+
+	URequest* Request = API->CreateNewRequest(TEXT("getAllCharacters"));
+	API->SetHeaders(Request);
+	API->SetAuthHeader(Request, LoginToken.IdToken);
+	API->GET(Request);
+
+	if (IsDebugMode())
+	{
+		UHttpAPI::DebugRequest(Request);
+	}
+
+	UHttpAPI::BindLambdaResponse(Request, [this](FHttpRequestPtr, FHttpResponsePtr Response, bool bSuccess)
+	{
+		if (IsDebugMode())
+		{
+			UHttpAPI::DebugResponse(Response);
+		}
+
+		if (CharacterListFetch != ECharacterListFetch::InFlight)
+		{
+			return;
+		}
+
+		const bool bValid = bSuccess && UHttpAPI::ValidateResponse(Response);
+		if (bValid)
+		{
+			TArray<FCharacterData> NewList;
+			TSharedPtr<FJsonObject> JsonObject = MakeShareable(new FJsonObject);
+			const TSharedRef<TJsonReader<TCHAR>> JsonReader = TJsonReaderFactory<TCHAR>::Create(Response->GetContentAsString());
+			if (FJsonSerializer::Deserialize(JsonReader, JsonObject) && JsonObject.IsValid())
+			{
+				const TArray<TSharedPtr<FJsonValue>> ObjArray = JsonObject->GetArrayField(TEXT("data"));
+				FJsonObjectConverter::JsonArrayToUStruct(ObjArray, &NewList, 0, 0);
+			}
+
+			// Assign diffs the full list against the cache locally, so widgets still only see the characters that changed.
+			// The list carries no revision, the next sync has to start from scratch.
+			Characters.Assign(NewList);
+			Characters.SetRevision(0);
+		}
+
+		FinishCharacterListFetch(bValid);
+	});
+#endif
+}
+
+void UMGameInstance::FinishCharacterListFetch(const bool bSuccessful)
 {
-	CharacterList.Add(NewCharacter);
+	CharacterListFetch = bSuccessful ? ECharacterListFetch::Ready : ECharacterListFetch::Failed;
+	OnCharacterListFetched.Broadcast(bSuccessful);
+}
+
+bool UMGameInstance::ConsumePrefetchedCharacterList(bool& bOutSuccessful)
+{
+	if (CharacterListFetch == ECharacterListFetch::Ready || CharacterListFetch == ECharacterListFetch::Failed)
+	{
+		bOutSuccessful = CharacterListFetch == ECharacterListFetch::Ready;
+		CharacterListFetch = ECharacterListFetch::Idle;
+		return true;
+	}
+
+	return false;
 }
 
 void UMGameInstance::LogoutAndReturnToMenu()
@@ -108,8 +302,21 @@ void UMGameInstance::Init()
 
 	InitialState = MGameInstanceState::STATE_Login;
 
-	CharacterList.Empty();
+	Characters.Reset();
+	CharacterListFetch = ECharacterListFetch::Idle;
 	LoginToken = FLoginResponse();
+
+	// The stock backend has no syncCharacters route, asking it would cost every session a failed round trip
+	bool bCharacterSync = false;
+	FConfigFile GameConfig;
+	if (FConfigCacheIni::LoadLocalIniFile(GameConfig, TEXT("DefaultGame"), false))
+	{
+		GameConfig.GetBool(TEXT("CharacterSync"), TEXT("bEnabled"), bCharacterSync);
+	}
+
+	bCharacterSyncUnavailable = !bCharacterSync;
+
+	FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(this, &ThisClass::OnPostLoadMap);
 }
 
 void UMGameInstance::ChangeState(FName State)
@@ -141,6 +348,10 @@ void UMGameInstance::BeginNewState()
 	{
 		BeginCharacterSelectState();
 	}
+	else if (PendingState == MGameInstanceState::STATE_Playing)
+	{
+		BeginPlayingState();
+	}
 
 	CurrentState = PendingState;
 }
@@ -151,23 +362,11 @@ void UMGameInstance::BeginLoginState()
 	if (!IsInMenus())
 	{
 		LoginToken = FLoginResponse();
-		CharacterList.Empty();
-		
-		UWorld* const World = GetWorld();
-		check(World);
+		Characters.Reset();
+		CharacterListFetch = ECharacterListFetch::Idle;
 
-		UNetDriver* NetDriver = World->GetNetDriver();
-		if (NetDriver)
-		{
-			const FString TravelURL = GetMenuMap(EMenuMap::Login);
-			GEngine->HandleDisconnect(World, NetDriver);
-			NotifyPreClientTravel(TravelURL, ETravelType::TRAVEL_Absolute, false);
-			GEngine->SetClientTravel(World, *TravelURL, ETravelType::TRAVEL_Absolute);
-		}
-		else
-		{
-			UE_LOG(LogNet, Fatal, TEXT("Failed to get the games NetDriver--Couldn't client travel"));
-		}
+		// Nothing to wait for on the backend, the disconnect happens once the login map is in memory
+		BeginTransition(MGameInstanceState::STATE_Login, GetMenuMap(EMenuMap::Login), GetMenuMap(EMenuMap::Login), true);
 	}
 #endif
 }
@@ -180,8 +379,14 @@ void UMGameInstance::BeginCharacterSelectState()
 	{
 		if (LoginToken.IsValid())
 		{
-			NotifyPreClientTravel(TravelURL, ETravelType::TRAVEL_Absolute, false);
-			GEngine->SetClientTravel(GetWorld(), *TravelURL, ETravelType::TRAVEL_Absolute);
+			// The character list is usually already in flight from the login, travel once both it and the map are ready
+			const bool bBackendReady = !IsFetchingCharacterList();
+			if (!bBackendReady)
+			{
+				OnCharacterListFetched.AddUObject(this, &ThisClass::OnTransitionCharacterListFetched);
+			}
+
+			BeginTransition(MGameInstanceState::STATE_CharacterSelect, TravelURL, TravelURL, bBackendReady);
 		}
 		else
 		{
@@ -191,6 +396,229 @@ void UMGameInstance::BeginCharacterSelectState()
 #endif
 }
 
+void UMGameInstance::BeginPlayingState()
+{
+#if !UE_SERVER
+	// The server address is filled in by TravelToServer once a server has been picked
+	BeginTransition(MGameInstanceState::STATE_Playing, GetGameMap(), TEXT(""), false);
+#endif
+}
+
+void UMGameInstance::TravelToServer(const FString& ServerAddress)
+{
+	if (CurrentState != MGameInstanceState::STATE_Playing || Transition.State != MGameInstanceState::STATE_Playing)
+	{
+		GotoStateFast(MGameInstanceState::STATE_Playing);
+	}
+
+	Transition.TravelURL = ServerAddress;
+	NotifyTransitionBackendReady();
+}
+
+void UMGameInstance::PrepareToPlay()
+{
+	const FString Map = GetGameMap();
+
+	PreparedPlay = FPendingTransition();
+	PreparedPlay.State = MGameInstanceState::STATE_Playing;
+	PreparedPlay.MapPackage = GetMapPackageName(Map);
+	PreparedPlay.StartTime = FPlatformTime::Seconds();
+
+	if (PreparedPlay.MapPackage.IsNone() || IsMapPreloaded(PreparedPlay.MapPackage))
+	{
+		PreparedPlay.MapReadyTime = PreparedPlay.StartTime;
+	}
+	else
+	{
+		PreloadMap(Map);
+	}
+}
+
+void UMGameInstance::PreloadMap(const FString& Map)
+{
+	const FName PackageName = GetMapPackageName(Map);
+	if (PackageName.IsNone() || PendingMapLoads.Contains(PackageName) || IsMapPreloaded(PackageName))
+	{
+		return;
+	}
+
+	PendingMapLoads.Add(PackageName);
+	LoadPackageAsync(PackageName.ToString(), FLoadPackageAsyncDelegate::CreateUObject(this, &ThisClass::OnMapPreloaded));
+}
+
+FString UMGameInstance::GetGameMap()
+{
+	FString ServerDefaultMap;
+	GConfig->GetString(TEXT("/Script/EngineSettings.GameMapsSettings"), TEXT("ServerDefaultMap"), ServerDefaultMap, GEngineIni);
+	return FPackageName::ObjectPathToPackageName(ServerDefaultMap);
+}
+
+void UMGameInstance::BeginTransition(const FName State, const FString& Map, const FString& TravelURL, const bool bBackendReady)
+{
+	Transition = FPendingTransition();
+	Transition.State = State;
+	Transition.MapPackage = GetMapPackageName(Map);
+	Transition.TravelURL = TravelURL;
+	Transition.StartTime = FPlatformTime::Seconds();
+
+	// Picks up a preload and server lookup that started before the state changed
+	if (PreparedPlay.IsActive() && PreparedPlay.State == State && PreparedPlay.MapPackage == Transition.MapPackage)
+	{
+		Transition.StartTime = PreparedPlay.StartTime;
+		Transition.MapReadyTime = PreparedPlay.MapReadyTime;
+	}
+	PreparedPlay = FPendingTransition();
+
+	if (bBackendReady)
+	{
+		Transition.BackendReadyTime = Transition.StartTime;
+	}
+
+	if (Transition.MapReadyTime == 0.0)
+	{
+		if (Transition.MapPackage.IsNone() || IsMapPreloaded(Transition.MapPackage))
+		{
+			Transition.MapReadyTime = Transition.StartTime;
+		}
+		else
+		{
+			PreloadMap(Map);
+		}
+	}
+
+	TryCommitTransition();
+}
+
+void UMGameInstance::NotifyTransitionBackendReady()
+{
+	if (Transition.IsActive() && Transition.BackendReadyTime == 0.0)
+	{
+		Transition.BackendReadyTime = FPlatformTime::Seconds();
+		TryCommitTransition();
+	}
+}
+
+void UMGameInstance::TryCommitTransition()
+{
+	if (Transition.IsActive() && Transition.MapReadyTime > 0.0 && Transition.BackendReadyTime > 0.0)
+	{
+		CommitTransition();
+	}
+}
+
+void UMGameInstance::CommitTransition()
+{
+	const FPendingTransition Committed = Transition;
+	Transition = FPendingTransition();
+
+	LastTransitionTimings.State = Committed.State;
+	LastTransitionTimings.MapLoadSeconds = Committed.MapReadyTime - Committed.StartTime;
+	LastTransitionTimings.BackendSeconds = Committed.BackendReadyTime - Committed.StartTime;
+	LastTransitionTimings.TotalSeconds = FPlatformTime::Seconds() - Committed.StartTime;
+
+	UE_LOG(LogTemp, Log, TEXT("Transition to %s committed after %.3fs (map load %.3fs, backend %.3fs)"),
+	       *Committed.State.ToString(), LastTransitionTimings.TotalSeconds, LastTransitionTimings.MapLoadSeconds,
+	       LastTransitionTimings.BackendSeconds);
+
+	UWorld* const World = GetWorld();
+	check(World);
+
+	if (Committed.State == MGameInstanceState::STATE_Playing)
+	{
+		if (APlayerController* PC = GetFirstLocalPlayerController(World))
+		{
+			PC->ClientTravel(Committed.TravelURL, ETravelType::TRAVEL_Absolute, false);
+		}
+		return;
+	}
+
+	if (Committed.State == MGameInstanceState::STATE_Login)
+	{
+		UNetDriver* NetDriver = World->GetNetDriver();
+		if (!NetDriver)
+		{
+			UE_LOG(LogNet, Fatal, TEXT("Failed to get the games NetDriver--Couldn't client travel"));
+			return;
+		}
+
+		GEngine->HandleDisconnect(World, NetDriver);
+	}
+
+	NotifyPreClientTravel(Committed.TravelURL, ETravelType::TRAVEL_Absolute, false);
+	GEngine->SetClientTravel(World, *Committed.TravelURL, ETravelType::TRAVEL_Absolute);
+}
+
+void UMGameInstance::OnMapPreloaded(const FName& PackageName, UPackage* LoadedPackage, EAsyncLoadingResult::Type Result)
+{
+	PendingMapLoads.Remove(PackageName);
+
+	if (Result == EAsyncLoadingResult::Succeeded && LoadedPackage)
+	{
+		PreloadedMaps.AddUnique(LoadedPackage);
+	}
+	else
+	{
+		// The travel will fall back to a blocking load
+		UE_LOG(LogTemp, Warning, TEXT("Failed to preload %s"), *PackageName.ToString());
+	}
+
+	if (PreparedPlay.IsActive() && PreparedPlay.MapPackage == PackageName && PreparedPlay.MapReadyTime == 0.0)
+	{
+		PreparedPlay.MapReadyTime = FPlatformTime::Seconds();
+	}
+
+	if (Transition.IsActive() && Transition.MapPackage == PackageName && Transition.MapReadyTime == 0.0)
+	{
+		Transition.MapReadyTime = FPlatformTime::Seconds();
+		TryCommitTransition();
+	}
+}
+
+void UMGameInstance::OnPostLoadMap(UWorld* LoadedWorld)
+{
+	// The engine owns the new world now, holding on to any preloaded map past this point would leak it on the next travel
+	PreloadedMaps.Reset();
+}
+
+void UMGameInstance::OnTransitionCharacterListFetched(bool bSuccessful)
+{
+	OnCharacterListFetched.RemoveAll(this);
+
+	if (Transition.State == MGameInstanceState::STATE_CharacterSelect)
+	{
+		NotifyTransitionBackendReady();
+	}
+}
+
+bool UMGameInstance::IsMapPreloaded(const FName PackageName) const
+{
+	return PreloadedMaps.ContainsByPredicate([PackageName](const UPackage* Package)
+	{
+		return Package && Package->GetFName() == PackageName;
+	});
+}
+
+FName UMGameInstance::GetMapPackageName(const FString& Map)
+{
+	if (Map.IsEmpty())
+	{
+		return NAME_None;
+	}
+
+	if (!FPackageName::IsShortPackageName(Map))
+	{
+		return FName(*Map);
+	}
+
+	FString LongPackageName;
+	if (FPackageName::SearchForPackageOnDisk(Map, &LongPackageName))
+	{
+		return FName(*LongPackageName);
+	}
+
+	return NAME_None;
+}
+
 void UMGameInstance::EndLoginScreenState()
 {
 #if !UE_SERVER
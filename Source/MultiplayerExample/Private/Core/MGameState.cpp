@@ -22,4 +22,75 @@
 * SOFTWARE.
 **/
 
-#include "Core/MGameState.h"
\ No newline at end of file
+#include "Core/MGameState.h"
+
+#include "Misc/App.h"
+#include "Net/UnrealNetwork.h"
+#include "Player/MPlayerController.h"
+
+AMGameState::AMGameState()
+{
+	ServerWorldTimeSecondsUpdateFrequency = 5.f;
+	EpochDriftThreshold = 0.05f;
+}
+
+void AMGameState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AMGameState, ServerRealTimeEpoch);
+}
+
+void AMGameState::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (HasAuthority())
+	{
+		UpdateServerRealTimeEpoch();
+	}
+}
+
+void AMGameState::UpdateServerTimeSeconds()
+{
+	Super::UpdateServerTimeSeconds();
+
+	UpdateServerRealTimeEpoch();
+}
+
+void AMGameState::UpdateServerRealTimeEpoch()
+{
+	const UWorld* World = GetWorld();
+	if (!World)
+	{
+		return;
+	}
+
+	// FApp::GetCurrentTime() is the real time the frame started at, the same instant world time was advanced to
+	const double Epoch = FApp::GetCurrentTime() - World->GetTimeSeconds();
+	if (ServerRealTimeEpoch == 0.0 || FMath::Abs(Epoch - ServerRealTimeEpoch) > EpochDriftThreshold)
+	{
+		ServerRealTimeEpoch = Epoch;
+	}
+}
+
+double AMGameState::GetPreciseServerWorldTimeSeconds() const
+{
+	const UWorld* World = GetWorld();
+	if (World && World->GetNetMode() == NM_Client && ServerRealTimeEpoch != 0.0)
+	{
+		const auto* PC = Cast<AMPlayerController>(World->GetFirstPlayerController());
+		if (PC && PC->GetClockSync().HasEstimate())
+		{
+			// Frame start rather than FPlatformTime::Seconds() so the time stays the same for everything in the frame
+			return FApp::GetCurrentTime() + PC->GetClockSync().GetOffset() - ServerRealTimeEpoch;
+		}
+	}
+
+	return Super::GetServerWorldTimeSeconds();
+}
+
+float AMGameState::GetServerWorldTimeSeconds() const
+{
+	return GetPreciseServerWorldTimeSeconds();
+}
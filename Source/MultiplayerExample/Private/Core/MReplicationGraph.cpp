@@ -0,0 +1,285 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Core/MReplicationGraph.h"
+
+#include "Engine/LevelScriptActor.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "UObject/UObjectIterator.h"
+
+DECLARE_CYCLE_STAT(TEXT("MP ServerReplicateActors"), STAT_MReplicationGraph_ServerReplicateActors, STATGROUP_Game);
+
+namespace
+{
+	const int32 ConnectionBuckets[] = {50, 100, 200};
+	constexpr int32 NumConnectionBuckets = UE_ARRAY_COUNT(ConnectionBuckets) + 1;
+}
+
+static FAutoConsoleCommandWithWorld DumpReplicationGraphStatsCommand(
+	TEXT("MP.RepGraph.Stats"),
+	TEXT("Logs replication time per frame grouped by connection count"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+		if (const UMReplicationGraph* Graph = NetDriver ? Cast<UMReplicationGraph>(NetDriver->GetReplicationDriver()) : nullptr)
+		{
+			Graph->DumpStats();
+		}
+	}));
+
+UMReplicationGraph::UMReplicationGraph()
+{
+	GridCellSize = 10000.f;
+	SpatialBiasX = -200000.f;
+	SpatialBiasY = -200000.f;
+	PlayerStatesPerFrame = 2;
+
+	ResetStats();
+}
+
+void UMReplicationGraph::ResetStats()
+{
+	Stats = FReplicationGraphStats();
+	Stats.AverageMsByConnections.SetNumZeroed(NumConnectionBuckets);
+	Stats.FramesByConnections.SetNumZeroed(NumConnectionBuckets);
+}
+
+int32 UMReplicationGraph::GetConnectionBucket(const int32 Connections)
+{
+	for (int32 Index = 0; Index < UE_ARRAY_COUNT(ConnectionBuckets); ++Index)
+	{
+		if (Connections <= ConnectionBuckets[Index])
+		{
+			return Index;
+		}
+	}
+
+	return NumConnectionBuckets - 1;
+}
+
+void UMReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* Class = *It;
+		const AActor* ActorCDO = Cast<AActor>(Class->GetDefaultObject(false));
+		if (!ActorCDO || !ActorCDO->GetIsReplicated())
+		{
+			continue;
+		}
+
+		// Blueprint compile leftovers
+		if (Class->GetName().StartsWith(TEXT("SKEL_")) || Class->GetName().StartsWith(TEXT("REINST_")))
+		{
+			continue;
+		}
+
+		const EClassRepNodeMapping Mapping = GetMappingPolicy(Class);
+		ClassRepNodePolicies.Set(Class, Mapping);
+
+		FClassReplicationInfo ClassInfo;
+		ClassInfo.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(FMath::Max(ActorCDO->NetUpdateFrequency, 1.f));
+		if (Mapping == EClassRepNodeMapping::Spatialize_Static || Mapping == EClassRepNodeMapping::Spatialize_Dynamic)
+		{
+			ClassInfo.SetCullDistanceSquared(ActorCDO->NetCullDistanceSquared);
+		}
+
+		GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+	}
+}
+
+EClassRepNodeMapping UMReplicationGraph::GetMappingPolicy(const UClass* Class) const
+{
+	const AActor* ActorCDO = Class->GetDefaultObject<AActor>();
+
+	// Player states go through the frequency limiter and the owners own connection node instead
+	if (Class->IsChildOf(APlayerState::StaticClass()) || Class->IsChildOf(APlayerController::StaticClass()))
+	{
+		return EClassRepNodeMapping::NotRouted;
+	}
+
+	if (Class->IsChildOf(AGameModeBase::StaticClass()) || Class->IsChildOf(ALevelScriptActor::StaticClass()))
+	{
+		return EClassRepNodeMapping::NotRouted;
+	}
+
+	if (ActorCDO->bAlwaysRelevant)
+	{
+		return EClassRepNodeMapping::RelevantAllConnections;
+	}
+
+	// Nothing in the project is owner only besides controllers and player states, route it through the connection node if that changes
+	if (ActorCDO->bOnlyRelevantToOwner)
+	{
+		return EClassRepNodeMapping::NotRouted;
+	}
+
+	if (Class->IsChildOf(APawn::StaticClass()) || ActorCDO->IsReplicatingMovement())
+	{
+		return EClassRepNodeMapping::Spatialize_Dynamic;
+	}
+
+	return EClassRepNodeMapping::Spatialize_Static;
+}
+
+EClassRepNodeMapping UMReplicationGraph::GetClassNodeMapping(UClass* Class)
+{
+	// Classes loaded after init, and actors that turned on replication when their CDO does not, have no policy yet.
+	// Get falls back to the closest mapped ancestor, only classes without one are mapped from scratch.
+	if (const EClassRepNodeMapping* Mapping = ClassRepNodePolicies.Get(Class))
+	{
+		return *Mapping;
+	}
+
+	const EClassRepNodeMapping Mapping = GetMappingPolicy(Class);
+	ClassRepNodePolicies.Set(Class, Mapping);
+	return Mapping;
+}
+
+void UMReplicationGraph::InitGlobalGraphNodes()
+{
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = GridCellSize;
+	GridNode->SpatialBias = FVector2D(SpatialBiasX, SpatialBiasY);
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+
+	PlayerStateNode = CreateNewNode<UReplicationGraphNode_PlayerStateFrequencyLimiter>();
+	PlayerStateNode->TargetActorsPerFrame = FMath::Max(1, PlayerStatesPerFrame);
+	AddGlobalGraphNode(PlayerStateNode);
+}
+
+void UMReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	AddConnectionGraphNode(CreateNewNode<UMReplicationGraphNode_AlwaysRelevant_ForConnection>(), RepGraphConnection);
+}
+
+void UMReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	switch (GetClassNodeMapping(ActorInfo.Class))
+	{
+	case EClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+
+	case EClassRepNodeMapping::Spatialize_Static:
+		GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+
+	case EClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void UMReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	switch (GetClassNodeMapping(ActorInfo.Class))
+	{
+	case EClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+
+	case EClassRepNodeMapping::Spatialize_Static:
+		GridNode->RemoveActor_Static(ActorInfo);
+		break;
+
+	case EClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		break;
+
+	default:
+		break;
+	}
+}
+
+int32 UMReplicationGraph::ServerReplicateActors(const float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MReplicationGraph_ServerReplicateActors);
+
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 Result = Super::ServerReplicateActors(DeltaSeconds);
+	const float FrameMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	Stats.Connections = Connections.Num();
+
+	const int32 Bucket = GetConnectionBucket(Stats.Connections);
+	float& Average = Stats.AverageMsByConnections[Bucket];
+	Average += (FrameMs - Average) / ++Stats.FramesByConnections[Bucket];
+
+	return Result;
+}
+
+void UMReplicationGraph::SetActorUpdateFrequency(AActor* Actor, const float Frequency)
+{
+	if (FGlobalActorReplicationInfo* GlobalInfo = GlobalActorReplicationInfoMap.Find(Actor))
+	{
+		GlobalInfo->Settings.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(FMath::Max(Frequency, 1.f));
+	}
+}
+
+void UMReplicationGraph::DumpStats() const
+{
+	UE_LOG(LogTemp, Display, TEXT("Replication graph: %d connections, grid cell %.0f, %d player states per frame"), Stats.Connections,
+	       GridCellSize, PlayerStatesPerFrame);
+
+	for (int32 Bucket = 0; Bucket < NumConnectionBuckets; ++Bucket)
+	{
+		FString Label = FString::Printf(TEXT("> %d"), ConnectionBuckets[UE_ARRAY_COUNT(ConnectionBuckets) - 1]);
+		if (Bucket < UE_ARRAY_COUNT(ConnectionBuckets))
+		{
+			Label = FString::Printf(TEXT("<= %d"), ConnectionBuckets[Bucket]);
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("  %-6s connections: %8d frames, avg %.3fms"), *Label, Stats.FramesByConnections[Bucket],
+		       Stats.AverageMsByConnections[Bucket]);
+	}
+}
+
+void UMReplicationGraphNode_AlwaysRelevant_ForConnection::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	ReplicationActorList.Reset();
+
+	if (APlayerController* PC = Params.ConnectionManager.NetConnection->PlayerController)
+	{
+		ReplicationActorList.ConditionalAdd(PC);
+		ReplicationActorList.ConditionalAdd(PC->PlayerState);
+	}
+
+	Params.OutGatheredReplicationLists.AddReplicationActorList(ReplicationActorList);
+}
@@ -0,0 +1,364 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Core/MovementBenchmark.h"
+
+#include "Core/CharacterSignificance.h"
+#include "EngineUtils.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerStart.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Player/MCharacterMovementComponent.h"
+#include "Player/MPlayerCharacter.h"
+
+TSharedPtr<FMovementBenchmark> FMovementBenchmark::Running;
+
+static FAutoConsoleCommandWithWorldAndArgs RunMovementBenchmarkCommand(
+	TEXT("MP.Bench.Movement"),
+	TEXT("Spawns characters driven by seeded synthetic input and records per frame movement cost to Saved/Benchmarks. Usage: MP.Bench.Movement [Characters=500] [Frames=600] [Seed=1] [LOD=-1]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		FMovementBenchmarkParams Params;
+		Params.Characters = Args.Num() > 0 ? FMath::Clamp(FCString::Atoi(*Args[0]), 1, 5000) : Params.Characters;
+		Params.Frames = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : Params.Frames;
+		Params.Seed = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : Params.Seed;
+		Params.ForcedLOD = Args.Num() > 3 ? FCString::Atoi(*Args[3]) : Params.ForcedLOD;
+
+		FMovementBenchmark::Start(World, Params);
+	}));
+
+namespace
+{
+	float GetPercentile(TArray<float> Values, const float Percentile)
+	{
+		if (Values.Num() == 0)
+		{
+			return 0.f;
+		}
+
+		Values.Sort();
+		return Values[FMath::Clamp(FMath::FloorToInt(Percentile * (Values.Num() - 1)), 0, Values.Num() - 1)];
+	}
+
+	float GetAverage(const TArray<float>& Values)
+	{
+		float Sum = 0.f;
+		for (const float Value : Values)
+		{
+			Sum += Value;
+		}
+
+		return Values.Num() > 0 ? Sum / Values.Num() : 0.f;
+	}
+}
+
+bool FMovementBenchmark::Start(UWorld* World, const FMovementBenchmarkParams& Params, const FOnFinished& OnFinished)
+{
+	if (Running.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Movement benchmark already running"));
+		return false;
+	}
+
+	if (!World || World->GetNetMode() == NM_Client)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Movement benchmark needs a server or standalone world"));
+		return false;
+	}
+
+	TSharedRef<FMovementBenchmark> Benchmark = MakeShareable(new FMovementBenchmark(World, Params));
+	if (!Benchmark->Spawn())
+	{
+		return false;
+	}
+
+	Benchmark->OnFinished = OnFinished;
+	Benchmark->TickHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateSP(Benchmark, &FMovementBenchmark::Tick));
+	Running = Benchmark;
+	return true;
+}
+
+FMovementBenchmark::FMovementBenchmark(UWorld* InWorld, const FMovementBenchmarkParams& InParams)
+	: World(InWorld)
+	, Params(InParams)
+{
+}
+
+FMovementBenchmark::~FMovementBenchmark()
+{
+	UMCharacterMovementComponent::SetCollectTickTime(false);
+}
+
+bool FMovementBenchmark::Spawn()
+{
+	UClass* CharacterClass = AMultiplayerExampleCharacter::StaticClass();
+	if (const AGameModeBase* GameMode = World->GetAuthGameMode())
+	{
+		if (GameMode->DefaultPawnClass && GameMode->DefaultPawnClass->IsChildOf(AMultiplayerExampleCharacter::StaticClass()))
+		{
+			CharacterClass = GameMode->DefaultPawnClass;
+		}
+	}
+
+	FVector Origin = FVector::ZeroVector;
+	for (TActorIterator<APlayerStart> It(World.Get()); It; ++It)
+	{
+		Origin = It->GetActorLocation();
+		break;
+	}
+
+	UsedPhysicalBeforeSpawn = FPlatformMemory::GetStats().UsedPhysical;
+	const double StartTime = FPlatformTime::Seconds();
+
+	// Square grid with room between capsules so nobody starts out blocked
+	constexpr float Spacing = 250.f;
+	const int32 Columns = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(Params.Characters)));
+
+	FActorSpawnParameters SpawnInfo;
+	SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+	SpawnInfo.ObjectFlags |= RF_Transient;
+
+	Bots.Reserve(Params.Characters);
+	for (int32 Index = 0; Index < Params.Characters; ++Index)
+	{
+		const FVector Offset((Index % Columns - Columns / 2) * Spacing, (Index / Columns - Columns / 2) * Spacing, 0.f);
+		auto* Character = World->SpawnActor<AMultiplayerExampleCharacter>(CharacterClass, Origin + Offset, FRotator::ZeroRotator, SpawnInfo);
+		if (!Character)
+		{
+			continue;
+		}
+
+		Character->SpawnDefaultController();
+
+		if (Params.ForcedLOD != INDEX_NONE)
+		{
+			FCharacterSignificance::Unregister(Character);
+			Character->SetMovementLOD(Params.ForcedLOD);
+		}
+
+		FBot& Bot = Bots.AddDefaulted_GetRef();
+		Bot.Character = Character;
+		Bot.Input = FMovementBotInput(Params.Seed, Index);
+	}
+
+	SpawnSeconds = FPlatformTime::Seconds() - StartTime;
+	UsedPhysicalAfterSpawn = FPlatformMemory::GetStats().UsedPhysical;
+
+	if (Bots.Num() == 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Movement benchmark could not spawn any %s"), *CharacterClass->GetName());
+		return false;
+	}
+
+	Samples.Reserve(Params.Frames);
+	UMCharacterMovementComponent::SetCollectTickTime(true);
+
+	UE_LOG(LogTemp, Display, TEXT("Movement benchmark: spawned %d %s in %.1fms, seed %d, running %d + %d frames"), Bots.Num(),
+	       *CharacterClass->GetName(), SpawnSeconds * 1000.0, Params.Seed, Params.WarmupFrames, Params.Frames);
+	return true;
+}
+
+bool FMovementBenchmark::Tick(float DeltaTime)
+{
+	if (!World.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Movement benchmark world went away after %d frames"), Frame);
+		Finish();
+		return false;
+	}
+
+	// Covers the world tick since the previous call, GGameThreadTime is the last complete frame
+	const float MovementMs = UMCharacterMovementComponent::ConsumeTickSeconds() * 1000.0;
+	if (Frame > Params.WarmupFrames)
+	{
+		FFrameSample& Sample = Samples.AddDefaulted_GetRef();
+		Sample.GameThreadMs = FPlatformTime::ToMilliseconds(GGameThreadTime);
+		Sample.MovementMs = MovementMs;
+		Sample.UsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+
+		for (const FBot& Bot : Bots)
+		{
+			Sample.Characters += Bot.Character.IsValid() ? 1 : 0;
+		}
+	}
+
+	if (Samples.Num() >= Params.Frames)
+	{
+		Finish();
+		return false;
+	}
+
+	DriveInput();
+	++Frame;
+	return true;
+}
+
+void FMovementBotInput::Advance(const int32 Frame)
+{
+	// Changes are keyed on frame numbers so a run does not depend on how long frames took
+	if (Frame < NextChangeFrame)
+	{
+		return;
+	}
+
+	NextChangeFrame = Frame + Stream.RandRange(30, 120);
+
+	// Idle, forward, strafe or diagonal, with the occasional jump
+	switch (Stream.RandRange(0, 3))
+	{
+	case 0: Input = FVector::ZeroVector; break;
+	case 1: Input = FVector(Stream.FRandRange(-1.f, 1.f) < 0.f ? -1.f : 1.f, 0.f, 0.f); break;
+	case 2: Input = FVector(0.f, Stream.FRandRange(-1.f, 1.f) < 0.f ? -1.f : 1.f, 0.f); break;
+	default: Input = FVector(Stream.FRandRange(-1.f, 1.f), Stream.FRandRange(-1.f, 1.f), 0.f); break;
+	}
+
+	bJump = Stream.FRand() < 0.25f;
+}
+
+void FMovementBotInput::Apply(ACharacter* Character, const int32 Frame)
+{
+	Advance(Frame);
+
+	Character->StopJumping();
+	if (bJump)
+	{
+		Character->Jump();
+		bJump = false;
+	}
+
+	if (!Input.IsNearlyZero())
+	{
+		Character->AddMovementInput(Input.GetClampedToMaxSize(1.f));
+	}
+}
+
+void FMovementBenchmark::DriveInput()
+{
+	for (FBot& Bot : Bots)
+	{
+		if (ACharacter* Character = Bot.Character.Get())
+		{
+			Bot.Input.Apply(Character, Frame);
+		}
+	}
+}
+
+void FMovementBenchmark::Finish()
+{
+	FTicker::GetCoreTicker().RemoveTicker(TickHandle);
+	UMCharacterMovementComponent::SetCollectTickTime(false);
+
+	const FMovementBenchmarkResult Result = Summarize();
+	WriteResults(Result);
+
+	for (const FBot& Bot : Bots)
+	{
+		if (ACharacter* Character = Bot.Character.Get())
+		{
+			if (AController* Controller = Character->GetController())
+			{
+				Controller->Destroy();
+			}
+
+			Character->Destroy();
+		}
+	}
+
+	Bots.Reset();
+
+	// The ticker delegate keeps this alive until Tick returns
+	Running.Reset();
+
+	// After Running is cleared, so OnFinished can start the next run
+	if (Samples.Num() >= Params.Frames)
+	{
+		OnFinished.ExecuteIfBound(Result);
+	}
+}
+
+FMovementBenchmarkResult FMovementBenchmark::Summarize() const
+{
+	TArray<float> GameThreadMs;
+	TArray<float> MovementMs;
+	for (const FFrameSample& Sample : Samples)
+	{
+		GameThreadMs.Add(Sample.GameThreadMs);
+		MovementMs.Add(Sample.MovementMs);
+	}
+
+	const double SpawnMB = (static_cast<double>(UsedPhysicalAfterSpawn) - UsedPhysicalBeforeSpawn) / (1024.0 * 1024.0);
+
+	FMovementBenchmarkResult Result;
+	Result.Characters = Bots.Num();
+	Result.Frames = Samples.Num();
+	Result.GameThreadAvgMs = GetAverage(GameThreadMs);
+	Result.GameThreadP50Ms = GetPercentile(GameThreadMs, 0.5f);
+	Result.GameThreadP95Ms = GetPercentile(GameThreadMs, 0.95f);
+	Result.GameThreadP99Ms = GetPercentile(GameThreadMs, 0.99f);
+	Result.MovementAvgMs = GetAverage(MovementMs);
+	Result.MovementP95Ms = GetPercentile(MovementMs, 0.95f);
+	Result.MovementUsPerCharacter = Result.MovementAvgMs * 1000.f / FMath::Max(Result.Characters, 1);
+	Result.SpawnMs = SpawnSeconds * 1000.0;
+	Result.SpawnKBPerCharacter = SpawnMB * 1024.0 / FMath::Max(Result.Characters, 1);
+	return Result;
+}
+
+void FMovementBenchmark::WriteResults(const FMovementBenchmarkResult& Result) const
+{
+	if (Samples.Num() == 0)
+	{
+		return;
+	}
+
+	const int32 Characters = Result.Characters;
+
+	UE_LOG(LogTemp, Display, TEXT("Movement benchmark: %d characters, %d frames, seed %d, LOD %d"), Characters, Result.Frames,
+	       Params.Seed, Params.ForcedLOD);
+	UE_LOG(LogTemp, Display, TEXT("  game thread avg %.3fms p50 %.3fms p95 %.3fms p99 %.3fms"), Result.GameThreadAvgMs,
+	       Result.GameThreadP50Ms, Result.GameThreadP95Ms, Result.GameThreadP99Ms);
+	UE_LOG(LogTemp, Display, TEXT("  movement avg %.3fms p95 %.3fms, %.2fus per character"), Result.MovementAvgMs,
+	       Result.MovementP95Ms, Result.MovementUsPerCharacter);
+	UE_LOG(LogTemp, Display, TEXT("  spawn %.1fms, %.1fKB per character"), Result.SpawnMs, Result.SpawnKBPerCharacter);
+
+	FString Csv = TEXT("Frame,GameThreadMs,MovementMs,Characters,UsedPhysicalMB\n");
+	for (int32 Index = 0; Index < Samples.Num(); ++Index)
+	{
+		const FFrameSample& Sample = Samples[Index];
+		Csv += FString::Printf(TEXT("%d,%.4f,%.4f,%d,%.2f\n"), Index, Sample.GameThreadMs, Sample.MovementMs, Sample.Characters,
+		                       Sample.UsedPhysical / (1024.0 * 1024.0));
+	}
+
+	const FString Path = FPaths::ProjectSavedDir() / TEXT("Benchmarks") / FString::Printf(TEXT("Movement_%d_seed%d_lod%d_%s.csv"),
+		Characters, Params.Seed, Params.ForcedLOD, *FDateTime::Now().ToString());
+
+	if (FFileHelper::SaveStringToFile(Csv, *Path))
+	{
+		UE_LOG(LogTemp, Display, TEXT("  written to %s"), *FPaths::ConvertRelativePathToFull(Path));
+	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to write movement benchmark results to %s"), *Path);
+	}
+}
@@ -0,0 +1,405 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Core/NetFrequencyController.h"
+
+#include "Core/MReplicationGraph.h"
+#include "Engine/NetDriver.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/Pawn.h"
+#include "Player/MPlayerState.h"
+
+DECLARE_CYCLE_STAT(TEXT("MP NetFrequency Update"), STAT_NetFrequencyController_Update, STATGROUP_Game);
+
+namespace
+{
+	const TCHAR* GetReasonName(const ENetFrequencyReason Reason)
+	{
+		switch (Reason)
+		{
+		case ENetFrequencyReason::Active: return TEXT("Active");
+		case ENetFrequencyReason::Idle: return TEXT("Idle");
+		case ENetFrequencyReason::Unobserved: return TEXT("Unobserved");
+		case ENetFrequencyReason::Crowded: return TEXT("Crowded");
+		case ENetFrequencyReason::Budget: return TEXT("Budget");
+		default: return TEXT("Unknown");
+		}
+	}
+
+	struct FPlayerEntry
+	{
+		AMPlayerState* PlayerState = nullptr;
+		APawn* Pawn = nullptr;
+
+		float CharacterFrequency = 0.f;
+		ENetFrequencyReason CharacterReason = ENetFrequencyReason::Idle;
+
+		/*
+		 *	Entries whose pawn sees this one and entries whose pawn this one sees
+		 **/
+		TArray<int32> Observers;
+		TArray<int32> Observed;
+
+		float BudgetScale = 1.f;
+	};
+}
+
+void FNetFrequencyController::Initialize(UWorld* InWorld)
+{
+	World = InWorld;
+	PawnActivity.Reset();
+	Decisions.Reset();
+	Stats = FNetFrequencyStats();
+	LastUpdateTime = 0.0;
+}
+
+void FNetFrequencyController::Tick(const double Now)
+{
+	if (!World.IsValid() || World->GetNetMode() == NM_Client || World->GetNetMode() == NM_Standalone)
+	{
+		return;
+	}
+
+	if (Now - LastUpdateTime < Settings.UpdateInterval)
+	{
+		return;
+	}
+
+	Update(Now);
+	LastUpdateTime = Now;
+}
+
+void FNetFrequencyController::Update(const double Now)
+{
+	SCOPE_CYCLE_COUNTER(STAT_NetFrequencyController_Update);
+	const double StartTime = FPlatformTime::Seconds();
+
+	const AGameStateBase* GameState = World->GetGameState();
+	if (!GameState)
+	{
+		return;
+	}
+
+	TArray<FPlayerEntry> Entries;
+	Entries.Reserve(GameState->PlayerArray.Num());
+
+	float CellSize = 1.f;
+	for (APlayerState* PlayerState : GameState->PlayerArray)
+	{
+		AMPlayerState* PS = Cast<AMPlayerState>(PlayerState);
+		if (!PS || PS->IsInactive())
+		{
+			continue;
+		}
+
+		FPlayerEntry& Entry = Entries.AddDefaulted_GetRef();
+		Entry.PlayerState = PS;
+		Entry.Pawn = PS->GetPawn();
+
+		if (Entry.Pawn)
+		{
+			CellSize = FMath::Max(CellSize, FMath::Sqrt(Entry.Pawn->NetCullDistanceSquared));
+		}
+	}
+
+	// Movement since the last update, pawns that are gone drop out of the activity map
+	TMap<TWeakObjectPtr<APawn>, FActorActivity> NewActivity;
+	NewActivity.Reserve(Entries.Num());
+
+	const float Elapsed = LastUpdateTime > 0.0 ? Now - LastUpdateTime : Settings.UpdateInterval;
+	const float MinDistanceSquared = FMath::Square(Settings.MinSpeed * Elapsed);
+
+	TMap<FIntPoint, TArray<int32>> Grid;
+	for (int32 Index = 0; Index < Entries.Num(); ++Index)
+	{
+		APawn* Pawn = Entries[Index].Pawn;
+		if (!Pawn)
+		{
+			continue;
+		}
+
+		const FVector Location = Pawn->GetActorLocation();
+
+		FActorActivity Activity;
+		if (const FActorActivity* Previous = PawnActivity.Find(Pawn))
+		{
+			Activity = *Previous;
+			if (FVector::DistSquared(Activity.LastLocation, Location) > MinDistanceSquared)
+			{
+				Activity.LastActiveTime = Now;
+			}
+		}
+		else
+		{
+			// Newly spawned, count as active so the first state goes out quickly
+			Activity.LastActiveTime = Now;
+		}
+
+		Activity.LastLocation = Location;
+		NewActivity.Add(Pawn, Activity);
+
+		Entries[Index].CharacterReason = Now - Activity.LastActiveTime < Settings.ActiveSeconds ? ENetFrequencyReason::Active
+		                                                                                      : ENetFrequencyReason::Idle;
+
+		const FIntPoint Cell(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+		Grid.FindOrAdd(Cell).Add(Index);
+	}
+
+	PawnActivity = MoveTemp(NewActivity);
+
+	// Observers are other pawns within the observed pawns cull distance, always somewhere in the surrounding 3x3 cells
+	for (int32 Index = 0; Index < Entries.Num(); ++Index)
+	{
+		FPlayerEntry& Entry = Entries[Index];
+		if (!Entry.Pawn)
+		{
+			continue;
+		}
+
+		const FVector Location = Entry.Pawn->GetActorLocation();
+		const FIntPoint Cell(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+
+		for (int32 X = -1; X <= 1; ++X)
+		{
+			for (int32 Y = -1; Y <= 1; ++Y)
+			{
+				const TArray<int32>* Others = Grid.Find(Cell + FIntPoint(X, Y));
+				if (!Others)
+				{
+					continue;
+				}
+
+				for (const int32 Other : *Others)
+				{
+					if (Other == Index)
+					{
+						continue;
+					}
+
+					if (FVector::DistSquared(Location, Entries[Other].Pawn->GetActorLocation()) <= Entry.Pawn->NetCullDistanceSquared)
+					{
+						Entry.Observers.Add(Other);
+						Entries[Other].Observed.Add(Index);
+					}
+				}
+			}
+		}
+	}
+
+	Stats.Characters = 0;
+	Stats.ActiveCharacters = 0;
+	Stats.CrowdedCharacters = 0;
+	Stats.PlayerStates = Entries.Num();
+	Stats.ActivePlayerStates = 0;
+
+	for (FPlayerEntry& Entry : Entries)
+	{
+		if (!Entry.Pawn)
+		{
+			continue;
+		}
+
+		++Stats.Characters;
+
+		if (Entry.Observers.Num() == 0)
+		{
+			Entry.CharacterFrequency = Settings.CharacterMinFrequency;
+			Entry.CharacterReason = ENetFrequencyReason::Unobserved;
+		}
+		else if (Entry.CharacterReason == ENetFrequencyReason::Active)
+		{
+			++Stats.ActiveCharacters;
+			Entry.CharacterFrequency = Settings.CharacterMaxFrequency;
+
+			if (Settings.CrowdSize > 0 && Entry.Observers.Num() > Settings.CrowdSize)
+			{
+				++Stats.CrowdedCharacters;
+				Entry.CharacterFrequency *= static_cast<float>(Settings.CrowdSize) / Entry.Observers.Num();
+				Entry.CharacterReason = ENetFrequencyReason::Crowded;
+			}
+		}
+		else
+		{
+			Entry.CharacterFrequency = Settings.CharacterMinFrequency;
+		}
+
+		Entry.CharacterFrequency = FMath::Max(Entry.CharacterFrequency, Settings.CharacterMinFrequency);
+	}
+
+	// Player states go to every connection, but only cost anything while they are awake
+	TArray<float> PlayerStateFrequencies;
+	PlayerStateFrequencies.SetNum(Entries.Num());
+
+	float PlayerStateBytes = 0.f;
+	for (int32 Index = 0; Index < Entries.Num(); ++Index)
+	{
+		const AMPlayerState* PS = Entries[Index].PlayerState;
+		const bool bActive = Now - PS->GetLastReplicatedChangeTime() < Settings.ActiveSeconds;
+
+		Stats.ActivePlayerStates += bActive ? 1 : 0;
+		PlayerStateFrequencies[Index] = bActive ? Settings.PlayerStateMaxFrequency : Settings.PlayerStateMinFrequency;
+
+		if (PS->NetDormancy <= DORM_Awake)
+		{
+			PlayerStateBytes += PlayerStateFrequencies[Index] * Settings.PlayerStateBytesPerUpdate;
+		}
+	}
+
+	// Fit every connection into the budget, an actor seen by several connections takes the strictest scale
+	Stats.ThrottledConnections = 0;
+	Stats.MaxDesiredBytesPerSecond = 0.f;
+
+	float PlayerStateScale = 1.f;
+	for (FPlayerEntry& Entry : Entries)
+	{
+		float Bytes = PlayerStateBytes;
+		for (const int32 Observed : Entry.Observed)
+		{
+			Bytes += Entries[Observed].CharacterFrequency * Settings.CharacterBytesPerUpdate;
+		}
+
+		Stats.MaxDesiredBytesPerSecond = FMath::Max(Stats.MaxDesiredBytesPerSecond, Bytes);
+
+		if (Settings.BudgetBytesPerSecond > 0 && Bytes > Settings.BudgetBytesPerSecond)
+		{
+			++Stats.ThrottledConnections;
+			Entry.BudgetScale = Settings.BudgetBytesPerSecond / Bytes;
+			PlayerStateScale = FMath::Min(PlayerStateScale, Entry.BudgetScale);
+		}
+	}
+
+	Decisions.Reset(Entries.Num());
+
+	float FrequencySum = 0.f;
+	for (FPlayerEntry& Entry : Entries)
+	{
+		if (!Entry.Pawn)
+		{
+			continue;
+		}
+
+		float Scale = 1.f;
+		for (const int32 Observer : Entry.Observers)
+		{
+			Scale = FMath::Min(Scale, Entries[Observer].BudgetScale);
+		}
+
+		const float Scaled = FMath::Max(Entry.CharacterFrequency * Scale, Settings.CharacterMinFrequency);
+		if (Scaled < Entry.CharacterFrequency)
+		{
+			Entry.CharacterFrequency = Scaled;
+			Entry.CharacterReason = ENetFrequencyReason::Budget;
+		}
+
+		FrequencySum += Entry.CharacterFrequency;
+		ApplyFrequency(Entry.Pawn, Entry.CharacterFrequency);
+
+		FNetFrequencyDecision& Decision = Decisions.AddDefaulted_GetRef();
+		Decision.Actor = Entry.Pawn;
+		Decision.Frequency = Entry.CharacterFrequency;
+		Decision.Observers = Entry.Observers.Num();
+		Decision.Reason = Entry.CharacterReason;
+	}
+
+	float ScaledPlayerStateBytes = 0.f;
+	for (int32 Index = 0; Index < Entries.Num(); ++Index)
+	{
+		AMPlayerState* PS = Entries[Index].PlayerState;
+
+		ENetFrequencyReason Reason = PlayerStateFrequencies[Index] > Settings.PlayerStateMinFrequency ? ENetFrequencyReason::Active
+		                                                                                             : ENetFrequencyReason::Idle;
+
+		const float Scaled = FMath::Max(PlayerStateFrequencies[Index] * PlayerStateScale, Settings.PlayerStateMinFrequency);
+		if (Scaled < PlayerStateFrequencies[Index])
+		{
+			Reason = ENetFrequencyReason::Budget;
+		}
+
+		if (PS->NetDormancy <= DORM_Awake)
+		{
+			ScaledPlayerStateBytes += Scaled * Settings.PlayerStateBytesPerUpdate;
+		}
+
+		ApplyFrequency(PS, Scaled);
+
+		FNetFrequencyDecision& Decision = Decisions.AddDefaulted_GetRef();
+		Decision.Actor = PS;
+		Decision.Frequency = Scaled;
+		Decision.Observers = Entries.Num() - 1;
+		Decision.Reason = Reason;
+	}
+
+	Stats.MaxBytesPerSecond = 0.f;
+	for (const FPlayerEntry& Entry : Entries)
+	{
+		float Bytes = ScaledPlayerStateBytes;
+		for (const int32 Observed : Entry.Observed)
+		{
+			Bytes += Entries[Observed].CharacterFrequency * Settings.CharacterBytesPerUpdate;
+		}
+
+		Stats.MaxBytesPerSecond = FMath::Max(Stats.MaxBytesPerSecond, Bytes);
+	}
+
+	Stats.AverageCharacterFrequency = Stats.Characters > 0 ? FrequencySum / Stats.Characters : 0.f;
+	Stats.UpdateMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+}
+
+void FNetFrequencyController::ApplyFrequency(AActor* Actor, const float Frequency)
+{
+	if (FMath::IsNearlyEqual(Actor->NetUpdateFrequency, Frequency, 0.1f))
+	{
+		return;
+	}
+
+	Actor->NetUpdateFrequency = Frequency;
+	Actor->MinNetUpdateFrequency = FMath::Min(Actor->MinNetUpdateFrequency, Frequency);
+	++Stats.Changes;
+
+	// The replication graph keeps its own update period per actor
+	const UNetDriver* NetDriver = World->GetNetDriver();
+	if (UMReplicationGraph* Graph = NetDriver ? Cast<UMReplicationGraph>(NetDriver->GetReplicationDriver()) : nullptr)
+	{
+		Graph->SetActorUpdateFrequency(Actor, Frequency);
+	}
+}
+
+void FNetFrequencyController::DumpStats() const
+{
+	UE_LOG(LogTemp, Display, TEXT("Net frequency: %d characters (%d active, %d crowded), %d player states (%d active), avg %.1fHz"),
+	       Stats.Characters, Stats.ActiveCharacters, Stats.CrowdedCharacters, Stats.PlayerStates, Stats.ActivePlayerStates,
+	       Stats.AverageCharacterFrequency);
+	UE_LOG(LogTemp, Display, TEXT("  budget %d B/s per connection, %d throttled, worst connection %.0f B/s wanted %.0f B/s sent"),
+	       Settings.BudgetBytesPerSecond, Stats.ThrottledConnections, Stats.MaxDesiredBytesPerSecond, Stats.MaxBytesPerSecond);
+	UE_LOG(LogTemp, Display, TEXT("  update %.3fms, %d frequency changes"), Stats.UpdateMs, Stats.Changes);
+
+	for (const FNetFrequencyDecision& Decision : Decisions)
+	{
+		if (const AActor* Actor = Decision.Actor.Get())
+		{
+			UE_LOG(LogTemp, Display, TEXT("  %-40s %5.1fHz %-10s %d observers"), *Actor->GetName(), Decision.Frequency,
+			       GetReasonName(Decision.Reason), Decision.Observers);
+		}
+	}
+}
@@ -0,0 +1,281 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Core/ServerDirectory.h"
+
+#include "Core/HttpApi.h"
+#include "Interfaces/IHttpResponse.h"
+#include "TimerManager.h"
+
+bool UServerDirectory::ShouldCreateSubsystem(UObject* Outer) const
+{
+#if UE_SERVER
+	return false;
+#else
+	return !IsRunningDedicatedServer();
+#endif
+}
+
+void UServerDirectory::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Collection.InitializeDependency(UHttpAPI::StaticClass());
+
+	FConfigFile GameConfig;
+	if (!FConfigCacheIni::LoadLocalIniFile(GameConfig, TEXT("DefaultGame"), false))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to load DefaultGame ini, server directory is empty."));
+		return;
+	}
+
+	GameConfig.GetArray(TEXT("ServerDirectory"), TEXT("Servers"), ServerAddresses);
+	GameConfig.GetFloat(TEXT("ServerDirectory"), TEXT("LoadPenaltyMs"), LoadPenaltyMs);
+	GameConfig.GetFloat(TEXT("ServerDirectory"), TEXT("ProbeTimeout"), ProbeTimeout);
+	GameConfig.GetInt(TEXT("ServerDirectory"), TEXT("StatusPortOffset"), StatusPortOffset);
+
+	// Fall back to the old single server entry so existing configs keep working
+	FString LegacyAddress;
+	if (ServerAddresses.Num() == 0 && GameConfig.GetString(TEXT("ServerAddress"), TEXT("Address"), LegacyAddress))
+	{
+		ServerAddresses.Add(LegacyAddress);
+	}
+}
+
+void UServerDirectory::Deinitialize()
+{
+	GetGameInstance()->GetTimerManager().ClearTimer(ProbeTimeout_TimerHandle);
+	bProbeInFlight = false;
+	CancelPendingProbes();
+	PendingSelections.Empty();
+}
+
+void UServerDirectory::SelectBestServer(const FOnServerSelected& OnSelected)
+{
+	if (ServerAddresses.Num() == 0)
+	{
+		OnSelected.ExecuteIfBound(FServerProbeResult());
+		return;
+	}
+
+	if (bHasProbed)
+	{
+		const FServerProbeResult* Best = PickBestServer();
+		OnSelected.ExecuteIfBound(Best ? *Best : FServerProbeResult(ServerAddresses[0]));
+		return;
+	}
+
+	PendingSelections.Add(OnSelected);
+	if (!bProbeInFlight)
+	{
+		ProbeServers();
+	}
+}
+
+void UServerDirectory::InvalidateProbeResults()
+{
+	bHasProbed = false;
+	ProbeResults.Empty();
+}
+
+FString UServerDirectory::GetStatusURL(const FString& Address, const int32 PortOffset)
+{
+	FString Host = Address;
+	int32 Port = DefaultGamePort;
+
+	FString PortString;
+	if (Address.Split(TEXT(":"), &Host, &PortString))
+	{
+		Port = FCString::Atoi(*PortString);
+	}
+
+	return FString::Printf(TEXT("http://%s:%d/status"), *Host, Port + PortOffset);
+}
+
+void UServerDirectory::ProbeServers()
+{
+	UHttpAPI* API = GetGameInstance()->GetSubsystem<UHttpAPI>();
+	if (!API)
+	{
+		return;
+	}
+
+	bProbeInFlight = true;
+	PendingProbes = ServerAddresses.Num();
+	const uint32 Round = ++ProbeRound;
+
+	ProbeResults.Reset(ServerAddresses.Num());
+	for (const FString& Address : ServerAddresses)
+	{
+		ProbeResults.Emplace(Address);
+	}
+
+	// Every probe is sent before any response is handled so the servers are measured in parallel
+	for (int32 i = 0; i < ServerAddresses.Num(); ++i)
+	{
+		SendProbe(API, Round, i);
+	}
+
+	GetGameInstance()->GetTimerManager().SetTimer(ProbeTimeout_TimerHandle, this, &ThisClass::FinishProbe, ProbeTimeout, false);
+}
+
+void UServerDirectory::SendProbe(UHttpAPI* API, const uint32 Round, const int32 Index)
+{
+	URequest* Request = API->CreateNewRequest(GetStatusURL(ServerAddresses[Index], StatusPortOffset), true);
+	API->SetHeaders(Request);
+
+	// The directory can be torn down or start a new round before a slow server answers
+	TWeakObjectPtr<UServerDirectory> WeakThis(this);
+	UHttpAPI::BindLambdaResponse(Request, [WeakThis, Round, Index, Request](FHttpRequestPtr, FHttpResponsePtr Response, bool bSuccess)
+	{
+		if (WeakThis.IsValid())
+		{
+			WeakThis->OnProbeResponse(Round, Index, Request, bSuccess ? Response : nullptr);
+		}
+	});
+
+	PendingProbeRequests.Add(Request);
+	UHttpAPI::GET(Request);
+}
+
+void UServerDirectory::OnProbeResponse(const uint32 Round, const int32 Index, URequest* Request, FHttpResponsePtr Response)
+{
+	PendingProbeRequests.RemoveSingleSwap(Request);
+
+	if (!bProbeInFlight || Round != ProbeRound || !ProbeResults.IsValidIndex(Index))
+	{
+		return;
+	}
+
+	if (Response.IsValid() && EHttpResponseCodes::IsOk(Response->GetResponseCode()))
+	{
+		const FServerStatusResponse Status = UHttpAPI::ToStruct<FServerStatusResponse>(Response->GetContentAsString());
+
+		FServerProbeResult& Result = ProbeResults[Index];
+		Result.RoundTripMs = FMath::Max(0.f, Request->GetElapsedTime() * 1000.f - Status.IdleWaitMs);
+		Result.Players = Status.Players;
+		Result.MaxPlayers = Status.MaxPlayers;
+		Result.bReachable = true;
+
+		// The answer woke the server, probe it again so the idle wait is not scored as latency.
+		// Until that answers the result above, with the wait taken off, stands in.
+		UHttpAPI* API = GetGameInstance()->GetSubsystem<UHttpAPI>();
+		if (Status.IdleWaitMs > 0.f && !Result.bIdle && API)
+		{
+			Result.bIdle = true;
+			SendProbe(API, Round, Index);
+			return;
+		}
+	}
+
+	if (--PendingProbes <= 0)
+	{
+		FinishProbe();
+	}
+}
+
+void UServerDirectory::FinishProbe()
+{
+	if (!bProbeInFlight)
+	{
+		return;
+	}
+
+	GetGameInstance()->GetTimerManager().ClearTimer(ProbeTimeout_TimerHandle);
+	bProbeInFlight = false;
+	bHasProbed = true;
+
+	// Servers that did not answer before the timeout are counted as unreachable for this round
+	CancelPendingProbes();
+
+	for (const FServerProbeResult& Result : ProbeResults)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Server %s reachable %d rtt %.1fms players %d/%d"), *Result.Address, Result.bReachable,
+		       Result.RoundTripMs, Result.Players, Result.MaxPlayers);
+	}
+
+	const FServerProbeResult* Best = PickBestServer();
+	const FServerProbeResult Selected = Best ? *Best : FServerProbeResult(ServerAddresses[0]);
+
+	TArray<FOnServerSelected> Selections = MoveTemp(PendingSelections);
+	for (const FOnServerSelected& Selection : Selections)
+	{
+		Selection.ExecuteIfBound(Selected);
+	}
+}
+
+void UServerDirectory::CancelPendingProbes()
+{
+	// Moving to a new round first means the completion delegates fired by the cancel are ignored
+	++ProbeRound;
+
+	TArray<URequest*> Requests = MoveTemp(PendingProbeRequests);
+	UHttpAPI* API = GetGameInstance()->GetSubsystem<UHttpAPI>();
+	for (URequest* Request : Requests)
+	{
+		if (!Request || Request->IsComplete())
+		{
+			continue;
+		}
+
+		if (API)
+		{
+			API->ClearRequest(Request);
+		}
+		else
+		{
+			Request->CancelRequest();
+		}
+	}
+}
+
+const FServerProbeResult* UServerDirectory::PickBestServer() const
+{
+	const FServerProbeResult* Best = nullptr;
+	float BestScore = TNumericLimits<float>::Max();
+
+	// Full servers are only picked when every reachable server is full
+	for (const bool bAllowFull : { false, true })
+	{
+		for (const FServerProbeResult& Result : ProbeResults)
+		{
+			if (!Result.bReachable || (Result.IsFull() && !bAllowFull))
+			{
+				continue;
+			}
+
+			const float Score = Result.RoundTripMs + Result.GetLoad() * LoadPenaltyMs;
+			if (Score < BestScore)
+			{
+				BestScore = Score;
+				Best = &Result;
+			}
+		}
+
+		if (Best)
+		{
+			break;
+		}
+	}
+
+	return Best;
+}
@@ -0,0 +1,225 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Core/SpawnPointAllocator.h"
+
+#include "EngineUtils.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerStart.h"
+
+void FSpawnPointAllocator::Initialize(UWorld* World)
+{
+	TArray<AActor*> PlayerStarts;
+	if (World)
+	{
+		for (TActorIterator<APlayerStart> It(World); It; ++It)
+		{
+			PlayerStarts.Add(*It);
+		}
+	}
+
+	Initialize(PlayerStarts);
+}
+
+void FSpawnPointAllocator::Initialize(const TArray<AActor*>& PlayerStarts)
+{
+	Starts.Reset();
+	FreeRing.Reset();
+	FreeHead = 0;
+	FreeCount = 0;
+	ReservedStarts.Reset();
+	ReleaseCursor = 0;
+	StartOfController.Reset();
+
+	const float InvCellSize = 1.f / FMath::Max(CellSize, 1.f);
+
+	TMap<FIntVector, int32> CellOfKey;
+	TArray<TArray<int32>> Cells;
+	for (AActor* PlayerStart : PlayerStarts)
+	{
+		if (!PlayerStart)
+		{
+			continue;
+		}
+
+		const FVector Location = PlayerStart->GetActorLocation() * InvCellSize;
+		const FIntVector Key(FMath::FloorToInt(Location.X), FMath::FloorToInt(Location.Y), FMath::FloorToInt(Location.Z));
+
+		int32& CellIndex = CellOfKey.FindOrAdd(Key, INDEX_NONE);
+		if (CellIndex == INDEX_NONE)
+		{
+			CellIndex = Cells.AddDefaulted();
+		}
+
+		Cells[CellIndex].Add(Starts.Num());
+		Starts.AddDefaulted_GetRef().Actor = PlayerStart;
+	}
+
+	// One start of every cell before the second start of any, consecutive joins land apart
+	FreeRing.Reserve(Starts.Num());
+	for (int32 Round = 0; FreeRing.Num() < Starts.Num(); ++Round)
+	{
+		for (const TArray<int32>& Cell : Cells)
+		{
+			if (Cell.IsValidIndex(Round))
+			{
+				FreeRing.Add(Cell[Round]);
+			}
+		}
+	}
+	FreeCount = Starts.Num();
+
+	UE_LOG(LogTemp, Log, TEXT("Spawn allocator indexed %d player starts in %d cells"), Starts.Num(), Cells.Num());
+}
+
+AActor* FSpawnPointAllocator::Allocate(AController* Controller)
+{
+	if (!Controller)
+	{
+		return nullptr;
+	}
+
+	Release(Controller);
+
+	// Starts that were destroyed are dropped from the ring, every other pop hands out a start
+	while (FreeCount > 0)
+	{
+		const int32 StartIndex = FreeRing[FreeHead];
+		FreeHead = (FreeHead + 1) % FreeRing.Num();
+		--FreeCount;
+
+		FStart& Start = Starts[StartIndex];
+		if (AActor* Actor = Start.Actor.Get())
+		{
+			Start.Occupant = Controller;
+			Start.OccupantKey = Controller;
+			Start.ReservedTime = LastTickTime;
+
+			ReservedStarts.Add(StartIndex);
+			StartOfController.Add(Controller, StartIndex);
+			++Allocations;
+			return Actor;
+		}
+	}
+
+	if (Starts.Num() > 0)
+	{
+		++Saturated;
+	}
+
+	return nullptr;
+}
+
+void FSpawnPointAllocator::Release(AController* Controller)
+{
+	int32 StartIndex = INDEX_NONE;
+	if (StartOfController.RemoveAndCopyValue(Controller, StartIndex))
+	{
+		ReservedStarts.RemoveSingleSwap(StartIndex, false);
+
+		// A player leaving takes their pawn along, a failed spawn never put one there
+		FreeStart(StartIndex, true);
+	}
+}
+
+bool FSpawnPointAllocator::IsReservedStartClear(AController* Controller) const
+{
+	const int32* StartIndex = StartOfController.Find(Controller);
+	return StartIndex && Starts[*StartIndex].bClear;
+}
+
+void FSpawnPointAllocator::Tick(const double Now)
+{
+	LastTickTime = Now;
+
+	const int32 Checks = FMath::Min(ReleaseChecksPerTick, ReservedStarts.Num());
+	for (int32 i = 0; i < Checks && ReservedStarts.Num() > 0; ++i)
+	{
+		ReleaseCursor %= ReservedStarts.Num();
+
+		const int32 StartIndex = ReservedStarts[ReleaseCursor];
+		FStart& Start = Starts[StartIndex];
+
+		const EOccupancy Occupancy = GetOccupancy(Start);
+		const bool bExpired = Now - Start.ReservedTime >= ReservationTimeout;
+		if (Occupancy != EOccupancy::Left && !bExpired)
+		{
+			++ReleaseCursor;
+			continue;
+		}
+
+		if (Occupancy != EOccupancy::Left)
+		{
+			++TimedOut;
+		}
+
+		// The swapped in start lands on the cursor and is checked next
+		StartOfController.Remove(Start.OccupantKey);
+		ReservedStarts.RemoveAtSwap(ReleaseCursor, 1, false);
+		FreeStart(StartIndex, Occupancy == EOccupancy::Left);
+	}
+}
+
+FSpawnPointAllocator::EOccupancy FSpawnPointAllocator::GetOccupancy(const FStart& Start) const
+{
+	const AController* Controller = Start.Occupant.Get();
+	const AActor* Actor = Start.Actor.Get();
+	if (!Controller || !Actor)
+	{
+		return EOccupancy::Left;
+	}
+
+	const APawn* Pawn = Controller->GetPawn();
+	if (!Pawn)
+	{
+		return EOccupancy::Pending;
+	}
+
+	// Clear once a capsule spawned on the start could not touch the pawn any more
+	float Radius, HalfHeight;
+	Pawn->GetSimpleCollisionCylinder(Radius, HalfHeight);
+
+	const FVector Offset = Pawn->GetActorLocation() - Actor->GetActorLocation();
+	const bool bClear = Offset.SizeSquared2D() > FMath::Square(2.f * Radius) || FMath::Abs(Offset.Z) > 2.f * HalfHeight;
+	return bClear ? EOccupancy::Left : EOccupancy::OnStart;
+}
+
+void FSpawnPointAllocator::FreeStart(const int32 StartIndex, const bool bClear)
+{
+	FStart& Start = Starts[StartIndex];
+	Start.Occupant.Reset();
+	Start.OccupantKey = TObjectKey<AController>();
+	Start.bClear = bClear;
+
+	FreeRing[(FreeHead + FreeCount) % FreeRing.Num()] = StartIndex;
+	++FreeCount;
+	++Releases;
+}
+
+void FSpawnPointAllocator::DumpStats() const
+{
+	UE_LOG(LogTemp, Display, TEXT("Spawn allocator: %d/%d starts reserved, %d free, %d allocations, %d releases (%d timed out), %d refused while saturated"),
+	       ReservedStarts.Num(), Starts.Num(), FreeCount, Allocations, Releases, TimedOut, Saturated);
+}
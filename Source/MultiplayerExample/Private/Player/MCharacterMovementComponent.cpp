@@ -0,0 +1,368 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Player/MCharacterMovementComponent.h"
+
+#include "Engine/NetDriver.h"
+#include "GameFramework/Character.h"
+
+DECLARE_CYCLE_STAT(TEXT("MP Character Movement Tick"), STAT_MCharacterMovement_Tick, STATGROUP_Game);
+DECLARE_CYCLE_STAT(TEXT("MP Server Move Receive"), STAT_MCharacterMovement_ServerReceive, STATGROUP_Game);
+
+bool UMCharacterMovementComponent::bCollectTickTime = false;
+double UMCharacterMovementComponent::TickSeconds = 0.0;
+
+static TAutoConsoleVariable<int32> CVarCompactMoves(
+	TEXT("MP.Movement.CompactMoves"),
+	1,
+	TEXT("Send compact move data, combine moves across small input changes and send steady input less often. Client side, 0 uses the stock path"));
+
+static FAutoConsoleCommandWithWorld DumpMoveStatsCommand(
+	TEXT("MP.Movement.Stats"),
+	TEXT("Logs move RPCs received by this server since the last call, bits and processing time per RPC"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UMCharacterMovementComponent::DumpMoveStats(World);
+	}));
+
+namespace
+{
+	constexpr int32 AccelYawBits = 10;
+	constexpr int32 AccelMagnitudeBits = 7;
+	constexpr int32 ControlYawBits = 12;
+	constexpr int32 ControlPitchBits = 11;
+
+	int32 ReceivedMoves = 0;
+	int64 ReceivedBits = 0;
+	double ReceiveSeconds = 0.0;
+	double StatsStartTime = 0.0;
+
+	FMoveSendStats SendStats;
+
+	uint32 QuantizeUnit(const float Value, const int32 Bits)
+	{
+		const int32 Max = (1 << Bits) - 1;
+		return FMath::Clamp(FMath::RoundToInt(Value * Max), 0, Max);
+	}
+
+	float DequantizeUnit(const uint32 Value, const int32 Bits)
+	{
+		return static_cast<float>(Value) / ((1 << Bits) - 1);
+	}
+
+	/*
+	 *	Walking and falling characters only accelerate horizontally, anything else takes the full vector
+	 **/
+	bool PackHorizontalAcceleration(const FVector& Acceleration, const float MaxAcceleration, uint32& OutYaw, uint32& OutMagnitude)
+	{
+		if (Acceleration.Z != 0.f || MaxAcceleration <= 0.f)
+		{
+			return false;
+		}
+
+		const float Angle = FMath::Atan2(Acceleration.Y, Acceleration.X) / (2.f * PI);
+		OutYaw = static_cast<uint32>(FMath::RoundToInt((Angle < 0.f ? Angle + 1.f : Angle) * (1 << AccelYawBits))) & ((1 << AccelYawBits) - 1);
+		OutMagnitude = QuantizeUnit(Acceleration.Size2D() / MaxAcceleration, AccelMagnitudeBits);
+		return true;
+	}
+
+	FVector UnpackHorizontalAcceleration(const uint32 Yaw, const uint32 Magnitude, const float MaxAcceleration)
+	{
+		const float Angle = Yaw * 2.f * PI / (1 << AccelYawBits);
+		const float Size = DequantizeUnit(Magnitude, AccelMagnitudeBits) * MaxAcceleration;
+
+		float Sin, Cos;
+		FMath::SinCos(&Sin, &Cos, Angle);
+		return FVector(Cos * Size, Sin * Size, 0.f);
+	}
+
+	bool SerializeBit(FArchive& Ar, const bool bValue)
+	{
+		uint8 Bit = bValue ? 1 : 0;
+		Ar.SerializeBits(&Bit, 1);
+		return Bit != 0;
+	}
+
+	template<typename ValueType>
+	void SerializeOptionalValue(const bool bIsSaving, FArchive& Ar, ValueType& Value, const ValueType& DefaultValue)
+	{
+		if (SerializeBit(Ar, bIsSaving && Value != DefaultValue))
+		{
+			Ar << Value;
+		}
+		else if (!bIsSaving)
+		{
+			Value = DefaultValue;
+		}
+	}
+}
+
+bool FMCharacterNetworkMoveData::Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap,
+                                           const ENetworkMoveType MoveType)
+{
+	NetworkMoveType = MoveType;
+
+	bool bLocalSuccess = true;
+	const bool bIsSaving = Ar.IsSaving();
+
+	Ar << TimeStamp;
+
+	// The sending client picks the format, so clients can be switched for comparisons without touching the server
+	const bool bCompact = SerializeBit(Ar, bIsSaving && UMCharacterMovementComponent::UseCompactMoves());
+	if (bCompact)
+	{
+		uint32 Yaw = 0;
+		uint32 Magnitude = 0;
+		const bool bHorizontal = SerializeBit(Ar, bIsSaving && PackHorizontalAcceleration(Acceleration, CharacterMovement.MaxAcceleration, Yaw, Magnitude));
+		if (bHorizontal)
+		{
+			Ar.SerializeInt(Yaw, 1 << AccelYawBits);
+			Ar.SerializeInt(Magnitude, 1 << AccelMagnitudeBits);
+
+			if (!bIsSaving)
+			{
+				Acceleration = UnpackHorizontalAcceleration(Yaw, Magnitude, CharacterMovement.MaxAcceleration);
+			}
+		}
+		else
+		{
+			Acceleration.NetSerialize(Ar, PackageMap, bLocalSuccess);
+		}
+
+		Location.NetSerialize(Ar, PackageMap, bLocalSuccess);
+
+		// Roll is never used for control rotation, pitch only covers looking straight down to straight up
+		uint32 ControlYaw = QuantizeUnit(FRotator::ClampAxis(ControlRotation.Yaw) / 360.f, ControlYawBits);
+		uint32 ControlPitch = QuantizeUnit((FMath::Clamp(FRotator::NormalizeAxis(ControlRotation.Pitch), -90.f, 90.f) + 90.f) / 180.f, ControlPitchBits);
+		Ar.SerializeInt(ControlYaw, 1 << ControlYawBits);
+		Ar.SerializeInt(ControlPitch, 1 << ControlPitchBits);
+
+		if (!bIsSaving)
+		{
+			ControlRotation = FRotator(DequantizeUnit(ControlPitch, ControlPitchBits) * 180.f - 90.f,
+			                           FRotator::NormalizeAxis(DequantizeUnit(ControlYaw, ControlYawBits) * 360.f), 0.f);
+		}
+	}
+	else
+	{
+		Acceleration.NetSerialize(Ar, PackageMap, bLocalSuccess);
+		Location.NetSerialize(Ar, PackageMap, bLocalSuccess);
+		ControlRotation.NetSerialize(Ar, PackageMap, bLocalSuccess);
+	}
+
+	SerializeOptionalValue<uint8>(bIsSaving, Ar, CompressedMoveFlags, 0);
+
+	// Movement base and mode are only used to check the final position
+	if (MoveType == ENetworkMoveType::NewMove)
+	{
+		SerializeOptionalValue<UPrimitiveComponent*>(bIsSaving, Ar, MovementBase, nullptr);
+		SerializeOptionalValue<FName>(bIsSaving, Ar, MovementBaseBoneName, NAME_None);
+		SerializeOptionalValue<uint8>(bIsSaving, Ar, MovementMode, MOVE_Walking);
+	}
+
+	return !Ar.IsError();
+}
+
+FMCharacterNetworkMoveDataContainer::FMCharacterNetworkMoveDataContainer()
+{
+	NewMoveData = &MoveData[0];
+	PendingMoveData = &MoveData[1];
+	OldMoveData = &MoveData[2];
+}
+
+void FSavedMove_MCharacter::SetMoveFor(ACharacter* C, const float InDeltaTime, FVector const& NewAccel,
+                                       FNetworkPredictionData_Client_Character& ClientData)
+{
+	if (!UMCharacterMovementComponent::UseCompactMoves())
+	{
+		Super::SetMoveFor(C, InDeltaTime, NewAccel, ClientData);
+		return;
+	}
+
+	const auto* Movement = Cast<UMCharacterMovementComponent>(C->GetCharacterMovement());
+	const FVector Quantized = Movement ? UMCharacterMovementComponent::QuantizeAcceleration(NewAccel, Movement->MaxAcceleration) : NewAccel;
+
+	Super::SetMoveFor(C, InDeltaTime, Quantized, ClientData);
+
+	if (Movement)
+	{
+		AccelDotThresholdCombine = FMath::Cos(FMath::DegreesToRadians(Movement->CombineAccelAngle));
+	}
+}
+
+FSavedMovePtr FNetworkPredictionData_Client_MCharacter::AllocateNewMove()
+{
+	return FSavedMovePtr(new FSavedMove_MCharacter());
+}
+
+UMCharacterMovementComponent::UMCharacterMovementComponent()
+{
+	CombineAccelAngle = 8.f;
+	SteadyInputSendDeltaTime = 0.05f;
+
+	SetNetworkMoveDataContainer(MoveDataContainer);
+}
+
+void UMCharacterMovementComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MCharacterMovement_Tick);
+
+	if (!bCollectTickTime)
+	{
+		Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+		return;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	TickSeconds += FPlatformTime::Seconds() - StartTime;
+}
+
+FNetworkPredictionData_Client* UMCharacterMovementComponent::GetPredictionData_Client() const
+{
+	if (!ClientPredictionData)
+	{
+		UMCharacterMovementComponent* MutableThis = const_cast<UMCharacterMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_MCharacter(*this);
+	}
+
+	return ClientPredictionData;
+}
+
+void UMCharacterMovementComponent::ServerMovePacked_ServerReceive(const FCharacterServerMovePackedBits& PackedBits)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MCharacterMovement_ServerReceive);
+
+	const double StartTime = FPlatformTime::Seconds();
+	Super::ServerMovePacked_ServerReceive(PackedBits);
+
+	ReceiveSeconds += FPlatformTime::Seconds() - StartTime;
+	ReceivedBits += PackedBits.DataBits.Num();
+	++ReceivedMoves;
+}
+
+void UMCharacterMovementComponent::ServerMovePacked_ClientSend(const FCharacterServerMovePackedBits& PackedBits)
+{
+	++SendStats.Moves;
+	SendStats.Bits += PackedBits.DataBits.Num();
+
+	Super::ServerMovePacked_ClientSend(PackedBits);
+}
+
+void UMCharacterMovementComponent::OnClientCorrectionReceived(FNetworkPredictionData_Client_Character& ClientData, const float TimeStamp,
+                                                              const FVector NewLocation, const FVector NewVelocity, UPrimitiveComponent* NewBase,
+                                                              const FName NewBaseBoneName, const bool bHasBase, const bool bBaseRelativePosition,
+                                                              const uint8 ServerMovementMode)
+{
+	++SendStats.Corrections;
+
+	Super::OnClientCorrectionReceived(ClientData, TimeStamp, NewLocation, NewVelocity, NewBase, NewBaseBoneName, bHasBase,
+	                                  bBaseRelativePosition, ServerMovementMode);
+}
+
+float UMCharacterMovementComponent::GetClientNetSendDeltaTime(const APlayerController* PC, const FNetworkPredictionData_Client_Character* ClientData,
+                                                              const FSavedMovePtr& NewMove) const
+{
+	const float SendDeltaTime = Super::GetClientNetSendDeltaTime(PC, ClientData, NewMove);
+	if (!UseCompactMoves() || !ClientData || !NewMove.IsValid())
+	{
+		return SendDeltaTime;
+	}
+
+	// Steady means the same quantized input as both the acknowledged move and the one before this
+	const FSavedMovePtr& LastAcked = ClientData->LastAckedMove;
+	const int32 NumMoves = ClientData->SavedMoves.Num();
+	const FSavedMovePtr* Previous = NumMoves >= 2 ? &ClientData->SavedMoves[NumMoves - 2] : nullptr;
+
+	if (LastAcked.IsValid() && Previous && Previous->IsValid() && NewMove->Acceleration == LastAcked->Acceleration &&
+		NewMove->Acceleration == (*Previous)->Acceleration && NewMove->GetCompressedFlags() == LastAcked->GetCompressedFlags())
+	{
+		return FMath::Max(SendDeltaTime, SteadyInputSendDeltaTime);
+	}
+
+	return SendDeltaTime;
+}
+
+void UMCharacterMovementComponent::SetCollectTickTime(const bool bCollect)
+{
+	bCollectTickTime = bCollect;
+	TickSeconds = 0.0;
+}
+
+double UMCharacterMovementComponent::ConsumeTickSeconds()
+{
+	const double Seconds = TickSeconds;
+	TickSeconds = 0.0;
+	return Seconds;
+}
+
+bool UMCharacterMovementComponent::UseCompactMoves()
+{
+	return CVarCompactMoves.GetValueOnGameThread() != 0;
+}
+
+FVector UMCharacterMovementComponent::QuantizeAcceleration(const FVector& Acceleration, const float InMaxAcceleration)
+{
+	uint32 Yaw, Magnitude;
+	if (PackHorizontalAcceleration(Acceleration, InMaxAcceleration, Yaw, Magnitude))
+	{
+		return UnpackHorizontalAcceleration(Yaw, Magnitude, InMaxAcceleration);
+	}
+
+	// Same rounding as FVector_NetQuantize10
+	return FVector(FMath::RoundToFloat(Acceleration.X * 10.f) / 10.f, FMath::RoundToFloat(Acceleration.Y * 10.f) / 10.f,
+	               FMath::RoundToFloat(Acceleration.Z * 10.f) / 10.f);
+}
+
+FMoveSendStats UMCharacterMovementComponent::ConsumeSendStats()
+{
+	const FMoveSendStats Stats = SendStats;
+	SendStats = FMoveSendStats();
+	return Stats;
+}
+
+void UMCharacterMovementComponent::DumpMoveStats(const UWorld* World)
+{
+	const double Now = FPlatformTime::Seconds();
+	const double Elapsed = StatsStartTime > 0.0 ? Now - StatsStartTime : 0.0;
+
+	const UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+	const int32 Clients = NetDriver ? NetDriver->ClientConnections.Num() : 0;
+
+	if (ReceivedMoves > 0 && Elapsed > 0.0)
+	{
+		UE_LOG(LogTemp, Display, TEXT("Move RPCs: %d in %.1fs from %d clients, %.1f bits each, %.0f B/s per client, %.2fus to process each"),
+		       ReceivedMoves, Elapsed, Clients, static_cast<double>(ReceivedBits) / ReceivedMoves,
+		       ReceivedBits / 8.0 / Elapsed / FMath::Max(Clients, 1), ReceiveSeconds * 1000000.0 / ReceivedMoves);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Display, TEXT("Move RPCs: none received since the last call, stats window started"));
+	}
+
+	ReceivedMoves = 0;
+	ReceivedBits = 0;
+	ReceiveSeconds = 0.0;
+	StatsStartTime = Now;
+}
@@ -26,11 +26,16 @@
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/InputComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Core/CharacterSignificance.h"
+#include "Core/LagCompensation.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/Controller.h"
 #include "GameFramework/SpringArmComponent.h"
+#include "Player/MCharacterMovementComponent.h"
 
-AMultiplayerExampleCharacter::AMultiplayerExampleCharacter()
+AMultiplayerExampleCharacter::AMultiplayerExampleCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UMCharacterMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
 
@@ -53,6 +58,20 @@ AMultiplayerExampleCharacter::AMultiplayerExampleCharacter()
 	FollowCamera = CreateDefaultSubobject<UCameraComponent>(TEXT("FollowCamera"));
 	FollowCamera->SetupAttachment(CameraBoom, USpringArmComponent::SocketName);
 	FollowCamera->bUsePawnControlRotation = false;
+
+	const auto AddMovementLOD = [this](const float MaxDistance, const float MovementTickInterval, const float MeshTickInterval,
+	                                   const EVisibilityBasedAnimTickOption AnimTickOption)
+	{
+		FMovementLOD& LOD = MovementLODs.AddDefaulted_GetRef();
+		LOD.MaxDistance = MaxDistance;
+		LOD.MovementTickInterval = MovementTickInterval;
+		LOD.MeshTickInterval = MeshTickInterval;
+		LOD.AnimTickOption = AnimTickOption;
+	};
+
+	AddMovementLOD(2500.f, 0.f, 0.f, EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones);
+	AddMovementLOD(6000.f, 0.05f, 0.1f, EVisibilityBasedAnimTickOption::AlwaysTickPose);
+	AddMovementLOD(15000.f, 0.1f, 0.25f, EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered);
 }
 
 void AMultiplayerExampleCharacter::SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent)
@@ -83,6 +102,43 @@ void AMultiplayerExampleCharacter::LookUpAtRate(float Rate)
 void AMultiplayerExampleCharacter::BeginPlay()
 {
 	Super::BeginPlay();
+
+	FCharacterSignificance::Register(this);
+
+	ULagCompensation* LagCompensation = GetWorld()->GetSubsystem<ULagCompensation>();
+	if (LagCompensation && (GetNetMode() == NM_DedicatedServer || GetNetMode() == NM_ListenServer))
+	{
+		LagCompensation->Register(this);
+	}
+}
+
+void AMultiplayerExampleCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	FCharacterSignificance::Unregister(this);
+
+	if (ULagCompensation* LagCompensation = GetWorld()->GetSubsystem<ULagCompensation>())
+	{
+		LagCompensation->Unregister(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AMultiplayerExampleCharacter::SetMovementLOD(const int32 LOD)
+{
+	const int32 NewLOD = FMath::Clamp(LOD, 0, MovementLODs.Num() - 1);
+	if (NewLOD == MovementLOD || !MovementLODs.IsValidIndex(NewLOD))
+	{
+		return;
+	}
+
+	MovementLOD = NewLOD;
+	const FMovementLOD& Settings = MovementLODs[MovementLOD];
+
+	// Tick intervals keep the accumulated delta time, movement stays correct at a coarser step
+	GetCharacterMovement()->SetComponentTickInterval(Settings.MovementTickInterval);
+	GetMesh()->SetComponentTickInterval(Settings.MeshTickInterval);
+	GetMesh()->VisibilityBasedAnimTickOption = Settings.AnimTickOption;
 }
 
 void AMultiplayerExampleCharacter::SetPlayerDefaults()
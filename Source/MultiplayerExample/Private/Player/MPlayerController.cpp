@@ -25,11 +25,42 @@
 #include "Player/MPlayerController.h"
 
 #include "Async/Async_GetCharacter.h"
+#include "Core/CharacterCache.h"
 #include "Core/MBaseGameMode.h"
 #include "Core/MGameInstance.h"
 #include "Player/MPlayerState.h"
 #include "UserInterface/HUDs/MGameHUD.h"
 
+static FAutoConsoleCommandWithWorld DumpClockSyncStatsCommand(
+	TEXT("MP.Clock.Stats"),
+	TEXT("Logs this client's server clock offset and jitter estimates"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const auto* PC = World ? Cast<AMPlayerController>(World->GetFirstPlayerController()) : nullptr)
+		{
+			PC->GetClockSync().DumpStats();
+		}
+	}));
+
+AMPlayerController::AMPlayerController()
+{
+	ClockSyncBurstCount = 8;
+	ClockSyncBurstInterval = 0.1f;
+	ClockSyncInterval = 2.f;
+}
+
+void AMPlayerController::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (IsLocalController() && GetNetMode() == NM_Client)
+	{
+		ClockSync.Reset();
+		ClockSyncPingsSent = 0;
+		GetWorldTimerManager().SetTimer(ClockSyncTimerHandle, this, &ThisClass::SendClockSyncPing, ClockSyncBurstInterval, true, 0.f);
+	}
+}
+
 void AMPlayerController::Client_OnConnectionComplete_Implementation()
 {
 	auto* const GI = GetGameInstance<UMGameInstance>();
@@ -60,6 +91,21 @@ void AMPlayerController::Client_DisconnectAndGotoLoginScreen_Implementation()
 }
 
 void AMPlayerController::Server_GetCharacter_Implementation(const FString& CharacterID, const FString& BearerToken)
+{
+	BackendCharacterID = CharacterID;
+	BackendToken = BearerToken;
+
+	if (auto* GameMode = GetWorld()->GetAuthGameMode<AMultiplayerExampleGameMode>())
+	{
+		GameMode->RequestAdmission(this, CharacterID, BearerToken);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s wasn't called on the server"), __func__);
+	}
+}
+
+void AMPlayerController::FetchCharacter(const FString& CharacterID, const FString& BearerToken)
 {
 	auto* GetCharacter = UAsync_GetCharacter::WaitGetCharacter(GetGameInstance<UMGameInstance>(),
 	                                                           FGetCharacterRequest(CharacterID), BearerToken);
@@ -69,13 +115,32 @@ void AMPlayerController::Server_GetCharacter_Implementation(const FString& Chara
 
 void AMPlayerController::OnGetCharacterCallback(const FCharacterData& CharacterData)
 {
+	check(GetWorld());
+
+	UCharacterCache* Cache = GetGameInstance()->GetSubsystem<UCharacterCache>();
+
 	if (!CharacterData.IsValid())
 	{
-		Client_DisconnectAndGotoLoginScreen();
+		if (Cache)
+		{
+			Cache->Invalidate(BackendCharacterID);
+		}
+
+		if (auto* GameMode = GetWorld()->GetAuthGameMode<AMultiplayerExampleGameMode>())
+		{
+			GameMode->NotifyCharacterFetchFailed(this);
+		}
+		else
+		{
+			Client_DisconnectAndGotoLoginScreen();
+		}
 		return;
 	}
 
-	check(GetWorld());
+	if (Cache)
+	{
+		Cache->Store(CharacterData, BackendToken);
+	}
 
 	if (GetWorld()->GetAuthGameMode<AMultiplayerExampleGameMode>())
 	{
@@ -99,6 +164,53 @@ bool AMPlayerController::Server_GetCharacter_Validate(const FString& CharacterID
 	return true;
 }
 
+void AMPlayerController::SendClockSyncPing()
+{
+	++ClockSyncSequence;
+
+	FClockSyncPing& Ping = PendingPings[ClockSyncSequence % MaxPendingPings];
+	Ping.Sequence = ClockSyncSequence;
+	Ping.bPending = true;
+	Ping.SendTime = FPlatformTime::Seconds();
+
+	Server_ClockSyncPing(ClockSyncSequence);
+
+	if (++ClockSyncPingsSent == ClockSyncBurstCount)
+	{
+		GetWorldTimerManager().SetTimer(ClockSyncTimerHandle, this, &ThisClass::SendClockSyncPing, ClockSyncInterval, true);
+	}
+}
+
+void AMPlayerController::Server_ClockSyncPing_Implementation(const uint8 Sequence)
+{
+	const double Now = FPlatformTime::Seconds();
+	if (Now - LastClockSyncPingTime < ClockSyncBurstInterval * 0.5f)
+	{
+		return;
+	}
+
+	LastClockSyncPingTime = Now;
+	Client_ClockSyncPong(Sequence, Now);
+}
+
+bool AMPlayerController::Server_ClockSyncPing_Validate(const uint8 Sequence)
+{
+	return true;
+}
+
+void AMPlayerController::Client_ClockSyncPong_Implementation(const uint8 Sequence, const double ServerTime)
+{
+	// Unreliable, a pong can be lost or arrive after a newer one. Only answers to pings still pending count.
+	FClockSyncPing& Ping = PendingPings[Sequence % MaxPendingPings];
+	if (!Ping.bPending || Ping.Sequence != Sequence)
+	{
+		return;
+	}
+
+	Ping.bPending = false;
+	ClockSync.AddSample(Ping.SendTime, ServerTime, FPlatformTime::Seconds());
+}
+
 void AMPlayerController::OnRep_PlayerState()
 {
 	Super::OnRep_PlayerState();
@@ -25,7 +25,131 @@
 #include "Player/MPlayerState.h"
 
 #include "Async/Async_UpdateInventory.h"
+#include "Core/CharacterPersistence.h"
+#include "Net/Core/PushModel/PushModel.h"
 #include "Net/UnrealNetwork.h"
+#include "Serialization/BitWriter.h"
+
+namespace
+{
+	/*
+	 *	Bits a full send of the value costs, property by property the way the rep layout writes it without handles
+	 **/
+	void NetSerializeValue(FBitWriter& Writer, FProperty* Property, void* Value)
+	{
+		if (const FStructProperty* StructProperty = CastField<FStructProperty>(Property))
+		{
+			for (TFieldIterator<FProperty> It(StructProperty->Struct); It; ++It)
+			{
+				NetSerializeValue(Writer, *It, It->ContainerPtrToValuePtr<void>(Value));
+			}
+		}
+		else if (const FArrayProperty* ArrayProperty = CastField<FArrayProperty>(Property))
+		{
+			FScriptArrayHelper Helper(ArrayProperty, Value);
+			uint16 Num = Helper.Num();
+			Writer << Num;
+			for (int32 Index = 0; Index < Helper.Num(); ++Index)
+			{
+				NetSerializeValue(Writer, ArrayProperty->Inner, Helper.GetRawPtr(Index));
+			}
+		}
+		else
+		{
+			Property->NetSerializeItem(Writer, nullptr, Value);
+		}
+	}
+
+	int64 GetNetSerializedBytes(const FName PropertyName, void* Value)
+	{
+		FBitWriter Writer(0, true);
+		NetSerializeValue(Writer, FindFProperty<FProperty>(AMPlayerState::StaticClass(), PropertyName), Value);
+		return Writer.GetNumBytes();
+	}
+
+	/*
+	 *	Bits Profile costs against Baseline the way a connection would send it.
+	 *	Round trip equality is covered by the MultiplayerExample.Replication.ProfileDelta automation test.
+	 **/
+	int64 GetProfileDeltaBits(FCharacterProfile& Profile, TSharedPtr<INetDeltaBaseState>& Baseline)
+	{
+		FBitWriter Writer(0, true);
+		TSharedPtr<INetDeltaBaseState> NewState;
+
+		FNetDeltaSerializeInfo WriteParms;
+		WriteParms.Writer = &Writer;
+		WriteParms.OldState = Baseline.Get();
+		WriteParms.NewState = &NewState;
+		if (!Profile.NetDeltaSerialize(WriteParms))
+		{
+			return 0;
+		}
+
+		Baseline = NewState;
+		return Writer.GetNumBits();
+	}
+}
+
+static FAutoConsoleCommand MeasurePlayerStateCommand(
+	TEXT("MP.Replication.MeasurePlayerState"),
+	TEXT("Estimates the player state payload of a full session and the packed profile sizes. Usage: MP.Replication.MeasurePlayerState [Players=100] [Stacks=20]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumPlayers = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 100;
+		const int32 NumStacks = Args.Num() > 1 ? FMath::Max(0, FCString::Atoi(*Args[1])) : 20;
+
+		FCharacterData Character;
+		Character.Name = TEXT("Player_000");
+		Character.Level = 50;
+		Character.ID = FGuid::NewGuid().ToString(EGuidFormats::Digits).Left(20);
+		for (int32 Index = 0; Index < NumStacks; ++Index)
+		{
+			FInventoryJson& Item = Character.Inventory.AddDefaulted_GetRef();
+			Item.ItemId = FString::Printf(TEXT("item_%03d"), Index);
+			Item.ItemCount = 99;
+		}
+
+		FCharacterProfile Profile(Character);
+
+		const int64 CharacterBytes = GetNetSerializedBytes(TEXT("CharacterData"), &Character);
+		const int64 GenericProfileBytes = GetNetSerializedBytes(TEXT("Profile"), &Profile);
+		const int64 InventoryBytes = CharacterBytes - GenericProfileBytes;
+
+		// Packed profile, first send to a connection and a later level up against the acknowledged baseline
+		TSharedPtr<INetDeltaBaseState> Baseline;
+		const int64 FirstSendBits = GetProfileDeltaBits(Profile, Baseline);
+
+		++Profile.Level;
+		const int64 LevelUpBits = GetProfileDeltaBits(Profile, Baseline);
+
+		const int64 UnchangedBits = GetProfileDeltaBits(Profile, Baseline);
+		const int64 ProfileBytes = (FirstSendBits + 7) / 8;
+
+		// Before: full character data to every connection plus the owner only inventory. After: profile to everyone, inventory to the owner
+		const int64 Players = NumPlayers;
+		const int64 Before = Players * (Players * CharacterBytes + InventoryBytes);
+		const int64 After = Players * (Players * ProfileBytes + InventoryBytes);
+
+		UE_LOG(LogTemp, Display, TEXT("Player state payload for %d players with %d stacks: character %lld B, profile %lld B, inventory %lld B"),
+		       NumPlayers, NumStacks, CharacterBytes, ProfileBytes, InventoryBytes);
+		UE_LOG(LogTemp, Display, TEXT("  Profile: generic %lld bits, packed first send %lld bits, level up %lld bits, unchanged %lld bits"),
+		       GenericProfileBytes * 8, FirstSendBits, LevelUpBits, UnchangedBits);
+		UE_LOG(LogTemp, Display, TEXT("  Session total before %.1f KB, after %.1f KB, %.1f%% saved"), Before / 1024.0, After / 1024.0,
+		       Before > 0 ? 100.0 * (Before - After) / Before : 0.0);
+	}));
+
+AMPlayerState::AMPlayerState()
+{
+	DormancyDelay = 5.f;
+}
+
+void AMPlayerState::SyncPlayerState_Implementation()
+{
+	if (UCharacterPersistence* Persistence = GetGameInstance()->GetSubsystem<UCharacterPersistence>())
+	{
+		Persistence->Flush({this});
+	}
+}
 
 void AMPlayerState::Server_AddInventoryItem_Implementation()
 {
@@ -49,29 +173,128 @@ void AMPlayerState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLif
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME_CONDITION_NOTIFY(AMPlayerState, Inventory, COND_OwnerOnly, REPNOTIFY_Always);
-	DOREPLIFETIME_CONDITION_NOTIFY(AMPlayerState, CharacterData, COND_None, REPNOTIFY_Always);
+	// Push model is only compiled into the server target, elsewhere both properties are compared every update as usual
+	// and the MARK_PROPERTY_DIRTY calls compile to nothing
+	FDoRepLifetimeParams InventoryParams;
+	InventoryParams.Condition = COND_OwnerOnly;
+
+	FDoRepLifetimeParams ProfileParams;
+	ProfileParams.RepNotifyCondition = REPNOTIFY_Always;
+
+#if WITH_PUSH_MODEL
+	InventoryParams.bIsPushBased = true;
+	ProfileParams.bIsPushBased = true;
+#endif
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(AMPlayerState, Inventory, InventoryParams);
+	DOREPLIFETIME_WITH_PARAMS_FAST(AMPlayerState, Profile, ProfileParams);
 }
 
 void AMPlayerState::SetCharacterData(FCharacterData InData)
 {
 	if (GetLocalRole() < ROLE_Authority) return;
-	CharacterData = InData;
-	Inventory = CharacterData.Inventory;
-	OnRep_CharacterData();
+	Inventory.Assign(InData.Inventory);
+	CharacterData = MoveTemp(InData);
+	CharacterData.Inventory.Empty();
+	Profile = FCharacterProfile(CharacterData);
+	OnRep_Profile();
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(AMPlayerState, Inventory, this);
+	MARK_PROPERTY_DIRTY_FROM_NAME(AMPlayerState, Profile, this);
+	WakeForReplication();
+}
+
+void AMPlayerState::WakeForReplication()
+{
+	LastReplicatedChangeTime = GetWorld()->GetRealTimeSeconds();
+
+	// Already dormant, send the change once and stay asleep
+	if (NetDormancy > DORM_Awake)
+	{
+		FlushNetDormancy();
+		return;
+	}
+
+	// Still sending the initial state, sleep once it has had time to reach everyone
+	if (DormancyDelay > 0.f)
+	{
+		GetWorldTimerManager().SetTimer(DormancyTimerHandle, FTimerDelegate::CreateWeakLambda(this, [this]()
+		{
+			SetNetDormancy(DORM_DormantAll);
+		}), DormancyDelay, false);
+	}
+}
+
+void AMPlayerState::MarkPersistenceDirty(const FInventoryJson& Item)
+{
+	if (Item.ItemCount == 0)
+	{
+		return;
+	}
+
+	if (UnsavedItems.Num() == 0)
+	{
+		PersistenceDirtyTime = GetWorld()->GetRealTimeSeconds();
+	}
+
+	// updateInventory adds the count to the stack, changes to the same item are saved as one
+	FInventoryJson* Unsaved = UnsavedItems.FindByPredicate([&Item](const FInventoryJson& Other) { return Other.ItemId == Item.ItemId; });
+	if (!Unsaved)
+	{
+		UnsavedItems.Add(Item);
+	}
+	else if ((Unsaved->ItemCount += Item.ItemCount) == 0)
+	{
+		UnsavedItems.RemoveAtSwap(Unsaved - UnsavedItems.GetData());
+	}
+}
+
+bool AMPlayerState::ConfirmPersisted(const FInventoryJson& Item)
+{
+	const int32 Index = UnsavedItems.IndexOfByPredicate([&Item](const FInventoryJson& Other) { return Other.ItemId == Item.ItemId; });
+	if (Index != INDEX_NONE && (UnsavedItems[Index].ItemCount -= Item.ItemCount) == 0)
+	{
+		UnsavedItems.RemoveAtSwap(Index);
+	}
+
+	return UnsavedItems.Num() == 0;
+}
+
+FCharacterData AMPlayerState::GetSaveData() const
+{
+	FCharacterData SaveData = CharacterData;
+	SaveData.Inventory = Inventory.ToArray();
+	return SaveData;
 }
 
-void AMPlayerState::OnRep_CharacterData()
+void AMPlayerState::OnRep_Profile()
 {
-	SetPlayerName(CharacterData.Name);
+	if (GetLocalRole() < ROLE_Authority)
+	{
+		CharacterData.Name = Profile.Name;
+		CharacterData.Level = Profile.Level;
+		CharacterData.ID = Profile.ID;
+	}
+
+	SetPlayerName(Profile.Name);
+}
+
+void AMPlayerState::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	Inventory.OnReceived.AddUObject(this, &ThisClass::OnRep_InventoryChanged);
 }
 
 void AMPlayerState::OnRep_InventoryChanged()
 {
-	OnInventoryChanged.Broadcast(Inventory);
+	OnInventoryChanged.Broadcast(Inventory.ToArray());
 }
 
 void AMPlayerState::OnUpdatedInventory(const TArray<FInventoryJson>& UpdatedInventory)
 {
-	Inventory = UpdatedInventory;
+	Inventory.Assign(UpdatedInventory);
+
+	MARK_PROPERTY_DIRTY_FROM_NAME(AMPlayerState, Inventory, this);
+	WakeForReplication();
 }
@@ -0,0 +1,210 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Misc/AutomationTest.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/BitWriter.h"
+#include "Types/GlobalTypes.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace CharacterProfileTest
+{
+	/*
+	 *	Sends Profile against Baseline the way a connection would and reads it into Received, which keeps what the
+	 *	client already had. Returns the bits written, zero when nothing was sent.
+	 **/
+	int64 RoundTrip(FCharacterProfile& Profile, TSharedPtr<INetDeltaBaseState>& Baseline, FCharacterProfile& Received)
+	{
+		FBitWriter Writer(0, true);
+		TSharedPtr<INetDeltaBaseState> NewState;
+
+		FNetDeltaSerializeInfo WriteParms;
+		WriteParms.Writer = &Writer;
+		WriteParms.OldState = Baseline.Get();
+		WriteParms.NewState = &NewState;
+		if (!Profile.NetDeltaSerialize(WriteParms))
+		{
+			return 0;
+		}
+
+		Baseline = NewState;
+
+		FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+		FNetDeltaSerializeInfo ReadParms;
+		ReadParms.Reader = &Reader;
+		Received.NetDeltaSerialize(ReadParms);
+		return Writer.GetNumBits();
+	}
+
+	int64 GetStringBits(FString Value)
+	{
+		FBitWriter Writer(0, true);
+		Writer << Value;
+		return Writer.GetNumBits();
+	}
+
+	/*
+	 *	Zigzag encoded, then a byte per started 7 bits
+	 **/
+	int64 GetLevelBits(const int32 Level)
+	{
+		uint32 Packed = (static_cast<uint32>(Level) << 1) ^ static_cast<uint32>(Level >> 31);
+		int64 Bytes = 1;
+		while (Packed >>= 7)
+		{
+			++Bytes;
+		}
+
+		return Bytes * 8;
+	}
+
+	FCharacterProfile MakeProfile()
+	{
+		FCharacterProfile Profile;
+		Profile.ID = TEXT("k3J9xQ2mPz8wLr5tYb1c");
+		Profile.Name = TEXT("Player_000");
+		Profile.Level = 50;
+		return Profile;
+	}
+}
+
+/*
+ *	Every field mask the profile delta serializer can send, checked for round trip equality and for its exact bit count
+ **/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCharacterProfileDeltaTest, "MultiplayerExample.Replication.ProfileDelta",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FCharacterProfileDeltaTest::RunTest(const FString& Parameters)
+{
+	using namespace CharacterProfileTest;
+
+	constexpr int64 MaskBits = FCharacterProfile::NumFieldBits;
+
+	FCharacterProfile Profile = MakeProfile();
+	FCharacterProfile Received;
+	TSharedPtr<INetDeltaBaseState> Baseline;
+
+	// First send to a connection carries every field
+	TestEqual(TEXT("First send mask"), static_cast<int32>(Profile.GetChangedFields(FCharacterProfile())),
+	          static_cast<int32>(FCharacterProfile::Field_All));
+	int64 Bits = RoundTrip(Profile, Baseline, Received);
+	TestTrue(TEXT("First send round trips"), Received == Profile);
+	TestEqual(TEXT("First send bits"), Bits, MaskBits + GetStringBits(Profile.ID) + GetStringBits(Profile.Name) + GetLevelBits(Profile.Level));
+	const int64 FirstSendBits = Bits;
+
+	// Unchanged against the acknowledged baseline sends nothing and keeps the baseline
+	const TSharedPtr<INetDeltaBaseState> AcknowledgedBaseline = Baseline;
+	Bits = RoundTrip(Profile, Baseline, Received);
+	TestEqual(TEXT("Unchanged sends nothing"), Bits, int64(0));
+	TestTrue(TEXT("Unchanged keeps the baseline"), Baseline == AcknowledgedBaseline);
+	TestTrue(TEXT("Unchanged leaves the client as it was"), Received == Profile);
+
+	// Level up, the common case, is the mask and one byte
+	++Profile.Level;
+	TestEqual(TEXT("Level up mask"), static_cast<int32>(Profile.GetChangedFields(Received)), static_cast<int32>(FCharacterProfile::Field_Level));
+	Bits = RoundTrip(Profile, Baseline, Received);
+	TestTrue(TEXT("Level up round trips"), Received == Profile);
+	TestEqual(TEXT("Level up bits"), Bits, MaskBits + 8);
+	AddInfo(FString::Printf(TEXT("First send %lld bits, level up %lld bits"), FirstSendBits, Bits));
+
+	// Negative and extreme levels survive the zigzag encoding
+	for (const int32 Level : { -1, -3, -64, -65, 63, 64, 100000, TNumericLimits<int32>::Max(), TNumericLimits<int32>::Min() })
+	{
+		Profile.Level = Level;
+		Bits = RoundTrip(Profile, Baseline, Received);
+		TestEqual(FString::Printf(TEXT("Level %d round trips"), Level), Received.Level, Level);
+		TestEqual(FString::Printf(TEXT("Level %d bits"), Level), Bits, MaskBits + GetLevelBits(Level));
+	}
+
+	TestEqual(TEXT("Small negative levels pack into one byte"), GetLevelBits(-64), int64(8));
+	TestEqual(TEXT("Full range levels pack into five bytes"), GetLevelBits(TNumericLimits<int32>::Min()), int64(40));
+
+	// Name change alone, including characters outside ANSI
+	Profile.Name = TEXT("Renamed_\u00C5sa");
+	TestEqual(TEXT("Name mask"), static_cast<int32>(Profile.GetChangedFields(Received)), static_cast<int32>(FCharacterProfile::Field_Name));
+	Bits = RoundTrip(Profile, Baseline, Received);
+	TestTrue(TEXT("Name change round trips"), Received == Profile);
+	TestEqual(TEXT("Name change bits"), Bits, MaskBits + GetStringBits(Profile.Name));
+
+	// ID change alone, the player state was reused for another character
+	Profile.ID = TEXT("Zz0Yy1Xx2Ww3Vv4Uu5Tt");
+	TestEqual(TEXT("ID mask"), static_cast<int32>(Profile.GetChangedFields(Received)), static_cast<int32>(FCharacterProfile::Field_ID));
+	Bits = RoundTrip(Profile, Baseline, Received);
+	TestTrue(TEXT("ID change round trips"), Received == Profile);
+	TestEqual(TEXT("ID change bits"), Bits, MaskBits + GetStringBits(Profile.ID));
+
+	// Two fields at once
+	Profile.Name = TEXT("Player_001");
+	Profile.Level = 2;
+	TestEqual(TEXT("Name and level mask"), static_cast<int32>(Profile.GetChangedFields(Received)),
+	          static_cast<int32>(FCharacterProfile::Field_Name | FCharacterProfile::Field_Level));
+	Bits = RoundTrip(Profile, Baseline, Received);
+	TestTrue(TEXT("Name and level round trip"), Received == Profile);
+	TestEqual(TEXT("Name and level bits"), Bits, MaskBits + GetStringBits(Profile.Name) + GetLevelBits(Profile.Level));
+
+	// A new connection has no baseline and gets everything again
+	TSharedPtr<INetDeltaBaseState> NewConnectionBaseline;
+	FCharacterProfile NewConnectionReceived;
+	Bits = RoundTrip(Profile, NewConnectionBaseline, NewConnectionReceived);
+	TestTrue(TEXT("New connection round trips"), NewConnectionReceived == Profile);
+	TestEqual(TEXT("New connection bits"), Bits,
+	          MaskBits + GetStringBits(Profile.ID) + GetStringBits(Profile.Name) + GetLevelBits(Profile.Level));
+
+	return true;
+}
+
+/*
+ *	NetSerialize writes every field in the packed format, without a mask
+ **/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCharacterProfileNetSerializeTest, "MultiplayerExample.Replication.ProfileNetSerialize",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FCharacterProfileNetSerializeTest::RunTest(const FString& Parameters)
+{
+	using namespace CharacterProfileTest;
+
+	for (const int32 Level : { 0, 50, -7, TNumericLimits<int32>::Max() })
+	{
+		FCharacterProfile Profile = MakeProfile();
+		Profile.Level = Level;
+
+		bool bSuccess = false;
+		FBitWriter Writer(0, true);
+		Profile.NetSerialize(Writer, nullptr, bSuccess);
+		TestTrue(FString::Printf(TEXT("Level %d writes"), Level), bSuccess);
+		TestEqual(FString::Printf(TEXT("Level %d bits"), Level), Writer.GetNumBits(),
+		          GetStringBits(Profile.ID) + GetStringBits(Profile.Name) + GetLevelBits(Level));
+
+		FCharacterProfile Received;
+		FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+		Received.NetSerialize(Reader, nullptr, bSuccess);
+		TestTrue(FString::Printf(TEXT("Level %d reads"), Level), bSuccess);
+		TestTrue(FString::Printf(TEXT("Level %d round trips"), Level), Received == Profile);
+	}
+
+	return true;
+}
+
+#endif
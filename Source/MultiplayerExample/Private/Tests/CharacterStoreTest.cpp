@@ -0,0 +1,199 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Misc/AutomationTest.h"
+#include "Types/CharacterStore.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace CharacterStoreTest
+{
+	FCharacterData MakeCharacter(const TCHAR* ID, const int32 Level)
+	{
+		FCharacterData Character;
+		Character.ID = ID;
+		Character.Name = FString::Printf(TEXT("Name_%s"), ID);
+		Character.Level = Level;
+		return Character;
+	}
+
+	/*
+	 *	Counts the delegates a store fires, the widgets only rebuild what these report
+	 **/
+	struct FEvents
+	{
+		int32 Added = 0;
+		int32 Updated = 0;
+		int32 Removed = 0;
+
+		explicit FEvents(FCharacterStore& Store)
+		{
+			Store.OnCharacterAdded.AddLambda([this](const FCharacterData&) { ++Added; });
+			Store.OnCharacterUpdated.AddLambda([this](const FCharacterData&) { ++Updated; });
+			Store.OnCharacterRemoved.AddLambda([this](const FString&) { ++Removed; });
+		}
+
+		void Reset() { Added = Updated = Removed = 0; }
+	};
+
+	FString GetIDs(const FCharacterStore& Store)
+	{
+		TArray<FString> IDs;
+		for (const FCharacterData& Character : Store.GetAll())
+		{
+			IDs.Add(Character.ID);
+		}
+
+		return FString::Join(IDs, TEXT(","));
+	}
+}
+
+/*
+ *	The revision protocol of syncCharacters: a full response replaces the list, a delta merges changed and removed
+ *	characters, and a delta that is not newer than the stored revision leaves the store alone
+ **/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCharacterStoreDeltaTest, "MultiplayerExample.CharacterStore.Delta",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FCharacterStoreDeltaTest::RunTest(const FString& Parameters)
+{
+	using namespace CharacterStoreTest;
+
+	FCharacterStore Store;
+	FEvents Events(Store);
+
+	// First sync from revision 0 is full
+	TestTrue(TEXT("Full sync applies"), Store.ApplyDelta({MakeCharacter(TEXT("a"), 1), MakeCharacter(TEXT("b"), 1), MakeCharacter(TEXT("c"), 1)},
+	                                                     {}, 5, true));
+	TestEqual(TEXT("Full sync list"), GetIDs(Store), FString(TEXT("a,b,c")));
+	TestEqual(TEXT("Full sync revision"), Store.GetRevision(), static_cast<int64>(5));
+	TestEqual(TEXT("Full sync adds"), Events.Added, 3);
+
+	const FCharacterHandle HandleOfC = Store.FindHandle(TEXT("c"));
+
+	// Changed and removed characters
+	Events.Reset();
+	TestTrue(TEXT("Newer delta applies"), Store.ApplyDelta({MakeCharacter(TEXT("a"), 2), MakeCharacter(TEXT("d"), 1)}, {TEXT("b")}, 7, false));
+	TestEqual(TEXT("Delta list keeps order and appends"), GetIDs(Store), FString(TEXT("a,c,d")));
+	TestEqual(TEXT("Delta revision"), Store.GetRevision(), static_cast<int64>(7));
+	TestEqual(TEXT("Delta updates"), Events.Updated, 1);
+	TestEqual(TEXT("Delta adds"), Events.Added, 1);
+	TestEqual(TEXT("Delta removes"), Events.Removed, 1);
+	TestEqual(TEXT("Changed character level"), Store.Find(TEXT("a")) ? Store.Find(TEXT("a"))->Level : 0, 2);
+	TestNull(TEXT("Removed character is gone"), Store.Find(TEXT("b")));
+	TestTrue(TEXT("Handle survives removal of an earlier character"), Store.Find(HandleOfC) && Store.Find(HandleOfC)->ID == TEXT("c"));
+
+	// A changed character that did not actually change fires nothing
+	Events.Reset();
+	TestTrue(TEXT("Unchanged delta applies"), Store.ApplyDelta({MakeCharacter(TEXT("a"), 2)}, {TEXT("missing")}, 8, false));
+	TestEqual(TEXT("Identical character fires no update"), Events.Updated, 0);
+	TestEqual(TEXT("Unknown removal fires nothing"), Events.Removed, 0);
+
+	// Equal and older revisions arrive late, the store is already past them
+	Events.Reset();
+	TestFalse(TEXT("Equal revision is ignored"), Store.ApplyDelta({MakeCharacter(TEXT("a"), 9)}, {TEXT("c")}, 8, false));
+	TestFalse(TEXT("Older revision is ignored"), Store.ApplyDelta({MakeCharacter(TEXT("a"), 9)}, {TEXT("c")}, 6, false));
+	TestEqual(TEXT("Ignored deltas change nothing"), GetIDs(Store), FString(TEXT("a,c,d")));
+	TestEqual(TEXT("Ignored deltas keep the level"), Store.Find(TEXT("a")) ? Store.Find(TEXT("a"))->Level : 0, 2);
+	TestEqual(TEXT("Ignored deltas keep the revision"), Store.GetRevision(), static_cast<int64>(8));
+	TestEqual(TEXT("Ignored deltas fire nothing"), Events.Added + Events.Updated + Events.Removed, 0);
+
+	// A full response is authoritative, whatever is missing from it goes
+	Events.Reset();
+	TestTrue(TEXT("Full resync applies"), Store.ApplyDelta({MakeCharacter(TEXT("d"), 1), MakeCharacter(TEXT("a"), 2)}, {}, 12, true));
+	TestEqual(TEXT("Full resync list and order"), GetIDs(Store), FString(TEXT("d,a")));
+	TestEqual(TEXT("Full resync removes"), Events.Removed, 1);
+	TestEqual(TEXT("Full resync updates nothing"), Events.Updated, 0);
+	TestFalse(TEXT("Handle of a removed character is stale"), Store.Find(HandleOfC) != nullptr);
+
+	// getAllCharacters carries no revision, the next delta starts from scratch and is accepted whatever its revision
+	Store.SetRevision(0);
+	TestTrue(TEXT("Delta after an unrevisioned list applies"), Store.ApplyDelta({MakeCharacter(TEXT("e"), 1)}, {}, 3, false));
+	TestEqual(TEXT("Delta after an unrevisioned list"), GetIDs(Store), FString(TEXT("d,a,e")));
+
+	return true;
+}
+
+/*
+ *	Assign keeps the incoming order, fires a delegate only for characters that were added, changed or removed, and
+ *	keeps the handles of characters that stay in the list
+ **/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCharacterStoreAssignTest, "MultiplayerExample.CharacterStore.Assign",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FCharacterStoreAssignTest::RunTest(const FString& Parameters)
+{
+	using namespace CharacterStoreTest;
+
+	FCharacterStore Store;
+	FEvents Events(Store);
+
+	Store.Assign({MakeCharacter(TEXT("A"), 1), MakeCharacter(TEXT("B"), 1), MakeCharacter(TEXT("C"), 1)});
+	TestEqual(TEXT("Initial order"), GetIDs(Store), FString(TEXT("A,B,C")));
+	TestEqual(TEXT("Initial adds"), Events.Added, 3);
+
+	const FCharacterHandle A = Store.FindHandle(TEXT("A"));
+	const FCharacterHandle B = Store.FindHandle(TEXT("B"));
+	TestTrue(TEXT("Stored characters have handles"), A.IsValid() && B.IsValid() && A != B);
+
+	Events.Reset();
+	Store.Assign({MakeCharacter(TEXT("C"), 1), MakeCharacter(TEXT("B"), 2), MakeCharacter(TEXT("D"), 1)});
+	TestEqual(TEXT("Reordered to the incoming list"), GetIDs(Store), FString(TEXT("C,B,D")));
+	TestEqual(TEXT("Only the new character is added"), Events.Added, 1);
+	TestEqual(TEXT("Only the changed character is updated"), Events.Updated, 1);
+	TestEqual(TEXT("Only the missing character is removed"), Events.Removed, 1);
+
+	const FCharacterData* Moved = Store.Find(B);
+	if (TestNotNull(TEXT("Handle survives a reorder"), Moved))
+	{
+		TestEqual(TEXT("Handle points at the moved character"), Moved->ID, FString(TEXT("B")));
+		TestEqual(TEXT("Handle sees the update"), Moved->Level, 2);
+	}
+
+	// D may have been given A's old slot, the serial tells them apart
+	TestNull(TEXT("Removed character's handle is stale"), Store.Find(A));
+	TestNull(TEXT("Removed character is not found by ID"), Store.Find(FString(TEXT("A"))));
+
+	Events.Reset();
+	Store.Assign({MakeCharacter(TEXT("C"), 1), MakeCharacter(TEXT("B"), 2), MakeCharacter(TEXT("D"), 1)});
+	TestEqual(TEXT("Same list fires nothing"), Events.Added + Events.Updated + Events.Removed, 0);
+
+	Events.Reset();
+	Store.Assign({MakeCharacter(TEXT("B"), 2), MakeCharacter(TEXT("C"), 1), MakeCharacter(TEXT("B"), 2)});
+	TestEqual(TEXT("Duplicate IDs are stored once, at their first position"), GetIDs(Store), FString(TEXT("B,C")));
+	TestEqual(TEXT("Duplicates neither add nor update"), Events.Added + Events.Updated, 0);
+	TestEqual(TEXT("Character missing from the duplicate list is removed"), Events.Removed, 1);
+
+	const FCharacterData* First = Store.GetAll().Num() > 0 ? &Store.GetAll()[0] : nullptr;
+	TestTrue(TEXT("Find by ID and by handle agree after the reorder"), First && Store.Find(B) == First && Store.Find(FString(TEXT("B"))) == First);
+
+	Events.Reset();
+	Store.Assign({});
+	TestEqual(TEXT("Empty list removes everything"), Store.Num(), 0);
+	TestEqual(TEXT("Every character fires a removal"), Events.Removed, 2);
+
+	return true;
+}
+
+#endif
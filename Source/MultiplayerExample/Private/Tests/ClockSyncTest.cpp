@@ -0,0 +1,98 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Core/ClockSync.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/*
+ *	Runs the estimator against simulated latency with a known offset.
+ *	Every sample's offset is off by half the difference between its two legs, so the estimate, which only ever moves
+ *	towards sample offsets, must stay within half the per leg jitter.
+ **/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FClockSyncEstimatorTest, "MultiplayerExample.ClockSync.Estimator",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FClockSyncEstimatorTest::RunTest(const FString& Parameters)
+{
+	struct FScenario
+	{
+		const TCHAR* Name;
+		double LatencyMs;
+		double JitterMs;
+
+		/*
+		 *	Server real time minus client real time, a month of server uptime checks a double keeps sub millisecond offsets
+		 **/
+		double TrueOffset;
+	};
+
+	const FScenario Scenarios[] = {
+		{TEXT("No jitter"), 100.0, 0.0, 1234.5},
+		{TEXT("Asymmetric jitter"), 100.0, 30.0, 1234.5},
+		{TEXT("High latency"), 400.0, 80.0, -52.25},
+		{TEXT("Long uptime"), 60.0, 10.0, 30.0 * 24.0 * 3600.0 + 0.0004},
+	};
+
+	for (const FScenario& Scenario : Scenarios)
+	{
+		FRandomStream Stream(1);
+		FClockSyncEstimator Estimator;
+
+		const double Latency = Scenario.LatencyMs / 1000.0;
+		const double Jitter = Scenario.JitterMs / 1000.0;
+		const double Bound = Jitter / 2.0 + 1e-6;
+
+		double LocalTime = 1000.0;
+		double WorstError = 0.0;
+
+		for (int32 Index = 0; Index < 120; ++Index)
+		{
+			LocalTime += 1.0;
+
+			const double Up = Latency / 2.0 + Stream.FRand() * Jitter;
+			const double Down = Latency / 2.0 + Stream.FRand() * Jitter;
+			Estimator.AddSample(LocalTime, LocalTime + Up + Scenario.TrueOffset, LocalTime + Up + Down);
+
+			WorstError = FMath::Max(WorstError, FMath::Abs(Estimator.GetOffset() - Scenario.TrueOffset));
+		}
+
+		TestTrue(FString::Printf(TEXT("%s has an estimate"), Scenario.Name), Estimator.HasEstimate());
+		TestTrue(FString::Printf(TEXT("%s worst error %.3fms within %.3fms"), Scenario.Name, WorstError * 1000.0, Bound * 1000.0),
+		         WorstError <= Bound);
+		TestEqual(FString::Printf(TEXT("%s snapped only on the first sample"), Scenario.Name), Estimator.GetStats().Snaps, 1);
+		AddInfo(FString::Printf(TEXT("%s: worst error %.3fms, final error %.3fms"), Scenario.Name, WorstError * 1000.0,
+		                        FMath::Abs(Estimator.GetOffset() - Scenario.TrueOffset) * 1000.0));
+	}
+
+	// Pongs that arrive before their ping was sent are clock errors, not samples
+	FClockSyncEstimator Estimator;
+	Estimator.AddSample(10.0, 20.0, 9.0);
+	TestFalse(TEXT("Negative round trip is ignored"), Estimator.HasEstimate());
+
+	return true;
+}
+
+#endif
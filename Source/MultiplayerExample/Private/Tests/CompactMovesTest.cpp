@@ -0,0 +1,308 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Core/MovementBenchmark.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Player/MCharacterMovementComponent.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/BitWriter.h"
+#include "Tests/AutomationCommon.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace CompactMovesTest
+{
+	/*
+	 *	Same seed as the movement benchmark sweep, so both replay the same bot input
+	 **/
+	constexpr int32 Seed = 1;
+
+	constexpr int32 NumBots = 100;
+	constexpr int32 Frames = 600;
+	constexpr float FrameSeconds = 1.f / 30.f;
+
+	IConsoleVariable* GetCompactMovesVariable()
+	{
+		return IConsoleManager::Get().FindConsoleVariable(TEXT("MP.Movement.CompactMoves"));
+	}
+}
+
+/*
+ *	Serializes every move of the seeded bots in both formats, no server needed.
+ *	Compact moves must decode to exactly what the client predicted with, QuantizeAcceleration, and come out smaller.
+ **/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompactMoveSizeTest, "MultiplayerExample.Movement.CompactMoveSize",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FCompactMoveSizeTest::RunTest(const FString& Parameters)
+{
+	using namespace CompactMovesTest;
+
+	IConsoleVariable* CompactMoves = GetCompactMovesVariable();
+	if (!TestNotNull(TEXT("MP.Movement.CompactMoves exists"), CompactMoves))
+	{
+		return false;
+	}
+
+	const int32 PreviousValue = CompactMoves->GetInt();
+	UMCharacterMovementComponent& Movement = *GetMutableDefault<UMCharacterMovementComponent>();
+
+	int64 Bits[2] = { 0, 0 };
+	int32 Moves[2] = { 0, 0 };
+	int32 AccelerationMismatches = 0;
+	float WorstYawError = 0.f;
+	float WorstPitchError = 0.f;
+
+	for (const bool bCompact : { false, true })
+	{
+		CompactMoves->Set(bCompact ? 1 : 0, ECVF_SetByCode);
+
+		for (int32 Index = 0; Index < NumBots; ++Index)
+		{
+			FMovementBotInput Bot(Seed, Index);
+			FRandomStream LookStream(Seed * 104729 + Index);
+			FVector Location(Index * 250.f, 0.f, 90.f);
+			FRotator Look(0.f, LookStream.FRandRange(0.f, 360.f), 0.f);
+
+			for (int32 Frame = 0; Frame < Frames; ++Frame)
+			{
+				Bot.Advance(Frame);
+
+				// Bots look around slowly, the way a player's camera drifts
+				Look.Yaw = FRotator::ClampAxis(Look.Yaw + LookStream.FRandRange(-3.f, 3.f));
+				Look.Pitch = FMath::Clamp(Look.Pitch + LookStream.FRandRange(-1.f, 1.f), -89.f, 89.f);
+
+				FMCharacterNetworkMoveData Sent;
+				Sent.TimeStamp = Frame * FrameSeconds;
+				Sent.Acceleration = Bot.Input.GetClampedToMaxSize(1.f) * Movement.MaxAcceleration;
+				Sent.Location = Location;
+				Sent.ControlRotation = Look;
+				Sent.CompressedMoveFlags = Bot.bJump ? FSavedMove_Character::FLAG_JumpPressed : 0;
+				Sent.MovementMode = MOVE_Walking;
+				Bot.bJump = false;
+
+				Location += Sent.Acceleration.GetSafeNormal() * Movement.MaxWalkSpeed * FrameSeconds;
+
+				FBitWriter Writer(0, true);
+				Sent.Serialize(Movement, Writer, nullptr, ENetworkMoveType::NewMove);
+
+				FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+				FMCharacterNetworkMoveData Received;
+				Received.Serialize(Movement, Reader, nullptr, ENetworkMoveType::NewMove);
+
+				Bits[bCompact] += Writer.GetNumBits();
+				++Moves[bCompact];
+
+				if (bCompact)
+				{
+					const FVector Predicted = UMCharacterMovementComponent::QuantizeAcceleration(Sent.Acceleration, Movement.MaxAcceleration);
+					AccelerationMismatches += FVector(Received.Acceleration) != Predicted ? 1 : 0;
+
+					const FRotator Error = (Received.ControlRotation - Sent.ControlRotation).GetNormalized();
+					WorstYawError = FMath::Max(WorstYawError, FMath::Abs(Error.Yaw));
+					WorstPitchError = FMath::Max(WorstPitchError, FMath::Abs(Error.Pitch));
+				}
+			}
+		}
+	}
+
+	CompactMoves->Set(PreviousValue, ECVF_SetByCode);
+
+	const double StockBitsPerMove = static_cast<double>(Bits[0]) / FMath::Max(Moves[0], 1);
+	const double CompactBitsPerMove = static_cast<double>(Bits[1]) / FMath::Max(Moves[1], 1);
+
+	TestEqual(TEXT("Compact acceleration decodes to the predicted acceleration"), AccelerationMismatches, 0);
+	TestTrue(FString::Printf(TEXT("Control yaw error %.4f within half a step"), WorstYawError),
+	         WorstYawError <= 360.f / 4095.f / 2.f + KINDA_SMALL_NUMBER);
+	TestTrue(FString::Printf(TEXT("Control pitch error %.4f within half a step"), WorstPitchError),
+	         WorstPitchError <= 180.f / 2047.f / 2.f + KINDA_SMALL_NUMBER);
+	TestTrue(TEXT("Compact moves are smaller"), CompactBitsPerMove < StockBitsPerMove);
+
+	AddInfo(FString::Printf(TEXT("%d moves each, stock %.1f bits per move, compact %.1f bits per move, %.1f%% smaller"), Moves[1],
+	                        StockBitsPerMove, CompactBitsPerMove,
+	                        100.0 * (StockBitsPerMove - CompactBitsPerMove) / FMath::Max(StockBitsPerMove, 1.0)));
+	return true;
+}
+
+/*
+ *	Drives the local player's character with the seeded bot input, once with compact moves and once with the stock path,
+ *	and compares what the client actually sent: move RPCs, bits and corrections.
+ **/
+class FCompareCompactMovesCommand : public IAutomationLatentCommand
+{
+public:
+
+	explicit FCompareCompactMovesCommand(FAutomationTestBase* InTest)
+		: Test(InTest)
+	{
+	}
+
+	virtual bool Update() override
+	{
+		using namespace CompactMovesTest;
+
+		IConsoleVariable* CompactMoves = GetCompactMovesVariable();
+		UWorld* World = AutomationCommon::GetAnyGameWorld();
+		APlayerController* PC = World && World->GetNetMode() == NM_Client ? World->GetFirstPlayerController() : nullptr;
+		ACharacter* Character = PC ? PC->GetPawn<ACharacter>() : nullptr;
+
+		if (!CompactMoves || !Character || !Cast<UMCharacterMovementComponent>(Character->GetCharacterMovement()))
+		{
+			if (Mode == 0 && Frame == 0 && GetCurrentRunTime() < PawnTimeout)
+			{
+				return false;
+			}
+
+			Test->AddError(TEXT("Needs a client that joined a server and controls a character"));
+			Restore(CompactMoves);
+			return true;
+		}
+
+		if (Frame == 0)
+		{
+			if (Mode == 0)
+			{
+				PreviousValue = CompactMoves->GetInt();
+			}
+
+			CompactMoves->Set(Mode == 0 ? 1 : 0, ECVF_SetByCode);
+			Bot = FMovementBotInput(Seed, 0);
+		}
+
+		Bot.Apply(Character, Frame);
+
+		if (Frame == WarmupFrames)
+		{
+			UMCharacterMovementComponent::ConsumeSendStats();
+			StartTime = FPlatformTime::Seconds();
+		}
+
+		if (++Frame < WarmupFrames + Frames)
+		{
+			return false;
+		}
+
+		Results[Mode] = UMCharacterMovementComponent::ConsumeSendStats();
+		Seconds[Mode] = FPlatformTime::Seconds() - StartTime;
+		Frame = 0;
+
+		if (++Mode < 2)
+		{
+			return false;
+		}
+
+		Restore(CompactMoves);
+		Report();
+		return true;
+	}
+
+private:
+
+	static constexpr int32 WarmupFrames = 30;
+	static constexpr double PawnTimeout = 30.0;
+
+	void Restore(IConsoleVariable* CompactMoves) const
+	{
+		if (CompactMoves && Mode > 0)
+		{
+			CompactMoves->Set(PreviousValue, ECVF_SetByCode);
+		}
+	}
+
+	void Report() const
+	{
+		const TCHAR* Names[2] = { TEXT("compact"), TEXT("stock") };
+		double BytesPerSecond[2];
+		double BitsPerMove[2];
+
+		FString Csv = TEXT("Mode,MoveRPCs,Seconds,BitsPerMove,BytesPerSecond,Corrections\n");
+
+		for (int32 Index = 0; Index < 2; ++Index)
+		{
+			const FMoveSendStats& Stats = Results[Index];
+			BytesPerSecond[Index] = Stats.Bits / 8.0 / FMath::Max(Seconds[Index], 0.001);
+			BitsPerMove[Index] = static_cast<double>(Stats.Bits) / FMath::Max(Stats.Moves, 1);
+
+			Test->AddInfo(FString::Printf(TEXT("%-7s: %d move RPCs in %.1fs (%.1f/s), %.1f bits each, %.0f B/s, %d corrections"),
+			                              Names[Index], Stats.Moves, Seconds[Index], Stats.Moves / FMath::Max(Seconds[Index], 0.001),
+			                              BitsPerMove[Index], BytesPerSecond[Index], Stats.Corrections));
+
+			Csv += FString::Printf(TEXT("%s,%d,%.3f,%.2f,%.1f,%d\n"), Names[Index], Stats.Moves, Seconds[Index], BitsPerMove[Index],
+			                       BytesPerSecond[Index], Stats.Corrections);
+		}
+
+		Test->TestTrue(TEXT("Both modes sent moves"), Results[0].Moves > 0 && Results[1].Moves > 0);
+		Test->TestTrue(TEXT("Compact move RPCs are smaller"), BitsPerMove[0] < BitsPerMove[1]);
+		Test->AddInfo(FString::Printf(TEXT("Compact saves %.1f%% of move bandwidth"),
+		                              100.0 * (BytesPerSecond[1] - BytesPerSecond[0]) / FMath::Max(BytesPerSecond[1], 1.0)));
+
+		const FString Path = FPaths::ProjectSavedDir() / TEXT("Benchmarks") / FString::Printf(TEXT("CompactMoves_seed%d_%s.csv"),
+			CompactMovesTest::Seed, *FDateTime::Now().ToString());
+
+		if (FFileHelper::SaveStringToFile(Csv, *Path))
+		{
+			Test->AddInfo(FString::Printf(TEXT("Results written to %s"), *FPaths::ConvertRelativePathToFull(Path)));
+		}
+		else
+		{
+			Test->AddWarning(FString::Printf(TEXT("Failed to write compact move results to %s"), *Path));
+		}
+	}
+
+	FAutomationTestBase* Test;
+	FMovementBotInput Bot;
+
+	/*
+	 *	0 runs compact moves, 1 the stock path
+	 **/
+	int32 Mode = 0;
+	int32 Frame = 0;
+	int32 PreviousValue = 1;
+	double StartTime = 0.0;
+
+	FMoveSendStats Results[2];
+	double Seconds[2] = { 0.0, 0.0 };
+};
+
+/*
+ *	Run on a client that has joined a server with a character, with fixed time steps for comparable numbers, e.g. start the
+ *	client with -benchmark -fps=30 and enter Automation RunTests MultiplayerExample.Benchmark.CompactMoves once in game.
+ *	MP.Movement.Stats on the server shows the same comparison from the receiving side.
+ *	Both modes are also written to Saved/Benchmarks/CompactMoves_seed1_<date>.csv.
+ **/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompactMovesComparisonTest, "MultiplayerExample.Benchmark.CompactMoves",
+                                 EAutomationTestFlags::ClientContext | EAutomationTestFlags::PerfFilter)
+
+bool FCompactMovesComparisonTest::RunTest(const FString& Parameters)
+{
+	ADD_LATENT_AUTOMATION_COMMAND(FCompareCompactMovesCommand(this));
+	return true;
+}
+
+#endif
@@ -0,0 +1,146 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Core/InventoryJournal.h"
+#include "HAL/FileManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace InventoryJournalTest
+{
+	FInventoryMutation MakeMutation(const int64 Sequence, const TCHAR* CharacterID, const TCHAR* ItemId, const int32 Count)
+	{
+		FInventoryMutation Mutation;
+		Mutation.seq = Sequence;
+		Mutation.id = CharacterID;
+		Mutation.token = TEXT("token");
+		Mutation.item.ItemId = ItemId;
+		Mutation.item.ItemCount = Count;
+		return Mutation;
+	}
+
+	TArray<FString> ReadLines(const FString& Path)
+	{
+		TArray<FString> Lines;
+		FFileHelper::LoadFileToStringArray(Lines, *Path);
+		return Lines;
+	}
+}
+
+/*
+ *	A journal left behind by a crashed run: the unconfirmed entries are loaded for replay, the torn last line is dropped
+ *	by the startup compaction, and sequences continue after the header.
+ *	Replay responses are fed in directly, confirmed entries leave the file on compaction, rejected ones go to the dead
+ *	letter file and retried ones stay for the next run.
+ **/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryJournalReplayTest, "MultiplayerExample.InventoryJournal.ReplayAndCompaction",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FInventoryJournalReplayTest::RunTest(const FString& Parameters)
+{
+	using namespace InventoryJournalTest;
+
+	const FString Directory = FPaths::AutomationTransientDir() / TEXT("InventoryJournalTest");
+	const FString Path = Directory / TEXT("Inventory_0.journal");
+	IFileManager::Get().DeleteDirectory(*Directory, false, true);
+
+	FString Contents = TEXT("{\"journal\":\"TEST\",\"seq\":5}\n");
+	Contents += UInventoryJournal::ToLine(MakeMutation(5, TEXT("A"), TEXT("Sword"), 1));
+	Contents += UInventoryJournal::ToLine(MakeMutation(6, TEXT("B"), TEXT("Potion"), 3));
+	Contents += TEXT("{\"seq\":7,\"id\":\"A\",\"tok");
+	FFileHelper::SaveStringToFile(Contents, *Path, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM);
+
+	UInventoryJournal* Journal = NewObject<UInventoryJournal>();
+	Journal->JournalPath = Path;
+	Journal->CompactThreshold = 1;
+
+	AddExpectedError(TEXT("Skipping unreadable inventory journal entry"), EAutomationExpectedErrorFlags::Contains, 1);
+	Journal->Load();
+
+	TestEqual(TEXT("Journal ID is kept"), Journal->JournalID, FString(TEXT("TEST")));
+	TestEqual(TEXT("Readable entries are pending"), Journal->Pending.Num(), 2);
+	TestEqual(TEXT("Sequences continue after the last entry"), Journal->NextSequence, static_cast<int64>(7));
+
+	if (!TestTrue(TEXT("Journal file opens"), Journal->OpenFile()))
+	{
+		return false;
+	}
+
+	Journal->Compact();
+	TestEqual(TEXT("Startup compaction drops the torn line"), ReadLines(Path).Num(), 3);
+
+	bool bDurable = false;
+	const int64 Appended = Journal->Append(TEXT("A"), TEXT("token"), MakeMutation(0, TEXT("A"), TEXT("Shield"), 1).item,
+	                                       FSimpleDelegate::CreateLambda([&bDurable]() { bDurable = true; }));
+	TestEqual(TEXT("Appended entry gets the next sequence"), Appended, static_cast<int64>(7));
+	TestFalse(TEXT("Not durable before the flush"), bDurable);
+
+	Journal->FlushToDisk();
+	TestTrue(TEXT("Durable after the flush"), bDurable);
+	TestEqual(TEXT("Flushed entry is pending"), Journal->Pending.Num(), 3);
+	TestEqual(TEXT("Flushed entry is on disk"), ReadLines(Path).Num(), 4);
+
+	// One replay round, answered out of order
+	AddExpectedError(TEXT("Backend rejected journaled inventory mutation"), EAutomationExpectedErrorFlags::Contains, 1);
+	AddExpectedError(TEXT("could not reach the backend"), EAutomationExpectedErrorFlags::Contains, 1);
+	Journal->ReplayInFlight = 3;
+	Journal->OnReplayResponse(7, UInventoryJournal::EReplayResult::Rejected, 400);
+	Journal->OnReplayResponse(5, UInventoryJournal::EReplayResult::Confirmed, 200);
+	Journal->OnReplayResponse(6, UInventoryJournal::EReplayResult::Retry, 503);
+
+	TestEqual(TEXT("Only the retried entry is pending"), Journal->Pending.Num(), 1);
+	TestEqual(TEXT("Confirmed"), Journal->GetStats().Confirmed, 1);
+	TestEqual(TEXT("Dead lettered"), Journal->GetStats().DeadLettered, 1);
+	TestEqual(TEXT("Replay failures"), Journal->GetStats().ReplayFailures, 1);
+
+	const TArray<FString> DeadLetters = ReadLines(Path + TEXT(".deadletter"));
+	TestTrue(TEXT("Rejected entry is in the dead letter file"), DeadLetters.Num() == 1 && DeadLetters[0].Contains(TEXT("Shield")));
+
+	const TArray<FString> Compacted = ReadLines(Path);
+	TestEqual(TEXT("Compaction leaves the header and the retried entry"), Compacted.Num(), 2);
+	TestTrue(TEXT("Retried entry is kept"), Compacted.Num() == 2 && Compacted[1].Contains(TEXT("Potion")));
+
+	Journal->File.Reset();
+
+	// The next run replays what is left and keeps counting up
+	UInventoryJournal* Restarted = NewObject<UInventoryJournal>();
+	Restarted->JournalPath = Path;
+	Restarted->Load();
+
+	TestEqual(TEXT("Same journal after a restart"), Restarted->JournalID, FString(TEXT("TEST")));
+	if (TestTrue(TEXT("Retried entry is replayed after a restart"), Restarted->Pending.Num() == 1))
+	{
+		TestEqual(TEXT("Replayed entry"), Restarted->Pending[0].seq, static_cast<int64>(6));
+		TestTrue(TEXT("Replayed item"), Restarted->Pending[0].item == MakeMutation(6, TEXT("B"), TEXT("Potion"), 3).item);
+	}
+	TestEqual(TEXT("Sequences are not reused after compaction"), Restarted->NextSequence, static_cast<int64>(8));
+
+	IFileManager::Get().DeleteDirectory(*Directory, false, true);
+	return true;
+}
+
+#endif
@@ -0,0 +1,263 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Core/LagCompensation.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace LagCompensationTest
+{
+	constexpr float Radius = 42.f;
+	constexpr float HalfHeight = 96.f;
+	constexpr float Height = 100.f;
+
+	/*
+	 *	Ray along Y through the whole test area at the given X
+	 **/
+	FLagCompensationRay RayAtX(const float X, const int32 IgnoreSlot = INDEX_NONE)
+	{
+		FLagCompensationRay Ray;
+		Ray.Start = FVector(X, -500.f, Height);
+		Ray.End = FVector(X, 500.f, Height);
+		Ray.IgnoreSlot = IgnoreSlot;
+		return Ray;
+	}
+}
+
+/*
+ *	One character moving along X at 300 units per second, recorded every 0.1 seconds.
+ *	Rays 40 units either side of the interpolated position only both hit when the rewind lerps between frames, snapping
+ *	to either neighbouring frame leaves one of them 55 units away.
+ **/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLagCompensationRewindTest, "MultiplayerExample.LagCompensation.Rewind",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FLagCompensationRewindTest::RunTest(const FString& Parameters)
+{
+	using namespace LagCompensationTest;
+
+	FLagCompensationBuffer Buffer;
+	Buffer.Initialize(4, 8);
+
+	const int32 Slot = Buffer.AcquireSlot();
+	for (int32 Frame = 0; Frame <= 5; ++Frame)
+	{
+		const double Time = Frame * 0.1;
+		Buffer.BeginFrame(Time);
+		Buffer.Write(Slot, FVector(300.f * Time, 0.f, Height), Radius, HalfHeight);
+	}
+
+	TestEqual(TEXT("Frames recorded"), Buffer.GetNumFrames(), 6);
+
+	// At 0.45 the character is at X 135, between 120 and 150
+	const FLagCompensationRay Rays[] = {RayAtX(135.f), RayAtX(95.f), RayAtX(175.f), RayAtX(180.f), RayAtX(200.f)};
+
+	TArray<FLagCompensationHit> Hits;
+	if (TestTrue(TEXT("0.45 is inside the history"), Buffer.RewindAndTest(0.45, Rays, Hits)))
+	{
+		TestTrue(TEXT("Ray through the interpolated position hits"), Hits[0].IsHit());
+		TestEqual(TEXT("Hit slot"), Hits[0].Slot, Slot);
+		TestEqual(TEXT("Hit location"), Hits[0].Location, FVector(135.f, 0.f, Height), 0.01f);
+		TestEqual(TEXT("Hit distance"), Hits[0].Distance, 500.f, 0.01f);
+		TestTrue(TEXT("Ray 40 units behind hits"), Hits[1].IsHit());
+		TestTrue(TEXT("Ray 40 units ahead hits"), Hits[2].IsHit());
+		TestFalse(TEXT("Ray 45 units ahead misses"), Hits[3].IsHit());
+		TestFalse(TEXT("Ray 65 units ahead misses"), Hits[4].IsHit());
+	}
+
+	// Past the newest frame the newest frame is used as is, X 150
+	if (TestTrue(TEXT("Time past the newest frame is accepted"), Buffer.RewindAndTest(1.0, Rays, Hits)))
+	{
+		TestTrue(TEXT("Newest frame, ray 15 units behind hits"), Hits[0].IsHit());
+		TestFalse(TEXT("Newest frame, ray 55 units behind misses"), Hits[1].IsHit());
+		TestTrue(TEXT("Newest frame, ray 30 units ahead hits"), Hits[3].IsHit());
+	}
+
+	TestFalse(TEXT("Time before the oldest frame is rejected"), Buffer.RewindAndTest(-0.1, Rays, Hits));
+	TestEqual(TEXT("Rejected rewind still reports one result per ray"), Hits.Num(), static_cast<int32>(UE_ARRAY_COUNT(Rays)));
+	TestFalse(TEXT("Rejected rewind reports no hits"), Hits.ContainsByPredicate([](const FLagCompensationHit& Hit) { return Hit.IsHit(); }));
+
+	// Three more frames push the first ones out of the ring
+	for (int32 Frame = 6; Frame <= 8; ++Frame)
+	{
+		Buffer.BeginFrame(Frame * 0.1);
+		Buffer.Write(Slot, FVector(300.f * Frame * 0.1f, 0.f, Height), Radius, HalfHeight);
+	}
+
+	TestEqual(TEXT("History is capped"), Buffer.GetNumFrames(), 8);
+	TestEqual(TEXT("Oldest frame is overwritten"), Buffer.GetOldestTime(), 0.1, 1e-9);
+	TestFalse(TEXT("Overwritten frame is outside the history"), Buffer.RewindAndTest(0.05, Rays, Hits));
+
+	return true;
+}
+
+/*
+ *	Two characters on the same ray, the nearest one wins unless it is the shooter.
+ *	A character spawned between two frames is tested where it was recorded instead of being lerped from nowhere.
+ **/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLagCompensationHitTest, "MultiplayerExample.LagCompensation.Hits",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FLagCompensationHitTest::RunTest(const FString& Parameters)
+{
+	using namespace LagCompensationTest;
+
+	FLagCompensationBuffer Buffer;
+	Buffer.Initialize(4, 8);
+
+	const int32 Near = Buffer.AcquireSlot();
+	const int32 Far = Buffer.AcquireSlot();
+	const int32 Spawned = Buffer.AcquireSlot();
+
+	Buffer.BeginFrame(0.0);
+	Buffer.Write(Near, FVector(0.f, 0.f, Height), Radius, HalfHeight);
+	Buffer.Write(Far, FVector(0.f, 200.f, Height), Radius, HalfHeight);
+
+	Buffer.BeginFrame(0.1);
+	Buffer.Write(Near, FVector(0.f, 0.f, Height), Radius, HalfHeight);
+	Buffer.Write(Far, FVector(0.f, 200.f, Height), Radius, HalfHeight);
+	Buffer.Write(Spawned, FVector(400.f, 0.f, Height), Radius, HalfHeight);
+
+	const FLagCompensationRay Rays[] = {RayAtX(0.f), RayAtX(0.f, Near), RayAtX(400.f), RayAtX(200.f)};
+
+	TArray<FLagCompensationHit> Hits;
+	if (TestTrue(TEXT("0.05 is inside the history"), Buffer.RewindAndTest(0.05, Rays, Hits)))
+	{
+		TestEqual(TEXT("Nearest character is hit"), Hits[0].Slot, Near);
+		TestEqual(TEXT("Nearest hit distance"), Hits[0].Distance, 500.f, 0.01f);
+		TestEqual(TEXT("Ignored slot is passed through"), Hits[1].Slot, Far);
+		TestEqual(TEXT("Far hit distance"), Hits[1].Distance, 700.f, 0.01f);
+		TestEqual(TEXT("Character recorded in one frame only is tested there"), Hits[2].Slot, Spawned);
+		TestFalse(TEXT("No character halfway to the spawned one"), Hits[3].IsHit());
+	}
+
+	return true;
+}
+
+/*
+ *	A released slot keeps its recorded frames until the ring has wrapped, so it must not be handed out before then
+ **/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLagCompensationSlotTest, "MultiplayerExample.LagCompensation.SlotReuse",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FLagCompensationSlotTest::RunTest(const FString& Parameters)
+{
+	FLagCompensationBuffer Buffer;
+	Buffer.Initialize(2, 4);
+
+	const int32 First = Buffer.AcquireSlot();
+	const int32 Second = Buffer.AcquireSlot();
+	TestTrue(TEXT("Two distinct slots"), First != INDEX_NONE && Second != INDEX_NONE && First != Second);
+	TestEqual(TEXT("No third slot"), Buffer.AcquireSlot(), static_cast<int32>(INDEX_NONE));
+
+	Buffer.ReleaseSlot(First);
+	TestEqual(TEXT("Released slot is not reused in the same frame"), Buffer.AcquireSlot(), static_cast<int32>(INDEX_NONE));
+
+	for (int32 Frame = 1; Frame < 4; ++Frame)
+	{
+		Buffer.BeginFrame(Frame * 0.1);
+		TestEqual(FString::Printf(TEXT("Released slot is not reused after %d frames"), Frame), Buffer.AcquireSlot(),
+		          static_cast<int32>(INDEX_NONE));
+	}
+
+	Buffer.BeginFrame(0.4);
+	TestEqual(TEXT("Released slot is reused once the ring has wrapped"), Buffer.AcquireSlot(), First);
+
+	return true;
+}
+
+/*
+ *	Cost of a rewound hit test with a full server: 100 characters walking around, 64 recorded frames at 30Hz and a
+ *	random shot at a random time in the history, reported per rewind since every fired shot pays it on the game thread
+ **/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLagCompensationCostTest, "MultiplayerExample.Benchmark.LagCompensation",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FLagCompensationCostTest::RunTest(const FString& Parameters)
+{
+	using namespace LagCompensationTest;
+
+	constexpr int32 NumCharacters = 100;
+	constexpr int32 NumFrames = 64;
+	constexpr int32 NumShots = 10000;
+	constexpr double FrameSeconds = 1.0 / 30.0;
+
+	FRandomStream Stream(1);
+
+	FLagCompensationBuffer Buffer;
+	Buffer.Initialize(NumCharacters, NumFrames);
+
+	TArray<int32> Slots;
+	TArray<FVector> Locations;
+	for (int32 Index = 0; Index < NumCharacters; ++Index)
+	{
+		Slots.Add(Buffer.AcquireSlot());
+		Locations.Add(FVector(Stream.FRandRange(-5000.f, 5000.f), Stream.FRandRange(-5000.f, 5000.f), Height));
+	}
+
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		Buffer.BeginFrame(Frame * FrameSeconds);
+		for (int32 Index = 0; Index < NumCharacters; ++Index)
+		{
+			Locations[Index] += FVector(Stream.FRandRange(-20.f, 20.f), Stream.FRandRange(-20.f, 20.f), 0.f);
+			Buffer.Write(Slots[Index], Locations[Index], Radius, HalfHeight);
+		}
+	}
+
+	// Aimed through a random character, from 3000 units away in a random direction
+	TArray<FLagCompensationRay> Shots;
+	TArray<double> ShotTimes;
+	for (int32 Shot = 0; Shot < NumShots; ++Shot)
+	{
+		const FVector Target = Locations[Stream.RandHelper(NumCharacters)];
+		const FVector Direction = Stream.GetUnitVector().GetSafeNormal2D();
+
+		FLagCompensationRay& Ray = Shots.AddDefaulted_GetRef();
+		Ray.Start = Target - Direction * 3000.f;
+		Ray.End = Target + Direction * 3000.f;
+		ShotTimes.Add(Stream.FRandRange(0.f, (NumFrames - 1) * FrameSeconds));
+	}
+
+	int32 Hits = 0;
+	TArray<FLagCompensationHit> Results;
+
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Shot = 0; Shot < NumShots; ++Shot)
+	{
+		if (Buffer.RewindAndTest(ShotTimes[Shot], MakeArrayView(&Shots[Shot], 1), Results) && Results[0].IsHit())
+		{
+			++Hits;
+		}
+	}
+	const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+	TestTrue(TEXT("Shots through characters hit"), Hits > 0);
+	AddInfo(FString::Printf(TEXT("%d characters, %d frames: %.2fus per rewound shot, %d of %d shots hit"), NumCharacters, NumFrames,
+	                        Seconds * 1e6 / NumShots, Hits, NumShots));
+	return true;
+}
+
+#endif
@@ -0,0 +1,182 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Core/MovementBenchmark.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Tests/AutomationCommon.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace MovementBenchmarkTest
+{
+	/*
+	 *	Character counts swept by the test, every run replays the same seeded input
+	 **/
+	const int32 CharacterCounts[] = { 100, 250, 500, 1000, 2000 };
+
+	constexpr int32 Frames = 300;
+	constexpr int32 Seed = 1;
+	constexpr double RunTimeout = 600.0;
+}
+
+/*
+ *	Runs one movement benchmark in the current game world and checks it completed with every character
+ **/
+class FRunMovementBenchmarkCommand : public IAutomationLatentCommand
+{
+public:
+
+	FRunMovementBenchmarkCommand(FAutomationTestBase* InTest, const FMovementBenchmarkParams& InParams,
+	                             const TSharedRef<TArray<FMovementBenchmarkResult>>& InResults)
+		: Test(InTest)
+		, Params(InParams)
+		, Results(InResults)
+	{
+	}
+
+	virtual bool Update() override
+	{
+		if (!bStarted)
+		{
+			bStarted = true;
+
+			UWorld* World = AutomationCommon::GetAnyGameWorld();
+			if (!World)
+			{
+				Test->AddError(TEXT("No game world to run the movement benchmark in"));
+				return true;
+			}
+
+			FAutomationTestBase* LocalTest = Test;
+			const FMovementBenchmarkParams LocalParams = Params;
+			TSharedRef<TArray<FMovementBenchmarkResult>> LocalResults = Results;
+			const bool bStartedRun = FMovementBenchmark::Start(World, Params, FMovementBenchmark::FOnFinished::CreateLambda(
+				[LocalTest, LocalParams, LocalResults](const FMovementBenchmarkResult& Result)
+				{
+					LocalTest->TestEqual(FString::Printf(TEXT("%d characters spawned"), LocalParams.Characters), Result.Characters,
+					                     LocalParams.Characters);
+					LocalTest->TestEqual(FString::Printf(TEXT("%d character run recorded every frame"), LocalParams.Characters),
+					                     Result.Frames, LocalParams.Frames);
+					LocalResults->Add(Result);
+				}));
+
+			if (!bStartedRun)
+			{
+				Test->AddError(FString::Printf(TEXT("Movement benchmark with %d characters did not start"), Params.Characters));
+				return true;
+			}
+
+			return false;
+		}
+
+		if (!FMovementBenchmark::IsRunning())
+		{
+			return true;
+		}
+
+		if (GetCurrentRunTime() > MovementBenchmarkTest::RunTimeout)
+		{
+			Test->AddError(FString::Printf(TEXT("Movement benchmark with %d characters still running after %.0fs"), Params.Characters,
+			                               MovementBenchmarkTest::RunTimeout));
+			return true;
+		}
+
+		return false;
+	}
+
+private:
+
+	FAutomationTestBase* Test;
+	FMovementBenchmarkParams Params;
+	TSharedRef<TArray<FMovementBenchmarkResult>> Results;
+	bool bStarted = false;
+};
+
+DEFINE_LATENT_AUTOMATION_COMMAND_TWO_PARAMETER(FReportMovementBenchmarkSweepCommand, FAutomationTestBase*, Test,
+                                               TSharedRef<TArray<FMovementBenchmarkResult>>, Results);
+
+bool FReportMovementBenchmarkSweepCommand::Update()
+{
+	FString Csv = TEXT("Characters,GameThreadAvgMs,GameThreadP95Ms,GameThreadP99Ms,MovementAvgMs,MovementP95Ms,UsPerCharacter,SpawnMs,KBPerCharacter\n");
+
+	Test->AddInfo(TEXT("Characters | game thread avg / p95 / p99 ms | movement avg / p95 ms | us per character | spawn ms | KB per character"));
+	for (const FMovementBenchmarkResult& Result : *Results)
+	{
+		Test->AddInfo(FString::Printf(TEXT("%10d | %7.3f / %7.3f / %7.3f | %7.3f / %7.3f | %6.2f | %8.1f | %6.1f"), Result.Characters,
+		                              Result.GameThreadAvgMs, Result.GameThreadP95Ms, Result.GameThreadP99Ms, Result.MovementAvgMs,
+		                              Result.MovementP95Ms, Result.MovementUsPerCharacter, Result.SpawnMs, Result.SpawnKBPerCharacter));
+
+		Csv += FString::Printf(TEXT("%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.3f,%.2f,%.2f\n"), Result.Characters, Result.GameThreadAvgMs,
+		                       Result.GameThreadP95Ms, Result.GameThreadP99Ms, Result.MovementAvgMs, Result.MovementP95Ms,
+		                       Result.MovementUsPerCharacter, Result.SpawnMs, Result.SpawnKBPerCharacter);
+	}
+
+	// One row per run, the per frame samples are in each run's own CSV
+	const FString Path = FPaths::ProjectSavedDir() / TEXT("Benchmarks") / FString::Printf(TEXT("MovementSweep_seed%d_%s.csv"),
+		MovementBenchmarkTest::Seed, *FDateTime::Now().ToString());
+
+	if (FFileHelper::SaveStringToFile(Csv, *Path))
+	{
+		Test->AddInfo(FString::Printf(TEXT("Sweep written to %s"), *FPaths::ConvertRelativePathToFull(Path)));
+	}
+	else
+	{
+		Test->AddWarning(FString::Printf(TEXT("Failed to write movement sweep results to %s"), *Path));
+	}
+
+	return true;
+}
+
+/*
+ *	Sweeps the movement benchmark from 100 to 2,000 characters with the same seed, each run also writes its CSV and the
+ *	sweep's summary goes to Saved/Benchmarks/MovementSweep_seed1_<date>.csv.
+ *	Needs a running game world, e.g. a dedicated server with fixed time steps:
+ *	UE4Editor MultiplayerExample -server -nullrhi -benchmark -fps=30 -ExecCmds="Automation RunTests MultiplayerExample.Benchmark.Movement; Quit"
+ **/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMovementBenchmarkSweepTest, "MultiplayerExample.Benchmark.Movement",
+                                 EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::PerfFilter)
+
+bool FMovementBenchmarkSweepTest::RunTest(const FString& Parameters)
+{
+	TSharedRef<TArray<FMovementBenchmarkResult>> Results = MakeShared<TArray<FMovementBenchmarkResult>>();
+
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+
+	for (const int32 Characters : MovementBenchmarkTest::CharacterCounts)
+	{
+		FMovementBenchmarkParams Params;
+		Params.Characters = Characters;
+		Params.Frames = MovementBenchmarkTest::Frames;
+		Params.Seed = MovementBenchmarkTest::Seed;
+
+		ADD_LATENT_AUTOMATION_COMMAND(FRunMovementBenchmarkCommand(this, Params, Results));
+	}
+
+	ADD_LATENT_AUTOMATION_COMMAND(FReportMovementBenchmarkSweepCommand(this, Results));
+	return true;
+}
+
+#endif
@@ -0,0 +1,136 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Misc/AutomationTest.h"
+#include "Net/UnrealNetwork.h"
+#include "Player/MPlayerState.h"
+#include "Serialization/BitWriter.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace PlayerStateReplicationTest
+{
+	const FLifetimeProperty* FindLifetimeProperty(const TArray<FLifetimeProperty>& Props, const FName Name)
+	{
+		const FProperty* Property = FindFProperty<FProperty>(AMPlayerState::StaticClass(), Name);
+		if (!Property)
+		{
+			return nullptr;
+		}
+
+		return Props.FindByPredicate([Property](const FLifetimeProperty& Prop) { return Prop.RepIndex == Property->RepIndex; });
+	}
+
+	/*
+	 *	Bits a full send of a struct costs property by property, the way the rep layout writes it without handles
+	 **/
+	void NetSerializeValue(FBitWriter& Writer, FProperty* Property, void* Value)
+	{
+		if (const FStructProperty* StructProperty = CastField<FStructProperty>(Property))
+		{
+			for (TFieldIterator<FProperty> It(StructProperty->Struct); It; ++It)
+			{
+				NetSerializeValue(Writer, *It, It->ContainerPtrToValuePtr<void>(Value));
+			}
+		}
+		else if (const FArrayProperty* ArrayProperty = CastField<FArrayProperty>(Property))
+		{
+			FScriptArrayHelper Helper(ArrayProperty, Value);
+			uint16 Num = Helper.Num();
+			Writer << Num;
+			for (int32 Index = 0; Index < Helper.Num(); ++Index)
+			{
+				NetSerializeValue(Writer, ArrayProperty->Inner, Helper.GetRawPtr(Index));
+			}
+		}
+		else
+		{
+			Property->NetSerializeItem(Writer, nullptr, Value);
+		}
+	}
+}
+
+/*
+ *	Everyone gets the small public profile, only the owner gets the inventory and the full character is never replicated
+ **/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPlayerStateReplicationTest, "MultiplayerExample.Replication.PlayerStateLayout",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPlayerStateReplicationTest::RunTest(const FString& Parameters)
+{
+	using namespace PlayerStateReplicationTest;
+
+	TArray<FLifetimeProperty> Props;
+	GetDefault<AMPlayerState>()->GetLifetimeReplicatedProps(Props);
+
+	const FLifetimeProperty* Profile = FindLifetimeProperty(Props, TEXT("Profile"));
+	const FLifetimeProperty* Inventory = FindLifetimeProperty(Props, TEXT("Inventory"));
+	const FLifetimeProperty* CharacterData = FindLifetimeProperty(Props, TEXT("CharacterData"));
+
+	if (TestNotNull(TEXT("Profile is replicated"), Profile))
+	{
+		TestEqual(TEXT("Profile goes to everyone"), static_cast<int32>(Profile->Condition), static_cast<int32>(COND_None));
+	}
+
+	if (TestNotNull(TEXT("Inventory is replicated"), Inventory))
+	{
+		TestEqual(TEXT("Inventory only goes to the owner"), static_cast<int32>(Inventory->Condition), static_cast<int32>(COND_OwnerOnly));
+	}
+
+	TestNull(TEXT("Full character data is not replicated"), CharacterData);
+
+	const FProperty* CharacterDataProperty = FindFProperty<FProperty>(AMPlayerState::StaticClass(), TEXT("CharacterData"));
+	TestTrue(TEXT("Full character data is not a net property"), CharacterDataProperty && !CharacterDataProperty->HasAnyPropertyFlags(CPF_Net));
+
+	// The profile carries what other players see and nothing else
+	FCharacterData Character;
+	Character.Name = TEXT("Player_000");
+	Character.Level = 50;
+	Character.ID = TEXT("k3J9xQ2mPz8wLr5tYb1c");
+	for (int32 Index = 0; Index < 20; ++Index)
+	{
+		FInventoryJson& Item = Character.Inventory.AddDefaulted_GetRef();
+		Item.ItemId = FString::Printf(TEXT("item_%03d"), Index);
+		Item.ItemCount = 99;
+	}
+
+	FCharacterProfile ProfileValue(Character);
+	TestEqual(TEXT("Profile name"), ProfileValue.Name, Character.Name);
+	TestEqual(TEXT("Profile level"), ProfileValue.Level, Character.Level);
+	TestEqual(TEXT("Profile ID"), ProfileValue.ID, Character.ID);
+
+	FBitWriter CharacterWriter(0, true);
+	NetSerializeValue(CharacterWriter, FindFProperty<FProperty>(AMPlayerState::StaticClass(), TEXT("CharacterData")), &Character);
+
+	bool bSuccess = false;
+	FBitWriter ProfileWriter(0, true);
+	ProfileValue.NetSerialize(ProfileWriter, nullptr, bSuccess);
+
+	TestTrue(TEXT("Profile is smaller than the full character"), ProfileWriter.GetNumBits() < CharacterWriter.GetNumBits());
+	AddInfo(FString::Printf(TEXT("Full character with 20 stacks %lld bytes, profile %lld bytes"), CharacterWriter.GetNumBytes(),
+	                        ProfileWriter.GetNumBytes()));
+	return true;
+}
+
+#endif
@@ -0,0 +1,301 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Core/MReplicationGraph.h"
+#include "Engine/NetDriver.h"
+#include "EngineUtils.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerStart.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Tests/AutomationCommon.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace ReplicationGraphTest
+{
+	/*
+	 *	Connection counts measured, the same edges as the graph's stats buckets
+	 **/
+	const int32 ConnectionCounts[] = { 50, 100, 200 };
+
+	constexpr int32 FramesPerCount = 300;
+	constexpr double StepTimeout = 300.0;
+
+	/*
+	 *	Spacing of the simulated players' characters, close enough that neighbours share grid cells
+	 **/
+	constexpr float Spacing = 400.f;
+
+	struct FSimulatedClient
+	{
+		TWeakObjectPtr<UNetConnection> Connection;
+		TWeakObjectPtr<APlayerController> Controller;
+		TWeakObjectPtr<APawn> Pawn;
+		FVector Home = FVector::ZeroVector;
+	};
+
+	struct FState
+	{
+		TArray<FSimulatedClient> Clients;
+		FRandomStream Stream{1};
+
+		/*
+		 *	One CSV row per measured connection count
+		 **/
+		FString Results = TEXT("Connections,ServerReplicateActorsAvgMs,Frames\n");
+	};
+
+	UMReplicationGraph* GetGraph(UWorld* World)
+	{
+		UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+		return NetDriver && NetDriver->IsServer() ? Cast<UMReplicationGraph>(NetDriver->GetReplicationDriver()) : nullptr;
+	}
+
+	/*
+	 *	A connection with no socket, owning a spawned controller and character like a logged in player would
+	 **/
+	bool AddClient(UWorld* World, FState& State)
+	{
+		UNetDriver* NetDriver = World->GetNetDriver();
+		const AGameModeBase* GameMode = World->GetAuthGameMode();
+		if (!GameMode)
+		{
+			return false;
+		}
+
+		FVector Origin = FVector::ZeroVector;
+		for (TActorIterator<APlayerStart> It(World); It; ++It)
+		{
+			Origin = It->GetActorLocation();
+			break;
+		}
+
+		const int32 Index = State.Clients.Num();
+		const int32 Columns = 16;
+		const FVector Home = Origin + FVector((Index % Columns - Columns / 2) * Spacing, (Index / Columns) * Spacing, 0.f);
+
+		FActorSpawnParameters SpawnInfo;
+		SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+		SpawnInfo.ObjectFlags |= RF_Transient;
+
+		APlayerController* Controller = World->SpawnActor<APlayerController>(GameMode->PlayerControllerClass, Home, FRotator::ZeroRotator, SpawnInfo);
+		APawn* Pawn = World->SpawnActor<APawn>(GameMode->DefaultPawnClass, Home, FRotator::ZeroRotator, SpawnInfo);
+		if (!Controller || !Pawn)
+		{
+			return false;
+		}
+
+		USimulatedClientNetConnection* Connection = NewObject<USimulatedClientNetConnection>();
+		Connection->InitConnection(NetDriver, USOCK_Open, World->URL, 1000000);
+		Connection->InitSendBuffer();
+		NetDriver->AddClientConnection(Connection);
+
+		Connection->PlayerController = Controller;
+		Connection->OwningActor = Controller;
+		Connection->SetClientLoginState(EClientLoginState::Welcomed);
+		Controller->NetConnection = Connection;
+		Controller->Player = Connection;
+		Controller->Possess(Pawn);
+		Connection->ViewTarget = Pawn;
+
+		FSimulatedClient& Client = State.Clients.AddDefaulted_GetRef();
+		Client.Connection = Connection;
+		Client.Controller = Controller;
+		Client.Pawn = Pawn;
+		Client.Home = Home;
+		return true;
+	}
+}
+
+/*
+ *	Grows the simulated connections to Count and clears the graph's stats so the next measurement only sees this count
+ **/
+DEFINE_LATENT_AUTOMATION_COMMAND_THREE_PARAMETER(FAddSimulatedConnectionsCommand, FAutomationTestBase*, Test,
+                                                 TSharedRef<ReplicationGraphTest::FState>, State, int32, Count);
+
+bool FAddSimulatedConnectionsCommand::Update()
+{
+	UWorld* World = AutomationCommon::GetAnyGameWorld();
+	UMReplicationGraph* Graph = ReplicationGraphTest::GetGraph(World);
+	if (!Graph)
+	{
+		Test->AddError(TEXT("Needs a server world using UMReplicationGraph"));
+		return true;
+	}
+
+	while (State->Clients.Num() < Count)
+	{
+		if (!ReplicationGraphTest::AddClient(World, *State))
+		{
+			Test->AddError(FString::Printf(TEXT("Could not add simulated connection %d"), State->Clients.Num() + 1));
+			return true;
+		}
+	}
+
+	Graph->ResetStats();
+	return true;
+}
+
+/*
+ *	Keeps the characters moving for FramesPerCount frames, then reports the graph's average for the Count bucket
+ **/
+class FMeasureReplicationCommand : public IAutomationLatentCommand
+{
+public:
+
+	FMeasureReplicationCommand(FAutomationTestBase* InTest, const TSharedRef<ReplicationGraphTest::FState>& InState, const int32 InCount)
+		: Test(InTest)
+		, State(InState)
+		, Count(InCount)
+	{
+	}
+
+	virtual bool Update() override
+	{
+		UMReplicationGraph* Graph = ReplicationGraphTest::GetGraph(AutomationCommon::GetAnyGameWorld());
+		if (!Graph || State->Clients.Num() != Count)
+		{
+			// Setting up already failed and reported why
+			return true;
+		}
+
+		if (StartFrame == 0)
+		{
+			StartFrame = GFrameCounter;
+		}
+
+		// Small moves around each home spot, every character is re-bucketed in the grid each frame
+		for (const ReplicationGraphTest::FSimulatedClient& Client : State->Clients)
+		{
+			if (APawn* Pawn = Client.Pawn.Get())
+			{
+				const FVector Offset(State->Stream.FRandRange(-100.f, 100.f), State->Stream.FRandRange(-100.f, 100.f), 0.f);
+				Pawn->SetActorLocation(Client.Home + Offset);
+			}
+		}
+
+		if (GFrameCounter - StartFrame < ReplicationGraphTest::FramesPerCount)
+		{
+			if (GetCurrentRunTime() > ReplicationGraphTest::StepTimeout)
+			{
+				Test->AddError(FString::Printf(TEXT("%d connections: only %llu frames in %.0fs"), Count, GFrameCounter - StartFrame,
+				                               ReplicationGraphTest::StepTimeout));
+				return true;
+			}
+
+			return false;
+		}
+
+		const FReplicationGraphStats& Stats = Graph->GetStats();
+		const int32 Bucket = UMReplicationGraph::GetConnectionBucket(Count);
+
+		Test->TestEqual(FString::Printf(TEXT("%d connections seen by the graph"), Count), Stats.Connections, Count);
+		Test->TestTrue(FString::Printf(TEXT("%d connections replicated frames"), Count), Stats.FramesByConnections[Bucket] > 0);
+		Test->AddInfo(FString::Printf(TEXT("%4d connections: ServerReplicateActors avg %.3fms over %d frames"), Count,
+		                              Stats.AverageMsByConnections[Bucket], Stats.FramesByConnections[Bucket]));
+		State->Results += FString::Printf(TEXT("%d,%.4f,%d\n"), Count, Stats.AverageMsByConnections[Bucket], Stats.FramesByConnections[Bucket]);
+		return true;
+	}
+
+private:
+
+	FAutomationTestBase* Test;
+	TSharedRef<ReplicationGraphTest::FState> State;
+	int32 Count;
+	uint64 StartFrame = 0;
+};
+
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FRemoveSimulatedConnectionsCommand, TSharedRef<ReplicationGraphTest::FState>, State);
+
+bool FRemoveSimulatedConnectionsCommand::Update()
+{
+	for (const ReplicationGraphTest::FSimulatedClient& Client : State->Clients)
+	{
+		if (APawn* Pawn = Client.Pawn.Get())
+		{
+			Pawn->Destroy();
+		}
+
+		// Closing cleans up the connection on the next net tick, which destroys its controller
+		if (UNetConnection* Connection = Client.Connection.Get())
+		{
+			Connection->Close();
+		}
+	}
+
+	State->Clients.Reset();
+	return true;
+}
+
+DEFINE_LATENT_AUTOMATION_COMMAND_TWO_PARAMETER(FWriteReplicationResultsCommand, FAutomationTestBase*, Test,
+                                               TSharedRef<ReplicationGraphTest::FState>, State);
+
+bool FWriteReplicationResultsCommand::Update()
+{
+	// Kept next to the movement benchmark's CSVs so runs on different machines can be compared
+	const FString Path = FPaths::ProjectSavedDir() / TEXT("Benchmarks") / FString::Printf(TEXT("ReplicationGraph_%s.csv"),
+		*FDateTime::Now().ToString());
+
+	if (FFileHelper::SaveStringToFile(State->Results, *Path))
+	{
+		Test->AddInfo(FString::Printf(TEXT("Results written to %s"), *FPaths::ConvertRelativePathToFull(Path)));
+	}
+	else
+	{
+		Test->AddWarning(FString::Printf(TEXT("Failed to write replication graph results to %s"), *Path));
+	}
+
+	return true;
+}
+
+/*
+ *	Replicates a character per simulated connection at 50, 100 and 200 connections and reports the graph's time per net tick,
+ *	the numbers are also written to Saved/Benchmarks/ReplicationGraph_<date>.csv.
+ *	Needs a dedicated server world, e.g.
+ *	UE4Editor MultiplayerExample -server -nullrhi -ExecCmds="Automation RunTests MultiplayerExample.Benchmark.ReplicationGraph; Quit"
+ **/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FReplicationGraphConnectionsTest, "MultiplayerExample.Benchmark.ReplicationGraph",
+                                 EAutomationTestFlags::ServerContext | EAutomationTestFlags::PerfFilter)
+
+bool FReplicationGraphConnectionsTest::RunTest(const FString& Parameters)
+{
+	TSharedRef<ReplicationGraphTest::FState> State = MakeShared<ReplicationGraphTest::FState>();
+
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForMapToLoadCommand());
+
+	for (const int32 Count : ReplicationGraphTest::ConnectionCounts)
+	{
+		ADD_LATENT_AUTOMATION_COMMAND(FAddSimulatedConnectionsCommand(this, State, Count));
+		ADD_LATENT_AUTOMATION_COMMAND(FMeasureReplicationCommand(this, State, Count));
+	}
+
+	ADD_LATENT_AUTOMATION_COMMAND(FWriteReplicationResultsCommand(this, State));
+	ADD_LATENT_AUTOMATION_COMMAND(FRemoveSimulatedConnectionsCommand(State));
+	return true;
+}
+
+#endif
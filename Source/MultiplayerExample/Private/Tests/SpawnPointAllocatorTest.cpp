@@ -0,0 +1,237 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Core/SpawnPointAllocator.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/DefaultPawn.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerStart.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SpawnPointAllocatorTest
+{
+	/*
+	 *	Transient game world the allocator's starts, controllers and pawns are spawned into, destroyed with the scope
+	 **/
+	struct FTestWorld
+	{
+		FTestWorld()
+		{
+			World = UWorld::CreateWorld(EWorldType::Game, false);
+			FWorldContext& Context = GEngine->CreateNewWorldContext(EWorldType::Game);
+			Context.SetCurrentWorld(World);
+		}
+
+		~FTestWorld()
+		{
+			GEngine->DestroyWorldContext(World);
+			World->DestroyWorld(false);
+		}
+
+		template <typename T>
+		T* Spawn(const FVector& Location = FVector::ZeroVector)
+		{
+			FActorSpawnParameters SpawnInfo;
+			SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+			return World->SpawnActor<T>(Location, FRotator::ZeroRotator, SpawnInfo);
+		}
+
+		/*
+		 *	Gives Controller a pawn standing at Location, as if its spawn had completed there
+		 **/
+		APawn* SpawnPawn(AController* Controller, const FVector& Location)
+		{
+			APawn* Pawn = Spawn<ADefaultPawn>(Location);
+			Controller->SetPawn(Pawn);
+			return Pawn;
+		}
+
+		UWorld* World = nullptr;
+	};
+}
+
+/*
+ *	Every start holds one player, consecutive allocations alternate between cells and a full allocator refuses
+ **/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpawnPointAllocatorCapacityTest, "MultiplayerExample.SpawnPointAllocator.Capacity",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpawnPointAllocatorCapacityTest::RunTest(const FString& Parameters)
+{
+	using namespace SpawnPointAllocatorTest;
+
+	FTestWorld TestWorld;
+
+	// The first two share a cell
+	TArray<AActor*> Starts;
+	Starts.Add(TestWorld.Spawn<APlayerStart>(FVector(0.f, 0.f, 100.f)));
+	Starts.Add(TestWorld.Spawn<APlayerStart>(FVector(100.f, 0.f, 100.f)));
+	Starts.Add(TestWorld.Spawn<APlayerStart>(FVector(1000.f, 0.f, 100.f)));
+
+	FSpawnPointAllocator Allocator;
+	Allocator.CellSize = 200.f;
+	Allocator.Initialize(Starts);
+	Allocator.Tick(0.0);
+
+	APlayerController* Controllers[4];
+	for (APlayerController*& Controller : Controllers)
+	{
+		Controller = TestWorld.Spawn<APlayerController>();
+	}
+
+	TestTrue(TEXT("First join gets the first start"), Allocator.Allocate(Controllers[0]) == Starts[0]);
+	TestTrue(TEXT("Second join goes to the other cell"), Allocator.Allocate(Controllers[1]) == Starts[2]);
+	TestTrue(TEXT("Third join shares the first cell on its own start"), Allocator.Allocate(Controllers[2]) == Starts[1]);
+
+	TestFalse(TEXT("Every start is reserved"), Allocator.HasFreeStart());
+	TestNull(TEXT("Fourth join gets no start"), Allocator.Allocate(Controllers[3]));
+	TestEqual(TEXT("Reserved starts"), Allocator.GetNumReserved(), 3);
+
+	for (int32 i = 0; i < 3; ++i)
+	{
+		TestTrue(FString::Printf(TEXT("Join %d has a clear start"), i), Allocator.IsReservedStartClear(Controllers[i]));
+	}
+
+	Allocator.Release(Controllers[1]);
+	TestTrue(TEXT("Released start is free"), Allocator.HasFreeStart());
+	TestTrue(TEXT("Released start is handed out again"), Allocator.Allocate(Controllers[3]) == Starts[2]);
+
+	return true;
+}
+
+/*
+ *	A start is released as soon as its player has stepped off it, freed starts are handed out in release order
+ **/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpawnPointAllocatorReleaseTest, "MultiplayerExample.SpawnPointAllocator.Release",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpawnPointAllocatorReleaseTest::RunTest(const FString& Parameters)
+{
+	using namespace SpawnPointAllocatorTest;
+
+	FTestWorld TestWorld;
+
+	TArray<AActor*> Starts;
+	Starts.Add(TestWorld.Spawn<APlayerStart>(FVector(0.f, 0.f, 100.f)));
+	Starts.Add(TestWorld.Spawn<APlayerStart>(FVector(1000.f, 0.f, 100.f)));
+
+	FSpawnPointAllocator Allocator;
+	Allocator.ReservationTimeout = 2.f;
+	Allocator.Initialize(Starts);
+	Allocator.Tick(0.0);
+
+	APlayerController* First = TestWorld.Spawn<APlayerController>();
+	APlayerController* Second = TestWorld.Spawn<APlayerController>();
+	APlayerController* Third = TestWorld.Spawn<APlayerController>();
+
+	AActor* FirstStart = Allocator.Allocate(First);
+	AActor* SecondStart = Allocator.Allocate(Second);
+	APawn* FirstPawn = TestWorld.SpawnPawn(First, FirstStart->GetActorLocation());
+	APawn* SecondPawn = TestWorld.SpawnPawn(Second, SecondStart->GetActorLocation());
+
+	Allocator.Tick(0.5);
+	TestEqual(TEXT("Players standing on their starts keep them"), Allocator.GetNumReserved(), 2);
+
+	// A few units off the start still overlaps a capsule spawned there
+	FirstPawn->SetActorLocation(FirstStart->GetActorLocation() + FVector(10.f, 0.f, 0.f));
+	Allocator.Tick(0.6);
+	TestEqual(TEXT("Player overlapping the start keeps it"), Allocator.GetNumReserved(), 2);
+
+	SecondPawn->SetActorLocation(SecondStart->GetActorLocation() + FVector(0.f, 300.f, 0.f));
+	Allocator.Tick(0.7);
+	TestEqual(TEXT("Player that stepped off releases the start"), Allocator.GetNumReserved(), 1);
+
+	FirstPawn->SetActorLocation(FirstStart->GetActorLocation() + FVector(300.f, 0.f, 0.f));
+	Allocator.Tick(0.8);
+	TestEqual(TEXT("Both players stepped off"), Allocator.GetNumReserved(), 0);
+
+	TestTrue(TEXT("Start released first is handed out first"), Allocator.Allocate(Third) == SecondStart);
+	TestTrue(TEXT("Start released by stepping off is clear"), Allocator.IsReservedStartClear(Third));
+	TestTrue(TEXT("Released controller holds nothing"), !Allocator.HasReservation(First) && !Allocator.HasReservation(Second));
+
+	return true;
+}
+
+/*
+ *	Reservations that never see their player step off are released after ReservationTimeout.
+ *	A start released without seeing its player step off is not clear, the next spawn there needs the overlap fix-up.
+ **/
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpawnPointAllocatorTimeoutTest, "MultiplayerExample.SpawnPointAllocator.Timeout",
+                                 EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpawnPointAllocatorTimeoutTest::RunTest(const FString& Parameters)
+{
+	using namespace SpawnPointAllocatorTest;
+
+	FTestWorld TestWorld;
+
+	TArray<AActor*> Starts;
+	Starts.Add(TestWorld.Spawn<APlayerStart>(FVector(0.f, 0.f, 100.f)));
+	Starts.Add(TestWorld.Spawn<APlayerStart>(FVector(1000.f, 0.f, 100.f)));
+
+	FSpawnPointAllocator Allocator;
+	Allocator.ReservationTimeout = 2.f;
+	Allocator.Initialize(Starts);
+	Allocator.Tick(10.0);
+
+	APlayerController* Idle = TestWorld.Spawn<APlayerController>();
+	APlayerController* Pending = TestWorld.Spawn<APlayerController>();
+
+	AActor* IdleStart = Allocator.Allocate(Idle);
+	AActor* PendingStart = Allocator.Allocate(Pending);
+	TestWorld.SpawnPawn(Idle, IdleStart->GetActorLocation());
+
+	Allocator.Tick(11.9);
+	TestEqual(TEXT("Reservations are held until the timeout"), Allocator.GetNumReserved(), 2);
+
+	Allocator.Tick(12.0);
+	TestEqual(TEXT("Reservations are released at the timeout"), Allocator.GetNumReserved(), 0);
+
+	APlayerController* Next = TestWorld.Spawn<APlayerController>();
+	APlayerController* Last = TestWorld.Spawn<APlayerController>();
+
+	AActor* NextStart = Allocator.Allocate(Next);
+	AActor* LastStart = Allocator.Allocate(Last);
+	TestTrue(TEXT("Both timed out starts are handed out again"), NextStart && LastStart && NextStart != LastStart);
+
+	AController* OnIdleStart = NextStart == IdleStart ? Next : Last;
+	AController* OnPendingStart = NextStart == PendingStart ? Next : Last;
+	TestFalse(TEXT("Start with a player still on it is not clear"), Allocator.IsReservedStartClear(OnIdleStart));
+	TestFalse(TEXT("Start whose spawn was never seen is not clear either"), Allocator.IsReservedStartClear(OnPendingStart));
+
+	// Controllers that went away release their start on the next check
+	Allocator.Tick(12.1);
+	TestEqual(TEXT("Still reserved"), Allocator.GetNumReserved(), 2);
+	Next->Destroy();
+	Last->Destroy();
+	Allocator.Tick(12.2);
+	TestEqual(TEXT("Destroyed controllers release their starts"), Allocator.GetNumReserved(), 0);
+
+	return true;
+}
+
+#endif
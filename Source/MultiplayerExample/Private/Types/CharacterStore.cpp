@@ -0,0 +1,195 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Types/CharacterStore.h"
+
+FCharacterHandle FCharacterStore::AddOrUpdate(const FCharacterData& Character)
+{
+	if (const int32* ExistingSlot = IdToSlot.Find(Character.ID))
+	{
+		const FSlot& Slot = Slots[*ExistingSlot];
+		FCharacterData& Existing = Characters[Slot.Index];
+		if (Existing != Character)
+		{
+			Existing = Character;
+			OnCharacterUpdated.Broadcast(Existing);
+		}
+
+		return FCharacterHandle(*ExistingSlot, Slot.Serial);
+	}
+
+	const int32 Index = Characters.Add(Character);
+	const int32 SlotIndex = Slots.Add({ Index, NextSerial++ });
+	SlotOfIndex.Add(SlotIndex);
+	IdToSlot.Add(Character.ID, SlotIndex);
+
+	OnCharacterAdded.Broadcast(Characters[Index]);
+	return FCharacterHandle(SlotIndex, Slots[SlotIndex].Serial);
+}
+
+bool FCharacterStore::Remove(const FString& CharacterID)
+{
+	int32 SlotIndex = INDEX_NONE;
+	if (!IdToSlot.RemoveAndCopyValue(CharacterID, SlotIndex))
+	{
+		return false;
+	}
+
+	const int32 Index = Slots[SlotIndex].Index;
+	Characters.RemoveAt(Index);
+	SlotOfIndex.RemoveAt(Index);
+	Slots.RemoveAt(SlotIndex);
+
+	// Everything after the removed entry shifted down by one
+	for (int32 i = Index; i < SlotOfIndex.Num(); ++i)
+	{
+		Slots[SlotOfIndex[i]].Index = i;
+	}
+
+	OnCharacterRemoved.Broadcast(CharacterID);
+	return true;
+}
+
+void FCharacterStore::Assign(const TArray<FCharacterData>& NewList)
+{
+	TSet<FString> Incoming;
+	Incoming.Reserve(NewList.Num());
+	for (const FCharacterData& Character : NewList)
+	{
+		Incoming.Add(Character.ID);
+	}
+
+	// Walk backwards so removals don't shift entries we still have to visit
+	for (int32 i = Characters.Num() - 1; i >= 0; --i)
+	{
+		if (!Incoming.Contains(Characters[i].ID))
+		{
+			Remove(FString(Characters[i].ID));
+		}
+	}
+
+	for (const FCharacterData& Character : NewList)
+	{
+		AddOrUpdate(Character);
+	}
+
+	// Characters that were already stored kept their old position, reorder everything to match the incoming list
+	bool bInOrder = true;
+	for (int32 i = 0; i < Characters.Num() && bInOrder; ++i)
+	{
+		bInOrder = Characters[i].ID == NewList[i].ID;
+	}
+
+	if (bInOrder)
+	{
+		return;
+	}
+
+	TArray<FCharacterData> Ordered;
+	TArray<int32> OrderedSlots;
+	Ordered.Reserve(Characters.Num());
+	OrderedSlots.Reserve(Characters.Num());
+
+	for (const FCharacterData& Character : NewList)
+	{
+		FSlot& Slot = Slots[IdToSlot.FindChecked(Character.ID)];
+
+		// A duplicate ID in the list was already moved on its first occurrence
+		if (Slot.Index == INDEX_NONE)
+		{
+			continue;
+		}
+
+		OrderedSlots.Add(SlotOfIndex[Slot.Index]);
+		Ordered.Add(MoveTemp(Characters[Slot.Index]));
+		Slot.Index = INDEX_NONE;
+	}
+
+	Characters = MoveTemp(Ordered);
+	SlotOfIndex = MoveTemp(OrderedSlots);
+	for (int32 i = 0; i < SlotOfIndex.Num(); ++i)
+	{
+		Slots[SlotOfIndex[i]].Index = i;
+	}
+}
+
+bool FCharacterStore::ApplyDelta(const TArray<FCharacterData>& Changed, const TArray<FString>& Removed, const int64 NewRevision, const bool bFull)
+{
+	if (bFull)
+	{
+		Assign(Changed);
+		Revision = NewRevision;
+		return true;
+	}
+
+	// Changes since a revision we are already past, or already have
+	if (Revision != 0 && NewRevision <= Revision)
+	{
+		return false;
+	}
+
+	for (const FString& CharacterID : Removed)
+	{
+		Remove(CharacterID);
+	}
+
+	for (const FCharacterData& Character : Changed)
+	{
+		AddOrUpdate(Character);
+	}
+
+	Revision = NewRevision;
+	return true;
+}
+
+void FCharacterStore::Reset()
+{
+	Revision = 0;
+	Characters.Reset();
+	SlotOfIndex.Reset();
+	Slots.Reset();
+	IdToSlot.Reset();
+}
+
+const FCharacterData* FCharacterStore::Find(const FString& CharacterID) const
+{
+	const int32* SlotIndex = IdToSlot.Find(CharacterID);
+	return SlotIndex ? &Characters[Slots[*SlotIndex].Index] : nullptr;
+}
+
+const FCharacterData* FCharacterStore::Find(const FCharacterHandle Handle) const
+{
+	if (Handle.IsValid() && Slots.IsValidIndex(Handle.Slot) && Slots[Handle.Slot].Serial == Handle.Serial)
+	{
+		return &Characters[Slots[Handle.Slot].Index];
+	}
+
+	return nullptr;
+}
+
+FCharacterHandle FCharacterStore::FindHandle(const FString& CharacterID) const
+{
+	const int32* SlotIndex = IdToSlot.Find(CharacterID);
+	return SlotIndex ? FCharacterHandle(*SlotIndex, Slots[*SlotIndex].Serial) : FCharacterHandle();
+}
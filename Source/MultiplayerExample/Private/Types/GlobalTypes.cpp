@@ -22,4 +22,92 @@
 * SOFTWARE.
 **/
 
-#include "Types/GlobalTypes.h"
\ No newline at end of file
+#include "Types/GlobalTypes.h"
+
+namespace
+{
+	class FCharacterProfileDeltaState : public INetDeltaBaseState
+	{
+	public:
+
+		explicit FCharacterProfileDeltaState(const FCharacterProfile& InProfile) : Profile(InProfile) {}
+
+		virtual bool IsStateEqual(INetDeltaBaseState* OtherState) override
+		{
+			return Profile == static_cast<FCharacterProfileDeltaState*>(OtherState)->Profile;
+		}
+
+		FCharacterProfile Profile;
+	};
+}
+
+uint8 FCharacterProfile::GetChangedFields(const FCharacterProfile& Baseline) const
+{
+	uint8 Fields = 0;
+	Fields |= ID != Baseline.ID ? Field_ID : 0;
+	Fields |= Name != Baseline.Name ? Field_Name : 0;
+	Fields |= Level != Baseline.Level ? Field_Level : 0;
+	return Fields;
+}
+
+void FCharacterProfile::SerializeFields(FArchive& Ar, const uint8 Fields)
+{
+	if (Fields & Field_ID)
+	{
+		Ar << ID;
+	}
+
+	if (Fields & Field_Name)
+	{
+		Ar << Name;
+	}
+
+	if (Fields & Field_Level)
+	{
+		// Zigzag keeps small negative levels small, packed uses a byte per 7 bits so typical levels fit in one
+		uint32 Packed = (static_cast<uint32>(Level) << 1) ^ static_cast<uint32>(Level >> 31);
+		Ar.SerializeIntPacked(Packed);
+		Level = static_cast<int32>(Packed >> 1) ^ -static_cast<int32>(Packed & 1);
+	}
+}
+
+bool FCharacterProfile::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	SerializeFields(Ar, Field_All);
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
+
+bool FCharacterProfile::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+	if (DeltaParms.Writer)
+	{
+		const FCharacterProfileDeltaState* OldState = static_cast<FCharacterProfileDeltaState*>(DeltaParms.OldState);
+
+		uint8 Fields = OldState ? GetChangedFields(OldState->Profile) : static_cast<uint8>(Field_All);
+		if (Fields == 0)
+		{
+			return false;
+		}
+
+		*DeltaParms.NewState = MakeShared<FCharacterProfileDeltaState>(*this);
+
+		FBitWriter& Writer = *DeltaParms.Writer;
+		Writer.SerializeBits(&Fields, NumFieldBits);
+		SerializeFields(Writer, Fields);
+		return true;
+	}
+
+	if (DeltaParms.Reader)
+	{
+		FBitReader& Reader = *DeltaParms.Reader;
+
+		uint8 Fields = 0;
+		Reader.SerializeBits(&Fields, NumFieldBits);
+		SerializeFields(Reader, Fields);
+		return !Reader.IsError();
+	}
+
+	// No object references to gather or map
+	return false;
+}
@@ -0,0 +1,139 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Types/InventoryArray.h"
+
+const FString& FInventoryArrayEntry::GetItemId() const
+{
+	return Item.IsValid() ? FItemRegistry::Get().GetItemId(Item) : UnregisteredId;
+}
+
+void FInventoryArrayEntry::PreReplicatedRemove(const FInventoryArray& InArraySerializer) const
+{
+	InArraySerializer.OnItemRemoved.Broadcast(*this);
+}
+
+void FInventoryArrayEntry::PostReplicatedAdd(const FInventoryArray& InArraySerializer) const
+{
+	InArraySerializer.OnItemAdded.Broadcast(*this);
+}
+
+void FInventoryArrayEntry::PostReplicatedChange(const FInventoryArray& InArraySerializer) const
+{
+	InArraySerializer.OnItemChanged.Broadcast(*this);
+}
+
+void FInventoryArray::Assign(const TArray<FInventoryJson>& NewInventory)
+{
+	const FItemRegistry& Registry = FItemRegistry::Get();
+
+	// Resolved once here, everything after compares handles, or ids for the few items the registry does not know
+	TArray<FInventoryArrayEntry, TInlineAllocator<32>> NewStacks;
+	TMap<FItemHandle, int32> StackOfItem;
+	TMap<FString, int32> StackOfUnregistered;
+
+	for (const FInventoryJson& Item : NewInventory)
+	{
+		const FItemHandle Handle = Registry.FindHandle(Item.ItemId);
+		const FString UnregisteredId = Handle.IsValid() ? FString() : Item.ItemId;
+
+		if (const int32* Existing = Handle.IsValid() ? StackOfItem.Find(Handle) : StackOfUnregistered.Find(UnregisteredId))
+		{
+			UE_LOG(LogTemp, Log, TEXT("Adding up duplicate stacks of %s"), *Item.ItemId);
+			NewStacks[*Existing].Count += Item.ItemCount;
+			continue;
+		}
+
+		if (Handle.IsValid())
+		{
+			StackOfItem.Add(Handle, NewStacks.Num());
+		}
+		else
+		{
+			UE_LOG(LogTemp, Verbose, TEXT("Item %s is not in the item registry, it is replicated by id"), *Item.ItemId);
+			StackOfUnregistered.Add(UnregisteredId, NewStacks.Num());
+		}
+
+		NewStacks.Emplace(Handle, UnregisteredId, Item.ItemCount);
+	}
+
+	TBitArray<> Matched(false, NewStacks.Num());
+
+	bool bRemoved = false;
+	for (int32 Index = Items.Num() - 1; Index >= 0; --Index)
+	{
+		FInventoryArrayEntry& Entry = Items[Index];
+
+		const int32* Stack = Entry.Item.IsValid() ? StackOfItem.Find(Entry.Item) : StackOfUnregistered.Find(Entry.UnregisteredId);
+		if (!Stack || Matched[*Stack])
+		{
+			Items.RemoveAtSwap(Index, 1, false);
+			bRemoved = true;
+			continue;
+		}
+
+		Matched[*Stack] = true;
+
+		const int32 NewCount = NewStacks[*Stack].Count;
+		if (Entry.Count != NewCount)
+		{
+			Entry.Count = NewCount;
+			MarkItemDirty(Entry);
+		}
+	}
+
+	// Whatever is left did not have a stack yet, added in the order the backend listed them
+	for (int32 Stack = 0; Stack < NewStacks.Num(); ++Stack)
+	{
+		if (!Matched[Stack])
+		{
+			MarkItemDirty(Items.Add_GetRef(NewStacks[Stack]));
+		}
+	}
+
+	if (bRemoved)
+	{
+		MarkArrayDirty();
+	}
+}
+
+TArray<FInventoryJson> FInventoryArray::ToArray() const
+{
+	TArray<FInventoryJson> Out;
+	Out.Reserve(Items.Num());
+	for (const FInventoryArrayEntry& Entry : Items)
+	{
+		FInventoryJson& Item = Out.AddDefaulted_GetRef();
+		Item.ItemId = Entry.GetItemId();
+		Item.ItemCount = Entry.Count;
+	}
+
+	return Out;
+}
+
+int32 FInventoryArray::GetCount(const FItemHandle Item) const
+{
+	const FInventoryArrayEntry* Entry = Items.FindByPredicate([Item](const FInventoryArrayEntry& Stack) { return Stack.Item == Item; });
+	return Entry ? Entry->Count : 0;
+}
@@ -0,0 +1,73 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#include "Types/ItemRegistry.h"
+
+const FItemRegistry& FItemRegistry::Get()
+{
+	static const FItemRegistry Registry;
+	return Registry;
+}
+
+FItemRegistry::FItemRegistry()
+{
+	TArray<FString> ConfigItems;
+
+	FConfigFile GameConfig;
+	if (FConfigCacheIni::LoadLocalIniFile(GameConfig, TEXT("DefaultGame"), false))
+	{
+		GameConfig.GetArray(TEXT("ItemRegistry"), TEXT("Items"), ConfigItems);
+	}
+
+	for (const FString& ItemId : ConfigItems)
+	{
+		if (HandleOfId.Contains(ItemId))
+		{
+			continue;
+		}
+
+		if (ItemIds.Num() >= MAX_uint16)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Item registry is full, ignoring %s and every item after it"), *ItemId);
+			break;
+		}
+
+		ItemIds.Add(ItemId);
+		HandleOfId.Add(ItemId, FItemHandle(static_cast<uint16>(ItemIds.Num())));
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Item registry loaded %d items"), ItemIds.Num());
+}
+
+FItemHandle FItemRegistry::FindHandle(const FString& ItemId) const
+{
+	const FItemHandle* Handle = HandleOfId.Find(ItemId);
+	return Handle ? *Handle : FItemHandle();
+}
+
+const FString& FItemRegistry::GetItemId(const FItemHandle Handle) const
+{
+	static const FString Invalid;
+	return ItemIds.IsValidIndex(Handle.Index - 1) ? ItemIds[Handle.Index - 1] : Invalid;
+}
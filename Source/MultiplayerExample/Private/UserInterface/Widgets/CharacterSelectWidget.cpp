@@ -24,6 +24,7 @@
 
 #include "UserInterface/Widgets/CharacterSelectWidget.h"
 #include "Core/MGameInstance.h"
+#include "Core/ServerDirectory.h"
 
 void UCharacterSelectWidget::PlaySelectedCharacter(const FString& CharacterID, const bool bForceLocal)
 {
@@ -31,26 +32,39 @@ void UCharacterSelectWidget::PlaySelectedCharacter(const FString& CharacterID, c
 	{
 		GI->RequestedCharacter = CharacterID;
 
+		// Starts loading the game map while the server is picked. STATE_Playing is only entered by TravelToServer
+		// once an address is known, so a failed pick leaves the player in character select.
+		GI->PrepareToPlay();
+
 		if (bForceLocal)
 		{
-			GetOwningPlayer()->ClientTravel(TEXT("127.0.0.1"), ETravelType::TRAVEL_Absolute, false);
+			GI->TravelToServer(TEXT("127.0.0.1"));
 			return;
 		}
-		
-		FConfigFile GameConfig;
-		if (FConfigCacheIni::LoadLocalIniFile(GameConfig, TEXT("DefaultGame"), false))
+
+		UServerDirectory* ServerDirectory = GI->GetSubsystem<UServerDirectory>();
+		if (ServerDirectory && ServerDirectory->HasServers())
 		{
-			FString TravelURL = "127.0.0.1";
-			if (!GameConfig.GetString(TEXT("ServerAddress"), TEXT("Address"), TravelURL))
-			{
-				UE_LOG(LogTemp, Error, TEXT("Failed to get the server address"));
-				return;
-			}
-
-			GetOwningPlayer()->ClientTravel(TravelURL, ETravelType::TRAVEL_Absolute, false);
+			ServerDirectory->SelectBestServer(FOnServerSelected::CreateUObject(this, &ThisClass::OnServerSelected));
 			return;
 		}
+
+		UE_LOG(LogTemp, Error, TEXT("Failed to get the server address"));
+		return;
 	}
 
 	UE_LOG(LogTemp, Error, TEXT("Failed to travel to the server"));
 }
+
+void UCharacterSelectWidget::OnServerSelected(const FServerProbeResult& Server)
+{
+	UMGameInstance* GI = GetGameInstance<UMGameInstance>();
+	if (!GI || Server.Address.IsEmpty())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to travel to the server"));
+		return;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Travelling to %s (%.1fms, %d/%d players)"), *Server.Address, Server.RoundTripMs, Server.Players, Server.MaxPlayers);
+	GI->TravelToServer(Server.Address);
+}
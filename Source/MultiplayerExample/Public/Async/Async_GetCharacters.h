@@ -57,6 +57,8 @@ public:
 
 protected:
 
+	void OnCharacterListFetched(bool bSuccessful);
+
 	UFUNCTION()
 	void OnComplete(const EResponseType& ResponseType) const;
 
@@ -25,12 +25,14 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Interfaces/IHttpRequest.h"
 #include "Kismet/BlueprintAsyncActionBase.h"
 #include "Types/ApiTypes.h"
 
 #include "Async_UpdateInventory.generated.h"
 
 class AMPlayerController;
+class UMGameInstance;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnUpdateInventoryComplete, const TArray<FInventoryJson>&, Inv);
 
@@ -54,6 +56,9 @@ protected:
 	UFUNCTION()
 	void OnComplete(const TArray<FInventoryJson> NewInventory);
 
+	void OnJournaled();
+	void OnUpdateResponse(UMGameInstance* GI, FHttpResponsePtr Response);
+
 private:
 
 	UPROPERTY()
@@ -0,0 +1,233 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
+#include "Types/GlobalTypes.h"
+
+#include "AdmissionPipeline.generated.h"
+
+class AController;
+
+UENUM(BlueprintType)
+enum class EAdmissionStage : uint8
+{
+	/*
+	 *	Waiting for a free backend fetch slot
+	 **/
+	Queued,
+
+	/*
+	 *	Character data is being fetched from the backend
+	 **/
+	Fetching,
+
+	/*
+	 *	Has valid character data and is waiting to be spawned
+	 **/
+	Spawning,
+};
+
+USTRUCT(BlueprintType)
+struct FAdmissionStageStats
+{
+	GENERATED_BODY()
+
+	/*
+	 *	Players currently in the stage
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	int32 Current = 0;
+
+	/*
+	 *	Players that left the stage, successfully or not
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	int32 Completed = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	float AverageSeconds = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float MaxSeconds = 0.f;
+
+	void Record(const float Seconds)
+	{
+		AverageSeconds += (Seconds - AverageSeconds) / ++Completed;
+		MaxSeconds = FMath::Max(MaxSeconds, Seconds);
+	}
+};
+
+USTRUCT(BlueprintType)
+struct FAdmissionStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	FAdmissionStageStats Queued;
+
+	UPROPERTY(BlueprintReadOnly)
+	FAdmissionStageStats Fetching;
+
+	UPROPERTY(BlueprintReadOnly)
+	FAdmissionStageStats Spawning;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Admitted = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Failed = 0;
+
+	/*
+	 *	Time spent spawning players in the last tick that had any spawns, in milliseconds
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	float SpawnFrameMs = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float MaxSpawnFrameMs = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 SpawnsLastFrame = 0;
+
+	/*
+	 *	Ticks where spawning ran past SpawnBudgetMs, only possible when a single spawn exceeds the budget
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	int32 OverBudgetFrames = 0;
+
+	/*
+	 *	Ticks where players were kept waiting because every spawn point was reserved
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	int32 SaturatedFrames = 0;
+};
+
+/*
+ *	Flow control for players joining the server.
+ *	Joining players wait in a FIFO queue until a backend fetch slot is free, at most MaxConcurrentFetches character
+ *	fetches are in flight. Players with character data are spawned in time slices of SpawnBudgetMs per server tick,
+ *	longest waiting player first, so a burst of backend responses is spread over several ticks instead of one hitch.
+ *	While CanSpawn reports no free spawn point players stay queued, up to MaxSpawnWait seconds. A waiting player does
+ *	not hold up the rest of the slice, players that have waited longer than that are still spawned behind them.
+ *	Owned and ticked by AMultiplayerExampleGameMode.
+ **/
+class MULTIPLAYEREXAMPLE_API FAdmissionPipeline
+{
+public:
+
+	DECLARE_DELEGATE_ThreeParams(FOnStartFetch, AController*, const FString& /* CharacterID */, const FString& /* BearerToken */);
+	DECLARE_DELEGATE_TwoParams(FOnSpawn, AController*, FCharacterData);
+	DECLARE_DELEGATE_OneParam(FOnFailed, AController*);
+	DECLARE_DELEGATE_RetVal(bool, FCanSpawn);
+
+	void Enqueue(AController* Controller, const FString& CharacterID, const FString& BearerToken);
+
+	/*
+	 *	Skips the backend fetch for players whose character data is already known, e.g. from the character cache
+	 **/
+	void EnqueueForSpawn(AController* Controller, const FCharacterData& Character);
+	void OnFetchComplete(AController* Controller, const FCharacterData& Character);
+	void OnFetchFailed(AController* Controller);
+
+	/*
+	 *	Drops the player from whatever stage they are in, used when they log out mid admission
+	 **/
+	void Remove(AController* Controller);
+
+	void Tick();
+
+	bool Contains(AController* Controller) const { return Tickets.Contains(Controller); }
+	const FAdmissionStats& GetStats() const { return Stats; }
+	void DumpStats() const;
+
+	int32 MaxConcurrentFetches = 16;
+	/*
+	 *	Milliseconds per tick spent spawning, at least one player is spawned each tick regardless
+	 **/
+	float SpawnBudgetMs = 2.f;
+	float FetchTimeout = 15.f;
+
+	/*
+	 *	Seconds a player waits for a free spawn point before being spawned anyway
+	 **/
+	float MaxSpawnWait = 10.f;
+
+	FOnStartFetch StartFetch;
+	FOnSpawn Spawn;
+	FOnFailed Failed;
+	FCanSpawn CanSpawn;
+
+private:
+
+	struct FTicket
+	{
+		TWeakObjectPtr<AController> Controller;
+		FString CharacterID;
+		FString BearerToken;
+		FCharacterData Character;
+		EAdmissionStage Stage = EAdmissionStage::Queued;
+		double StageStartTime = 0.0;
+		double AdmissionStartTime = 0.0;
+	};
+
+	/*
+	 *	Spawn queue heap entry, ordered by when the player started admission
+	 **/
+	struct FSpawnEntry
+	{
+		TObjectKey<AController> Key;
+		double AdmissionStartTime;
+
+		bool operator<(const FSpawnEntry& Other) const { return AdmissionStartTime < Other.AdmissionStartTime; }
+	};
+
+	FTicket& AddTicket(AController* Controller);
+	void PushSpawn(TObjectKey<AController> Key, const FTicket& Ticket);
+
+	bool RemoveTicket(TObjectKey<AController> Key);
+
+	void StartFetches();
+	void SpawnReady();
+	void ExpireFetches();
+
+	void EnterStage(FTicket& Ticket, EAdmissionStage Stage);
+	void LeaveStage(FTicket& Ticket);
+	FAdmissionStageStats& GetStageStats(EAdmissionStage Stage);
+
+	TMap<TObjectKey<AController>, FTicket> Tickets;
+
+	TArray<TObjectKey<AController>> WaitingQueue;
+
+	/*
+	 *	Min heap on admission start time. Removed tickets are left in place and skipped when popped
+	 **/
+	TArray<FSpawnEntry> SpawnQueue;
+
+	int32 FetchesInFlight = 0;
+
+	FAdmissionStats Stats;
+};
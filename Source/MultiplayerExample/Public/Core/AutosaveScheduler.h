@@ -0,0 +1,113 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "AutosaveScheduler.generated.h"
+
+class AMPlayerState;
+
+USTRUCT(BlueprintType)
+struct FAutosaveStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	float Interval = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumSlots = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Players = 0;
+
+	/*
+	 *	Most and fewest players sharing a slot, a wide gap means saves are not evenly spread
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	int32 MaxSlotOccupancy = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 MinSlotOccupancy = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 SavesIssued = 0;
+
+	/*
+	 *	Player states the backend confirmed every change of, by autosave or any other flush
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	int32 SavesConfirmed = 0;
+
+	/*
+	 *	Seconds between a player state becoming dirty and the backend confirming its last unsaved change
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	float AverageSaveLag = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float MaxSaveLag = 0.f;
+};
+
+/*
+ *	Spreads periodic saves of player states evenly over Interval.
+ *	The interval is split into NumSlots time slots and every character is hashed by ID into one of them, each tick the
+ *	slots that started since the last tick have their dirty player states saved through AMPlayerState::SyncPlayerState.
+ *	Owned and ticked by AMultiplayerExampleGameMode.
+ **/
+class MULTIPLAYEREXAMPLE_API FAutosaveScheduler
+{
+public:
+
+	void Initialize(float InInterval, int32 InNumSlots);
+
+	void Register(AMPlayerState* PlayerState);
+	void Unregister(AMPlayerState* PlayerState);
+
+	void Tick(double Now);
+
+	/*
+	 *	Called once the backend confirmed everything a player state had unsaved, see UCharacterPersistence::OnCharacterSaved
+	 **/
+	void RecordSaveConfirmed(float SaveLag);
+
+	const FAutosaveStats& GetStats() const { return Stats; }
+	void DumpStats() const;
+
+private:
+
+	int32 GetSlot(const AMPlayerState* PlayerState) const;
+	void SaveSlot(int32 Slot);
+	void UpdateOccupancy();
+
+	TArray<TArray<TWeakObjectPtr<AMPlayerState>>> Slots;
+	TMap<TWeakObjectPtr<AMPlayerState>, int32> SlotOfPlayer;
+
+	double SlotDuration = 0.0;
+	int64 LastSlotIndex = INDEX_NONE;
+
+	FAutosaveStats Stats;
+};
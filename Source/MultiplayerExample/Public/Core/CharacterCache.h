@@ -0,0 +1,137 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/LruCache.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Types/GlobalTypes.h"
+
+#include "CharacterCache.generated.h"
+
+DECLARE_STATS_GROUP(TEXT("CharacterCache"), STATGROUP_CharacterCache, STATCAT_Advanced);
+
+USTRUCT(BlueprintType)
+struct FCharacterCacheStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Entries = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 MaxEntries = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Hits = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Misses = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Evictions = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Invalidations = 0;
+
+	/*
+	 *	Entries dropped on lookup because their token or TTL ran out
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	int32 Expirations = 0;
+
+	/*
+	 *	Approximate heap memory held by the cached characters
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	int64 MemoryBytes = 0;
+
+	float GetHitRate() const { return Hits + Misses > 0 ? static_cast<float>(Hits) / (Hits + Misses) : 0.f; }
+};
+
+/*
+ *	Server side cache of character data keyed by character ID, so players reconnecting to the same server skip the backend.
+ *	Entries are filled by successful getCharacter responses, updated when an inventory save succeeds and dropped when
+ *	the backend reports an error for the character. The least recently used entry is evicted once MaxEntries is reached.
+ *
+ *	A cached character is only handed out for the exact bearer token the backend accepted when it was fetched,
+ *	any other token is a miss and goes through the backend to be validated. That validation is only trusted until the
+ *	token's own expiry or TTLSeconds after the fetch, whichever comes first, so an expired or revoked token is sent back
+ *	to the backend instead of being served from the cache.
+ **/
+UCLASS()
+class MULTIPLAYEREXAMPLE_API UCharacterCache : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	const FCharacterData* Find(const FString& CharacterID, const FString& BearerToken);
+
+	void Store(const FCharacterData& Character, const FString& BearerToken);
+	void UpdateInventory(const FString& CharacterID, const TArray<FInventoryJson>& Inventory);
+	void Invalidate(const FString& CharacterID);
+
+	UFUNCTION(BlueprintPure, Category = "Character Cache")
+	const FCharacterCacheStats& GetStats() const { return Stats; }
+
+	void DumpStats() const;
+
+	static constexpr int32 DefaultMaxEntries = 1024;
+	static constexpr float DefaultTTLSeconds = 300.f;
+
+	/*
+	 *	Reads the exp claim of a JWT bearer token, the "Bearer " prefix is optional. Returns false for opaque tokens.
+	 **/
+	static bool GetTokenExpiry(const FString& BearerToken, FDateTime& OutExpiryUtc);
+
+private:
+
+	struct FEntry
+	{
+		FCharacterData Character;
+		FString BearerToken;
+		int64 MemoryBytes = 0;
+
+		/*
+		 *	FPlatformTime::Seconds after which the token validation is no longer trusted
+		 **/
+		double ExpiresAt = 0.0;
+	};
+
+	static int64 GetMemoryBytes(const FEntry& Entry);
+	void Evict(const FString& CharacterID);
+	void UpdateStats();
+
+	TLruCache<FString, FEntry> Entries;
+
+	float TTLSeconds = DefaultTTLSeconds;
+
+	UPROPERTY(Transient)
+	FCharacterCacheStats Stats;
+};
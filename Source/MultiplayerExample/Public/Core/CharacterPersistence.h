@@ -0,0 +1,160 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/IHttpRequest.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Types/GlobalTypes.h"
+
+#include "CharacterPersistence.generated.h"
+
+class AMPlayerState;
+class URequest;
+
+USTRUCT(BlueprintType)
+struct FPersistenceFlushResult
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Succeeded = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Failed = 0;
+
+	/*
+	 *	Requests without a response after RequestTimeout, they are cancelled and their changes stay unsaved
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	int32 TimedOut = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	float Seconds = 0.f;
+};
+
+DECLARE_DELEGATE_OneParam(FOnPersistenceFlushed, const FPersistenceFlushResult&);
+
+/*
+ *	A player state has no unsaved changes left, with the real time seconds since it became dirty
+ **/
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnCharacterSaved, AMPlayerState*, float /* SaveLag */);
+
+/*
+ *	Writes the inventory changes of dirty player states back to the backend.
+ *	Every unsaved change is sent as its own updateInventory request with the owning player's token, the same route the
+ *	inventory journal replays through, with up to MaxInFlight requests of a flush in flight at once. A request without
+ *	a response after RequestTimeout is cancelled and its change stays unsaved for the next flush.
+ *	The game mode flushes blocking before server travel and when it ends play, so a recycled server does not drop
+ *	progress, and saves single players on logout.
+ **/
+UCLASS()
+class MULTIPLAYEREXAMPLE_API UCharacterPersistence : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/*
+	 *	Sends the unsaved changes of every dirty player state and calls OnComplete once all of them were answered or
+	 *	timed out. Player states that still have a save in flight are left to that save.
+	 **/
+	void Flush(const TArray<AMPlayerState*>& PlayerStates, FOnPersistenceFlushed OnComplete = FOnPersistenceFlushed());
+
+	/*
+	 *	Same as Flush but pumps the http manager on the calling thread until no save of any flush is in flight, for
+	 *	shutdown and travel where the engine will not tick again before the world goes away.
+	 *	Returns as soon as the last request is answered, at worst after one RequestTimeout per MaxInFlight requests.
+	 **/
+	FPersistenceFlushResult FlushBlocking(const TArray<AMPlayerState*>& PlayerStates);
+
+	/*
+	 *	Collects the player states of the worlds game state
+	 **/
+	static TArray<AMPlayerState*> GetPlayerStates(const UWorld* World);
+
+	UFUNCTION(BlueprintPure, Category = "Persistence")
+	const FPersistenceFlushResult& GetLastFlushResult() const { return LastFlushResult; }
+
+	void DumpStats() const;
+
+	FOnCharacterSaved OnCharacterSaved;
+
+	static constexpr int32 DefaultMaxInFlight = 16;
+	static constexpr float DefaultRequestTimeout = 5.f;
+
+private:
+
+	struct FSave
+	{
+		TWeakObjectPtr<AMPlayerState> PlayerState;
+		FString CharacterID;
+		FString BearerToken;
+		FInventoryJson Item;
+		URequest* Request = nullptr;
+		double SentTime = 0.0;
+		bool bDone = false;
+	};
+
+	struct FFlush
+	{
+		TArray<FSave> Saves;
+		int32 NextToSend = 0;
+		int32 InFlight = 0;
+		int32 Pending = 0;
+		double StartTime = 0.0;
+		FPersistenceFlushResult Result;
+		FOnPersistenceFlushed OnComplete;
+	};
+
+	bool Tick(float DeltaTime);
+
+	TSharedRef<FFlush> StartFlush(const TArray<AMPlayerState*>& PlayerStates, FOnPersistenceFlushed OnComplete);
+	void SendQueued(const TSharedRef<FFlush>& Flush);
+	void SendSave(const TSharedRef<FFlush>& Flush, int32 SaveIndex);
+	void OnSaveComplete(const TSharedRef<FFlush>& Flush, int32 SaveIndex, FHttpResponsePtr Response, bool bSuccessful);
+	void ExpireSaves(const TSharedRef<FFlush>& Flush, double Now);
+	void FinishSave(const TSharedRef<FFlush>& Flush, FSave& Save);
+	void FinishFlush(const TSharedRef<FFlush>& Flush);
+
+	bool HasSavesInFlight() const { return Flushes.Num() > 0; }
+
+	int32 MaxInFlight = DefaultMaxInFlight;
+	float RequestTimeout = DefaultRequestTimeout;
+
+	/*
+	 *	Flushes with requests still queued or in flight, and the player states they are saving
+	 **/
+	TArray<TSharedRef<FFlush>> Flushes;
+	TMap<TWeakObjectPtr<AMPlayerState>, int32> SavingPlayers;
+
+	FDelegateHandle TickHandle;
+
+	FPersistenceFlushResult LastFlushResult;
+};
@@ -0,0 +1,87 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "CharacterSignificance.generated.h"
+
+class AMultiplayerExampleCharacter;
+
+USTRUCT(BlueprintType)
+struct FCharacterSignificanceStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Characters = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Viewpoints = 0;
+
+	/*
+	 *	Characters at each movement LOD after the last update, index 0 is full rate
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	TArray<int32> CharactersPerLOD;
+
+	UPROPERTY(BlueprintReadOnly)
+	float UpdateMs = 0.f;
+};
+
+/*
+ *	Scores every character on a dedicated server by the distance to the nearest other player and picks its movement LOD
+ *	from AMultiplayerExampleCharacter::MovementLODs, far away characters tick their movement and mesh less often.
+ *	Characters register themselves through the world's significance manager, the viewpoints are the player pawns.
+ *	Updated by AMultiplayerExampleGameMode.
+ **/
+class MULTIPLAYEREXAMPLE_API FCharacterSignificance
+{
+public:
+
+	static const FName Tag;
+
+	static void Register(AMultiplayerExampleCharacter* Character);
+	static void Unregister(AMultiplayerExampleCharacter* Character);
+
+	void Initialize(UWorld* InWorld);
+	void Tick();
+
+	const FCharacterSignificanceStats& GetStats() const { return Stats; }
+	void DumpStats() const;
+
+	/*
+	 *	Seconds between significance updates, LODs only change this often
+	 **/
+	float UpdateInterval = 0.25f;
+
+private:
+
+	TWeakObjectPtr<UWorld> World;
+	TArray<FTransform> Viewpoints;
+	double LastUpdateTime = 0.0;
+
+	FCharacterSignificanceStats Stats;
+};
@@ -0,0 +1,116 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "ClockSync.generated.h"
+
+USTRUCT(BlueprintType)
+struct FClockSyncStats
+{
+	GENERATED_BODY()
+
+	/*
+	 *	Seconds added to the local real time clock to get the server real time clock
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	float OffsetMs = 0.f;
+
+	/*
+	 *	Spread of the offsets measured in the window, how noisy single samples are
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	float JitterMs = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float MinRoundTripMs = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float LastRoundTripMs = 0.f;
+
+	/*
+	 *	Half the round trip of the sample the offset comes from, the true offset is within this of the estimate
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	float ErrorBoundMs = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Samples = 0;
+
+	/*
+	 *	Times the offset jumped instead of slewing, the first sample and anything past SnapThreshold
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	int32 Snaps = 0;
+};
+
+/*
+ *	NTP style estimate of the server clock from ping and pong timestamps.
+ *	Each sample assumes the server stamped its reply halfway through the round trip. Samples with the shortest round trip
+ *	had the least queuing delay and so the least asymmetry, the offset follows the minimum round trip sample of the last
+ *	WindowSize samples and slews towards it rather than jumping on every change.
+ **/
+class MULTIPLAYEREXAMPLE_API FClockSyncEstimator
+{
+public:
+
+	int32 WindowSize = 16;
+	float SnapThreshold = 0.25f;
+
+	/*
+	 *	Fraction of the distance to the new target covered per sample
+	 **/
+	float SlewRate = 0.5f;
+
+	void Reset();
+
+	/*
+	 *	All times in seconds, SendTime and ReceiveTime on the local clock, ServerTime on the server clock
+	 **/
+	void AddSample(double SendTime, double ServerTime, double ReceiveTime);
+
+	bool HasEstimate() const { return bHasEstimate; }
+	double GetOffset() const { return Offset; }
+
+	const FClockSyncStats& GetStats() const { return Stats; }
+	void DumpStats() const;
+
+private:
+
+	struct FSample
+	{
+		double RoundTrip = 0.0;
+		double Offset = 0.0;
+	};
+
+	TArray<FSample> Samples;
+	int32 NextSample = 0;
+
+	bool bHasEstimate = false;
+	double Offset = 0.0;
+
+	FClockSyncStats Stats;
+};
@@ -153,6 +153,11 @@ public:
 	URequest* CreateNewRequest(const FString& Subroute, bool bExplicitURL = false);
 	URequest* CreateLoginRequest();
 
+	/*
+	 *	Opens a keep-alive connection to the API host ahead of time so the first real request skips the TCP/TLS handshake
+	 **/
+	void WarmupConnection();
+
 	void SetHeaders(URequest* InRequest) const;
 	static void SetHeaders(URequest* InRequest, EContentType ContentType);
 
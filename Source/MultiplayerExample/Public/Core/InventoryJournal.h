@@ -0,0 +1,200 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "Interfaces/IHttpRequest.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Types/ApiTypes.h"
+
+#include "InventoryJournal.generated.h"
+
+class IFileHandle;
+
+USTRUCT(BlueprintType)
+struct FInventoryJournalStats
+{
+	GENERATED_BODY()
+
+	/*
+	 *	Mutations waiting for the next disk flush
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	int32 Buffered = 0;
+
+	/*
+	 *	Mutations on disk the backend has not confirmed yet
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	int32 Pending = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Appended = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Confirmed = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 ReplayFailures = 0;
+
+	/*
+	 *	Mutations the backend refused, moved to the dead letter file next to the journal
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	int32 DeadLettered = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Compactions = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Flushes = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	float AverageFlushMs = 0.f;
+};
+
+/*
+ *	Append only journal of inventory mutations on dedicated and listen servers, stored in Saved/Journal per listen port.
+ *	Mutations are buffered and written with a single sync per tick, the caller is told once its mutation is on disk and
+ *	can acknowledge it to the player without waiting for the backend.
+ *	Durable mutations are replayed through updateInventory, up to MaxReplayInFlight at a time, confirmed ones are
+ *	compacted out of the file. Whatever is left in the file when the server starts is replayed, so neither a crash
+ *	nor a backend outage loses items.
+ *	Transport errors and 5xx responses are retried with backoff. A mutation the backend rejects is moved to a dead
+ *	letter file and handed to its player state for the next persistence flush, so one bad entry can't block the journal.
+ **/
+UCLASS()
+class MULTIPLAYEREXAMPLE_API UInventoryJournal : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/*
+	 *	Opens the journal for the server listening on World's port and replays what a previous run left behind.
+	 *	Called by the game mode, does nothing on clients and standalone games.
+	 **/
+	void Start(UWorld* World);
+
+	/*
+	 *	False until Start, or when the journal file could not be opened
+	 **/
+	bool IsOpen() const { return File.IsValid(); }
+
+	/*
+	 *	False when callers should talk to the backend directly, either because the journal is not open or because the
+	 *	backend has been rejecting every replayed mutation
+	 **/
+	bool IsAccepting() const;
+
+	/*
+	 *	Records the mutation, OnDurable is called once it has been synced to disk
+	 **/
+	int64 Append(const FString& CharacterID, const FString& BearerToken, const FInventoryJson& Item, FSimpleDelegate OnDurable);
+
+	UFUNCTION(BlueprintPure, Category = "Inventory Journal")
+	const FInventoryJournalStats& GetStats() const { return Stats; }
+
+	void DumpStats() const;
+
+private:
+
+	// Drives loading, replay responses and compaction without a world or a backend
+	friend class FInventoryJournalReplayTest;
+
+	bool Tick(float DeltaTime);
+
+	enum class EReplayResult : uint8
+	{
+		Confirmed,
+		Retry,
+		Rejected,
+	};
+
+	bool OpenFile();
+	void Load();
+	void FlushToDisk();
+	void ReplayPending();
+	void SendMutation(const FInventoryMutation& Mutation);
+	void OnReplayResponse(int64 Sequence, EReplayResult Result, int32 ResponseCode);
+	void FinishReplayRound();
+	void DeadLetter(const FInventoryMutation& Mutation, int32 ResponseCode);
+	void Compact();
+
+	static EReplayResult ClassifyResponse(FHttpResponsePtr Response, bool bSuccessful);
+
+	const FString& GetJournalPath() const { return JournalPath; }
+	FString GetHeaderLine() const;
+	static FString ToLine(const FInventoryMutation& Mutation);
+
+	TUniquePtr<IFileHandle> File;
+	FDelegateHandle TickHandle;
+
+	FString JournalPath;
+	bool bStarted = false;
+
+	FString JournalID;
+	int64 NextSequence = 1;
+
+	/*
+	 *	Appended since the last flush, WriteBuffer holds their serialized lines
+	 **/
+	TArray<FInventoryMutation> Buffered;
+	TArray<FSimpleDelegate> BufferedCallbacks;
+	FString WriteBuffer;
+
+	/*
+	 *	On disk and unconfirmed in sequence order. A replay round sends the first ReplayInFlight of them and the next
+	 *	round starts once every response of the round is in.
+	 **/
+	TArray<FInventoryMutation> Pending;
+	int32 ReplayInFlight = 0;
+	bool bRoundHadRetries = false;
+	bool bSendingRound = false;
+	int32 RemovedSinceCompact = 0;
+
+	double NextReplayTime = 0.0;
+	float ReplayBackoff = 0.f;
+
+	/*
+	 *	Rejections in a row, once MaxConsecutiveRejections is reached new mutations bypass the journal until RejectingUntil
+	 **/
+	int32 ConsecutiveRejections = 0;
+	double RejectingUntil = 0.0;
+
+	int32 MaxReplayInFlight = 16;
+	float ReplayInterval = 1.f;
+	float MaxReplayBackoff = 30.f;
+	int32 CompactThreshold = 256;
+	int32 MaxConsecutiveRejections = 8;
+
+	UPROPERTY(Transient)
+	FInventoryJournalStats Stats;
+};
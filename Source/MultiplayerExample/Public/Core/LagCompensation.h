@@ -0,0 +1,216 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+
+#include "LagCompensation.generated.h"
+
+class AMultiplayerExampleCharacter;
+
+struct FLagCompensationRay
+{
+	FVector Start = FVector::ZeroVector;
+	FVector End = FVector::ZeroVector;
+
+	/*
+	 *	Slot never hit by this ray, usually the shooter
+	 **/
+	int32 IgnoreSlot = INDEX_NONE;
+};
+
+struct FLagCompensationHit
+{
+	int32 Slot = INDEX_NONE;
+	FVector Location = FVector::ZeroVector;
+	float Distance = 0.f;
+
+	bool IsHit() const { return Slot != INDEX_NONE; }
+};
+
+/*
+ *	Fixed size ring buffer of character capsules, one frame per server tick.
+ *	Every field is its own array indexed by Frame * MaxSlots + Slot, so rewinding all characters to a time reads each
+ *	field of two adjacent frames front to back. Nothing is allocated after Initialize.
+ **/
+class MULTIPLAYEREXAMPLE_API FLagCompensationBuffer
+{
+public:
+
+	void Initialize(int32 InMaxSlots, int32 InMaxFrames);
+
+	/*
+	 *	A released slot is only handed out again once its last frame has been overwritten
+	 **/
+	int32 AcquireSlot();
+	void ReleaseSlot(int32 Slot);
+
+	void BeginFrame(double Time);
+	void Write(int32 Slot, const FVector& Location, float Radius, float HalfHeight);
+
+	/*
+	 *	Interpolates every slot recorded around Time into the rewind arrays and tests all rays against them, OutHits gets
+	 *	the nearest hit of each ray in order. False when Time is outside the recorded history.
+	 **/
+	bool RewindAndTest(double Time, TArrayView<const FLagCompensationRay> Rays, TArray<FLagCompensationHit>& OutHits);
+
+	/*
+	 *	Frees all memory, the next Initialize allocates it again
+	 **/
+	void Release();
+
+	int32 GetMaxSlots() const { return MaxSlots; }
+	int32 GetNumFrames() const { return NumFrames; }
+	double GetOldestTime() const;
+	double GetNewestTime() const;
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	int32 Rewind(double Time);
+
+	int32 MaxSlots = 0;
+	int32 MaxFrames = 0;
+	int32 NumFrames = 0;
+	int32 Head = INDEX_NONE;
+	int64 FrameCounter = 0;
+
+	TArray<double> FrameTimes;
+
+	TArray<float> X;
+	TArray<float> Y;
+	TArray<float> Z;
+	TArray<float> Radius;
+	TArray<float> HalfHeight;
+	TArray<uint8> Recorded;
+
+	TArray<int64> SlotReleasedFrame;
+	TBitArray<> SlotInUse;
+
+	TArray<int32> RewindSlots;
+	TArray<float> RewindX;
+	TArray<float> RewindY;
+	TArray<float> RewindZ;
+	TArray<float> RewindRadius;
+	TArray<float> RewindHalfHeight;
+};
+
+USTRUCT(BlueprintType)
+struct FLagCompensationStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Characters = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 MaxCharacters = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Frames = 0;
+
+	/*
+	 *	Seconds of history currently held
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	float HistorySeconds = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	int64 MemoryBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Queries = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Rays = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 QueriesOutsideHistory = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	float AverageQueryUs = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float MaxQueryUs = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float AverageRecordUs = 0.f;
+};
+
+/*
+ *	Records the capsule of every registered character at the end of each server frame, so hits reported by clients can be
+ *	checked against where characters were at the client's server time instead of trusting the client.
+ *	Characters register themselves on the server. History length and capacity are fixed by [LagCompensation] in DefaultGame.ini.
+ **/
+UCLASS()
+class MULTIPLAYEREXAMPLE_API ULagCompensation : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	void Register(AMultiplayerExampleCharacter* Character);
+	void Unregister(AMultiplayerExampleCharacter* Character);
+
+	/*
+	 *	Rewinds every character to the server world time Time and traces all rays against them at once.
+	 *	Hits against a character that has since left have no character.
+	 **/
+	bool RewindAndTest(float Time, const TArray<FLagCompensationRay>& Rays, TArray<FLagCompensationHit>& OutHits);
+
+	AMultiplayerExampleCharacter* GetCharacter(int32 Slot) const;
+	int32 GetSlot(const AMultiplayerExampleCharacter* Character) const;
+
+	UFUNCTION(BlueprintPure, Category = "Lag Compensation")
+	const FLagCompensationStats& GetStats() const { return Stats; }
+
+	void DumpStats() const;
+
+	static constexpr int32 DefaultMaxCharacters = 256;
+	static constexpr int32 DefaultMaxFrames = 64;
+
+private:
+
+	void OnWorldPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+	void OnServerIdleChanged(bool bIdle);
+
+	FLagCompensationBuffer Buffer;
+
+	TMap<TWeakObjectPtr<AMultiplayerExampleCharacter>, int32> SlotOfCharacter;
+	TArray<TWeakObjectPtr<AMultiplayerExampleCharacter>> CharacterInSlot;
+
+	FDelegateHandle PostActorTickHandle;
+	FDelegateHandle ServerIdleHandle;
+
+	UPROPERTY(Transient)
+	FLagCompensationStats Stats;
+
+	int32 RecordedFrames = 0;
+};
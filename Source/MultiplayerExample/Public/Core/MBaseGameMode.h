@@ -26,11 +26,19 @@
 
 #include "CoreMinimal.h"
 
+#include "Core/AdmissionPipeline.h"
+#include "Core/AutosaveScheduler.h"
+#include "Core/CharacterSignificance.h"
+#include "Core/NetFrequencyController.h"
+#include "Core/SpawnPointAllocator.h"
 #include "GameFramework/GameMode.h"
+#include "HttpRouteHandle.h"
 #include "Types/GlobalTypes.h"
 
 #include "MBaseGameMode.generated.h"
 
+class AMPlayerState;
+
 UCLASS(minimalapi)
 class AMultiplayerExampleGameMode : public AGameMode
 {
@@ -40,12 +48,131 @@ public:
 	
 	AMultiplayerExampleGameMode();
 
+	/*
+	 *	Puts a joining player in the admission queue, their character is fetched once a backend slot is free
+	 **/
+	void RequestAdmission(AController* Controller, const FString& CharacterID, const FString& BearerToken);
+	void NotifyCharacterFetchFailed(AController* Controller);
+
+	UFUNCTION(BlueprintPure, Category = "Admission")
+	const FAdmissionStats& GetAdmissionStats() const { return Admission.GetStats(); }
+
+	void DumpAdmissionStats() const { Admission.DumpStats(); }
+	void DumpSpawnStats() const { SpawnPoints.DumpStats(); }
+
+	UFUNCTION(BlueprintPure, Category = "Persistence")
+	const FAutosaveStats& GetAutosaveStats() const { return Autosave.GetStats(); }
+
+	void DumpAutosaveStats() const { Autosave.DumpStats(); }
+
+	UFUNCTION(BlueprintPure, Category = "Replication")
+	const FNetFrequencyStats& GetNetFrequencyStats() const { return NetFrequency.GetStats(); }
+
+	UFUNCTION(BlueprintPure, Category = "Replication")
+	const TArray<FNetFrequencyDecision>& GetNetFrequencyDecisions() const { return NetFrequency.GetDecisions(); }
+
+	void DumpNetFrequencyStats() const { NetFrequency.DumpStats(); }
+
+	UFUNCTION(BlueprintPure, Category = "Movement LOD")
+	const FCharacterSignificanceStats& GetSignificanceStats() const { return Significance.GetStats(); }
+
+	void DumpSignificanceStats() const { Significance.DumpStats(); }
+
 protected:
 
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaSeconds) override;
+
 	virtual void PostLogin(APlayerController* NewPlayer) override;
+	virtual void Logout(AController* Exiting) override;
+	virtual void ProcessServerTravel(const FString& URL, bool bAbsolute = false) override;
 	virtual void PerformInitialSpawn(AController* Controller, FCharacterData Character);
+	virtual APawn* SpawnDefaultPawnAtTransform_Implementation(AController* NewPlayer, const FTransform& SpawnTransform) override;
 	virtual void HandleMatchHasStarted() override;
-	
+
+	void OnReadyToSpawnPlayer(AController* Controller, FCharacterData Character);
+	void StartCharacterFetch(AController* Controller, const FString& CharacterID, const FString& BearerToken);
+	void OnAdmissionFailed(AController* Controller);
+	void OnServerIdleChanged(bool bIdle);
+	void OnCharacterSaved(AMPlayerState* PlayerState, float SaveLag);
+
+	/*
+	 *	Backend character fetches allowed in flight at once, everyone else waits in a FIFO queue
+	 **/
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Admission")
+	int32 MaxConcurrentFetches;
+
+	/*
+	 *	Milliseconds per server tick spent spawning admitted players, longest waiting first
+	 **/
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Admission")
+	float SpawnBudgetMs;
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Admission")
+	float FetchTimeout;
+
+	/*
+	 *	Player starts closer than this share a spawn cell, joins are spread over the cells before a cell is reused
+	 **/
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Spawning")
+	float SpawnCellSize;
+
+	/*
+	 *	Seconds a player start stays reserved for a join that has not stepped off it yet
+	 **/
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Spawning")
+	float SpawnReservationTimeout;
+
+	/*
+	 *	Seconds an admitted player waits for a free player start, after that they spawn with the engine's overlap adjustment
+	 **/
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Spawning")
+	float MaxSpawnWait;
+
+	/*
+	 *	Every dirty player state is saved once per AutosaveInterval seconds.
+	 *	Saves are spread over AutosaveSlots evenly spaced time slots, so backend writes stay flat instead of bursting.
+	 **/
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Persistence")
+	float AutosaveInterval;
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Persistence")
+	int32 AutosaveSlots;
+
+	/*
+	 *	How player character and player state update frequencies follow activity, observers and the per connection budget
+	 **/
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Replication")
+	FNetFrequencySettings NetFrequencySettings;
+
+	/*
+	 *	Seconds between character significance updates on dedicated servers, movement LODs change at most this often
+	 **/
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Movement LOD")
+	float SignificanceInterval;
+
+	/*
+	 *	Dedicated servers serve their player count on http://host:(port + StatusPortOffset)/status
+	 *	Clients probe this through UServerDirectory to pick a server
+	 **/
+	void StartStatusEndpoint();
+	void StopStatusEndpoint();
+
+private:
+
+	FAdmissionPipeline Admission;
+	FSpawnPointAllocator SpawnPoints;
+	FAutosaveScheduler Autosave;
+	FNetFrequencyController NetFrequency;
+	FCharacterSignificance Significance;
+
+	FDelegateHandle ServerIdleHandle;
+	FDelegateHandle CharacterSavedHandle;
+	FDelegateHandle ReadyToSpawnPlayerHandle;
+
+	FHttpRouteHandle StatusRouteHandle;
+	uint32 StatusPort = 0;
 };
 
 class FExampleGameModeEvents : public FGameModeEvents
@@ -0,0 +1,147 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/GameEngine.h"
+
+#include "MGameEngine.generated.h"
+
+USTRUCT(BlueprintType)
+struct FServerTickStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	bool bIdle = false;
+
+	UPROPERTY(BlueprintReadOnly)
+	float TickRate = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float IdleSeconds = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float ActiveSeconds = 0.f;
+
+	/*
+	 *	Average process CPU usage in percent while idle and while players were connected
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	float IdleCpuPercent = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float ActiveCpuPercent = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 IdleTransitions = 0;
+
+	/*
+	 *	Idle waits cut short by an incoming packet
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	int32 PacketWakeUps = 0;
+
+	/*
+	 *	Status requests answered while idle, each one runs the server at full rate for StatusWakeSeconds
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	int32 StatusWakeUps = 0;
+};
+
+/*
+ *	Tick governor for dedicated servers.
+ *	With players connected the server ticks at ServerTickRate. Once nobody has been connected for IdleDelay seconds it
+ *	drops to IdleServerTickRate, trims allocator caches and broadcasts OnServerIdleChanged so per player pools can be released.
+ *	While idle the wait between ticks is spent blocked on the game socket, so a connecting client's first packet is
+ *	processed right away instead of after up to a full idle tick.
+ *	The status endpoint's listener is not on that socket, so a status request can wait up to a full idle tick. Answering
+ *	one keeps the server at full rate for StatusWakeSeconds and the answer reports the wait, see GetStatusIdleWaitMs.
+ *	Enabled through GameEngine in DefaultEngine.ini, clients and the editor tick as before.
+ **/
+UCLASS(Config = Engine)
+class MULTIPLAYEREXAMPLE_API UMGameEngine : public UGameEngine
+{
+	GENERATED_BODY()
+
+public:
+
+	UMGameEngine();
+
+	virtual void Tick(float DeltaSeconds, bool bIdleMode) override;
+	virtual float GetMaxTickRate(float DeltaTime, bool bAllowFrameRateSmoothing = true) const override;
+	virtual void UpdateTimeAndHandleMaxTickRate() override;
+
+	bool IsServerIdle() const { return bServerIdle; }
+
+	/*
+	 *	Called by the status endpoint, keeps the server ticking at full rate for StatusWakeSeconds
+	 **/
+	void NotifyStatusRequest();
+
+	/*
+	 *	Longest a request answered this tick may have waited for the tick, zero unless the last wait was an idle one
+	 **/
+	float GetStatusIdleWaitMs() const;
+
+	const FServerTickStats& GetServerTickStats() const { return TickStats; }
+	void DumpServerTickStats() const;
+
+	DECLARE_EVENT_OneParam(UMGameEngine, FServerIdleChanged, bool /* bIdle */);
+	static FServerIdleChanged& OnServerIdleChanged() { return ServerIdleChangedEvent; }
+
+	UPROPERTY(Config)
+	float ServerTickRate;
+
+	UPROPERTY(Config)
+	float IdleServerTickRate;
+
+	UPROPERTY(Config)
+	float IdleDelay;
+
+	UPROPERTY(Config)
+	float StatusWakeSeconds;
+
+private:
+
+	int32 GetNumConnections() const;
+	void SetServerIdle(bool bIdle);
+	bool WaitForPacket(double Seconds) const;
+
+	/*
+	 *	Idle and not kept awake by a recent status request
+	 **/
+	bool IsIdleWaiting() const;
+
+	static FServerIdleChanged ServerIdleChangedEvent;
+
+	bool bServerIdle = false;
+	bool bWokenByPacket = false;
+	bool bLastWaitWasIdle = false;
+	double StatusAwakeUntil = 0.0;
+	double NoConnectionsSince = 0.0;
+
+	FServerTickStats TickStats;
+};
@@ -27,6 +27,7 @@
 #include "GameplayTagContainer.h"
 #include "Engine/GameInstance.h"
 #include "Types/ApiTypes.h"
+#include "Types/CharacterStore.h"
 #include "Types/GlobalTypes.h"
 
 #include "MGameInstance.generated.h"
@@ -78,6 +79,39 @@ enum class EMenuMap : uint8
 	CharacterSelect,
 };
 
+enum class ECharacterListFetch : uint8
+{
+	Idle,
+	InFlight,
+	Ready,
+	Failed,
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnCharacterListFetched, bool /* bSuccessful */);
+
+/*
+ *	How long the last state transition spent waiting on the map load and on the backend.
+ *	Both run in parallel, the transition commits once the slower of the two is ready.
+ *	For STATE_Playing both are measured from the play request, the backend time is the server lookup.
+ **/
+USTRUCT(BlueprintType)
+struct FStateTransitionTimings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	FName State;
+
+	UPROPERTY(BlueprintReadOnly)
+	float MapLoadSeconds = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float BackendSeconds = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float TotalSeconds = 0.f;
+};
+
 UCLASS()
 class UMGameInstance : public UGameInstance
 {
@@ -99,11 +133,40 @@ public:
 	FORCEINLINE void SetNewToken(const FLoginResponse NewToken) { LoginToken = NewToken; }
 	FORCEINLINE const FLoginResponse& GetToken() const { return LoginToken; }
 
-	void UpdateCharacterList(const FCharacterData& NewCharacter);
-	FORCEINLINE void UpdateCharacterList(const TArray<FCharacterData>& NewList) { CharacterList = NewList; }
-	
+	FCharacterHandle UpdateCharacterList(const FCharacterData& NewCharacter);
+	FORCEINLINE void UpdateCharacterList(const TArray<FCharacterData>& NewList) { Characters.Assign(NewList); }
+	FORCEINLINE bool RemoveCharacter(const FString& CharacterID) { return Characters.Remove(CharacterID); }
+
 	UFUNCTION(BlueprintPure, Category = "Character")
-	FORCEINLINE TArray<FCharacterData> GetCharacterList() const { return CharacterList; }
+	FORCEINLINE const TArray<FCharacterData>& GetCharacterList() const { return Characters.GetAll(); }
+
+	FORCEINLINE TArrayView<const FCharacterData> GetCharacterView() const { return Characters.View(); }
+	FORCEINLINE const FCharacterData* FindCharacter(const FString& CharacterID) const { return Characters.Find(CharacterID); }
+	FORCEINLINE const FCharacterData* FindCharacter(const FCharacterHandle Handle) const { return Characters.Find(Handle); }
+	FORCEINLINE FCharacterHandle FindCharacterHandle(const FString& CharacterID) const { return Characters.FindHandle(CharacterID); }
+
+	UFUNCTION(BlueprintPure, Category = "Character", meta = (DisplayName = "FindCharacter"))
+	bool K2_FindCharacter(const FString& CharacterID, FCharacterData& OutCharacter) const;
+
+	FORCEINLINE FOnCharacterAdded& OnCharacterAdded() { return Characters.OnCharacterAdded; }
+	FORCEINLINE FOnCharacterUpdated& OnCharacterUpdated() { return Characters.OnCharacterUpdated; }
+	FORCEINLINE FOnCharacterRemoved& OnCharacterRemoved() { return Characters.OnCharacterRemoved; }
+
+	/*
+	 *	Requests the character list from the backend. Started as soon as the login succeeds so the list is usually
+	 *	ready by the time the character select map has loaded. Does nothing if a fetch is already in flight.
+	 *	Without a valid login the fetch fails straight away, OnCharacterListFetched is broadcast either way.
+	 **/
+	void FetchCharacterList();
+
+	/*
+	 *	Hands out a prefetched result once, after that the next caller has to fetch again.
+	 **/
+	bool ConsumePrefetchedCharacterList(bool& bOutSuccessful);
+
+	FORCEINLINE bool IsFetchingCharacterList() const { return CharacterListFetch == ECharacterListFetch::InFlight; }
+
+	FOnCharacterListFetched OnCharacterListFetched;
 
 	UFUNCTION(BlueprintCallable)
 	void LogoutAndReturnToMenu();
@@ -131,6 +194,28 @@ public:
 
 	void GotoInitialState();
 
+	/*
+	 *	Starts loading a map package in the background and keeps it in memory until the next map has loaded.
+	 *	Accepts short (L_Game) or long (/Game/Maps/Game/L_Game) names.
+	 **/
+	void PreloadMap(const FString& Map);
+
+	/*
+	 *	Starts loading the game map while the server to play on is looked up.
+	 *	The STATE_Playing transition is timed from here, its map load and backend times include the preload and the lookup.
+	 **/
+	void PrepareToPlay();
+
+	/*
+	 *	Finishes STATE_Playing once the server to travel to is known
+	 **/
+	void TravelToServer(const FString& ServerAddress);
+
+	UFUNCTION(BlueprintPure, Category = "State Machine")
+	const FStateTransitionTimings& GetLastTransitionTimings() const { return LastTransitionTimings; }
+
+	static FString GetGameMap();
+
 public:
 
 	/*
@@ -161,14 +246,44 @@ protected:
 	
 	void BeginLoginState();
 	void BeginCharacterSelectState();
+	void BeginPlayingState();
 	
 	void EndLoginScreenState();
 	void EndCharacterSelectState();
 
+	/*
+	 *	A transition travels once its map is preloaded and the backend work it depends on has answered
+	 **/
+	void BeginTransition(FName State, const FString& Map, const FString& TravelURL, bool bBackendReady);
+	void NotifyTransitionBackendReady();
+	void TryCommitTransition();
+	void CommitTransition();
+
+	void OnMapPreloaded(const FName& PackageName, UPackage* LoadedPackage, EAsyncLoadingResult::Type Result);
+	void OnPostLoadMap(UWorld* LoadedWorld);
+	void OnTransitionCharacterListFetched(bool bSuccessful);
+
+	/*
+	 *	Asks syncCharacters for the changes since the cached revision, falls back to FetchFullCharacterList when that fails
+	 **/
+	void SyncCharacterList();
+	void FetchFullCharacterList();
+	void FinishCharacterListFetch(bool bSuccessful);
+
+	bool IsMapPreloaded(FName PackageName) const;
+	static FName GetMapPackageName(const FString& Map);
+
 private:
 
-	UPROPERTY(Transient)
-	TArray<FCharacterData> CharacterList;
+	FCharacterStore Characters;
+
+	ECharacterListFetch CharacterListFetch = ECharacterListFetch::Idle;
+
+	/*
+	 *	Set unless [CharacterSync] bEnabled is set, or once syncCharacters got any response but a valid delta.
+	 *	Only getAllCharacters is used after that.
+	 **/
+	bool bCharacterSyncUnavailable = false;
 
 	UPROPERTY()
 	FLoginResponse LoginToken;
@@ -183,5 +298,34 @@ private:
 	
 	UPROPERTY(Transient)
 	FName PendingState;
-	
+
+	struct FPendingTransition
+	{
+		FName State;
+		FName MapPackage;
+		FString TravelURL;
+		double StartTime = 0.0;
+		double MapReadyTime = 0.0;
+		double BackendReadyTime = 0.0;
+
+		FORCEINLINE bool IsActive() const { return !State.IsNone(); }
+	};
+
+	FPendingTransition Transition;
+
+	/*
+	 *	Set by PrepareToPlay, the next STATE_Playing transition starts at StartTime with the preload's MapReadyTime
+	 **/
+	FPendingTransition PreparedPlay;
+
+	UPROPERTY(Transient)
+	FStateTransitionTimings LastTransitionTimings;
+
+	/*
+	 *	Referenced so the preloaded maps survive garbage collection until the travel picks them up
+	 **/
+	UPROPERTY(Transient)
+	TArray<UPackage*> PreloadedMaps;
+
+	TSet<FName> PendingMapLoads;
 };
@@ -29,8 +29,50 @@
 
 #include "MGameState.generated.h"
 
+/*
+ *	Clients take the server world time from the local controller's clock sync once it has an estimate.
+ *	Clock sync measures the offset between the client's and the server's real time clocks, ServerRealTimeEpoch maps
+ *	the server's real time onto its world time. Both are doubles so the estimate keeps its precision on long running
+ *	servers, where a float world time is only good to a few milliseconds.
+ *	The stock replicated world time is only a fallback until then, so it is sent rarely.
+ **/
 UCLASS()
 class AMGameState : public AGameState
 {
 	GENERATED_BODY()
+
+public:
+
+	AMGameState();
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	virtual float GetServerWorldTimeSeconds() const override;
+
+	/*
+	 *	Server world time at the start of this frame without the float rounding of GetServerWorldTimeSeconds
+	 **/
+	double GetPreciseServerWorldTimeSeconds() const;
+
+protected:
+
+	virtual void BeginPlay() override;
+	virtual void UpdateServerTimeSeconds() override;
+
+	/*
+	 *	Server FPlatformTime::Seconds() at which its world time was zero.
+	 *	Moves when the server's world time falls behind real time, e.g. on hitches longer than the max tick delta.
+	 **/
+	UPROPERTY(Replicated)
+	double ServerRealTimeEpoch = 0.0;
+
+	/*
+	 *	Seconds the server's world time may drift from ServerRealTimeEpoch before a new epoch is replicated
+	 **/
+	UPROPERTY(EditDefaultsOnly, Category = "Clock Sync")
+	float EpochDriftThreshold;
+
+private:
+
+	void UpdateServerRealTimeEpoch();
 };
\ No newline at end of file
@@ -0,0 +1,167 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+
+#include "MReplicationGraph.generated.h"
+
+enum class EClassRepNodeMapping : uint8
+{
+	/*
+	 *	Not added to any global node, replicated through a per connection node or not at all
+	 **/
+	NotRouted,
+
+	RelevantAllConnections,
+
+	/*
+	 *	Never moves, added to the grid once
+	 **/
+	Spatialize_Static,
+
+	/*
+	 *	Moves, re-bucketed in the grid every frame
+	 **/
+	Spatialize_Dynamic,
+};
+
+USTRUCT(BlueprintType)
+struct FReplicationGraphStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Connections = 0;
+
+	/*
+	 *	Average ServerReplicateActors time in milliseconds while the server had up to 50, 100, 200 and more connections
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	TArray<float> AverageMsByConnections;
+
+	UPROPERTY(BlueprintReadOnly)
+	TArray<int32> FramesByConnections;
+};
+
+/*
+ *	Replication graph for large shards.
+ *	Characters are bucketed into a 2D grid so each connection only considers nearby cells, every connection always gets
+ *	its own controller and player state, and the player states of everyone else are trickled out a few per frame since
+ *	they only carry the public character profile.
+ *	Enabled through ReplicationDriverClassName in DefaultEngine.ini.
+ **/
+UCLASS(Transient, Config = Engine)
+class MULTIPLAYEREXAMPLE_API UMReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+
+	UMReplicationGraph();
+
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual int32 ServerReplicateActors(float DeltaSeconds) override;
+
+	/*
+	 *	The graph reads NetUpdateFrequency once per class, call this when an actor's frequency changes at runtime
+	 **/
+	void SetActorUpdateFrequency(AActor* Actor, float Frequency);
+
+	const FReplicationGraphStats& GetStats() const { return Stats; }
+	void ResetStats();
+	void DumpStats() const;
+
+	/*
+	 *	Index into the stats arrays for a connection count
+	 **/
+	static int32 GetConnectionBucket(int32 Connections);
+
+	UPROPERTY(Config)
+	float GridCellSize;
+
+	/*
+	 *	Lowest world X and Y the grid covers, actors below it are clamped into the edge cells
+	 **/
+	UPROPERTY(Config)
+	float SpatialBiasX;
+
+	UPROPERTY(Config)
+	float SpatialBiasY;
+
+	/*
+	 *	Other players' player states sent to each connection per frame
+	 **/
+	UPROPERTY(Config)
+	int32 PlayerStatesPerFrame;
+
+	UPROPERTY()
+	UReplicationGraphNode_GridSpatialization2D* GridNode;
+
+	UPROPERTY()
+	UReplicationGraphNode_ActorList* AlwaysRelevantNode;
+
+	UPROPERTY()
+	UReplicationGraphNode_PlayerStateFrequencyLimiter* PlayerStateNode;
+
+private:
+
+	EClassRepNodeMapping GetMappingPolicy(const UClass* Class) const;
+
+	/*
+	 *	Policy for the class, mapped and cached on first use when it was not known at init
+	 **/
+	EClassRepNodeMapping GetClassNodeMapping(UClass* Class);
+
+	TClassMap<EClassRepNodeMapping> ClassRepNodePolicies;
+
+	FReplicationGraphStats Stats;
+};
+
+/*
+ *	Adds the connections own player controller and player state, regardless of any other relevancy
+ **/
+UCLASS()
+class MULTIPLAYEREXAMPLE_API UMReplicationGraphNode_AlwaysRelevant_ForConnection : public UReplicationGraphNode
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void NotifyAddNetworkActor(const FNewReplicatedActorInfo& Actor) override {}
+	virtual bool NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound = true) override { return false; }
+	virtual void NotifyResetAllNetworkActors() override {}
+
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+
+private:
+
+	FActorRepListRefView ReplicationActorList;
+};
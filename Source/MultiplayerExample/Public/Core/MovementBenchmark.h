@@ -0,0 +1,161 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+
+class ACharacter;
+
+struct FMovementBenchmarkParams
+{
+	int32 Characters = 500;
+
+	/*
+	 *	Frames measured after the warmup, spawning and the first LOD update fall into the warmup
+	 **/
+	int32 Frames = 600;
+	int32 WarmupFrames = 60;
+
+	/*
+	 *	Seeds every character's input pattern, the same seed and count replay the same inputs frame for frame
+	 **/
+	int32 Seed = 1;
+
+	/*
+	 *	Movement LOD forced on every character, INDEX_NONE leaves it to FCharacterSignificance
+	 **/
+	int32 ForcedLOD = INDEX_NONE;
+};
+
+/*
+ *	Seeded synthetic input for one bot: idle, forward, strafe or diagonal with the occasional jump, changing every
+ *	30 to 120 frames. Changes are keyed on frame numbers so the same seed and index replay the same input.
+ *	Shared by the movement benchmark and the compact move comparisons.
+ **/
+struct MULTIPLAYEREXAMPLE_API FMovementBotInput
+{
+	FMovementBotInput() {}
+	FMovementBotInput(const int32 Seed, const int32 Index) : Stream(Seed * 7919 + Index) {}
+
+	/*
+	 *	Picks a new pattern when the current one has run out, call once per frame before reading Input or bJump
+	 **/
+	void Advance(int32 Frame);
+
+	/*
+	 *	Advances and feeds the input to the character, the jump is consumed
+	 **/
+	void Apply(ACharacter* Character, int32 Frame);
+
+	FRandomStream Stream;
+	FVector Input = FVector::ZeroVector;
+	bool bJump = false;
+	int32 NextChangeFrame = 0;
+};
+
+/*
+ *	Summary of a finished run, the per frame samples only go to the CSV
+ **/
+struct FMovementBenchmarkResult
+{
+	int32 Characters = 0;
+	int32 Frames = 0;
+
+	float GameThreadAvgMs = 0.f;
+	float GameThreadP50Ms = 0.f;
+	float GameThreadP95Ms = 0.f;
+	float GameThreadP99Ms = 0.f;
+
+	float MovementAvgMs = 0.f;
+	float MovementP95Ms = 0.f;
+	float MovementUsPerCharacter = 0.f;
+
+	float SpawnMs = 0.f;
+	float SpawnKBPerCharacter = 0.f;
+};
+
+/*
+ *	Spawns AI possessed characters around the first player start and drives them with seeded synthetic input,
+ *	recording game thread time, movement component time and memory for every frame.
+ *	Results are logged and written to Saved/Benchmarks as CSV. Run on a dedicated server with fixed time steps for
+ *	comparable numbers, e.g. -nullrhi -benchmark -fps=30, then MP.Bench.Movement.
+ *	The MultiplayerExample.Benchmark.Movement automation test sweeps the character count with a fixed seed.
+ **/
+class MULTIPLAYEREXAMPLE_API FMovementBenchmark : public TSharedFromThis<FMovementBenchmark>
+{
+public:
+
+	DECLARE_DELEGATE_OneParam(FOnFinished, const FMovementBenchmarkResult&);
+
+	/*
+	 *	OnFinished is called once the last frame is recorded, not if the world goes away first
+	 **/
+	static bool Start(UWorld* World, const FMovementBenchmarkParams& Params, const FOnFinished& OnFinished = FOnFinished());
+	static bool IsRunning() { return Running.IsValid(); }
+
+	~FMovementBenchmark();
+
+private:
+
+	struct FBot
+	{
+		TWeakObjectPtr<ACharacter> Character;
+		FMovementBotInput Input;
+	};
+
+	struct FFrameSample
+	{
+		float GameThreadMs = 0.f;
+		float MovementMs = 0.f;
+		int32 Characters = 0;
+		uint64 UsedPhysical = 0;
+	};
+
+	FMovementBenchmark(UWorld* InWorld, const FMovementBenchmarkParams& InParams);
+
+	bool Spawn();
+	bool Tick(float DeltaTime);
+	void DriveInput();
+	void Finish();
+	FMovementBenchmarkResult Summarize() const;
+	void WriteResults(const FMovementBenchmarkResult& Result) const;
+
+	static TSharedPtr<FMovementBenchmark> Running;
+
+	TWeakObjectPtr<UWorld> World;
+	FMovementBenchmarkParams Params;
+	FOnFinished OnFinished;
+
+	TArray<FBot> Bots;
+	TArray<FFrameSample> Samples;
+
+	int32 Frame = 0;
+	uint64 UsedPhysicalBeforeSpawn = 0;
+	uint64 UsedPhysicalAfterSpawn = 0;
+	double SpawnSeconds = 0.0;
+
+	FDelegateHandle TickHandle;
+};
@@ -0,0 +1,198 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "NetFrequencyController.generated.h"
+
+class APawn;
+
+USTRUCT(BlueprintType)
+struct FNetFrequencySettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditDefaultsOnly)
+	float UpdateInterval = 0.5f;
+
+	/*
+	 *	A character stays active this long after it last moved, a player state after its profile or inventory last changed
+	 **/
+	UPROPERTY(EditDefaultsOnly)
+	float ActiveSeconds = 3.f;
+
+	UPROPERTY(EditDefaultsOnly)
+	float MinSpeed = 10.f;
+
+	UPROPERTY(EditDefaultsOnly)
+	float CharacterMinFrequency = 2.f;
+
+	UPROPERTY(EditDefaultsOnly)
+	float CharacterMaxFrequency = 30.f;
+
+	UPROPERTY(EditDefaultsOnly)
+	float PlayerStateMinFrequency = 1.f;
+
+	UPROPERTY(EditDefaultsOnly)
+	float PlayerStateMaxFrequency = 10.f;
+
+	/*
+	 *	Past this many observers an active character is sent proportionally less often
+	 **/
+	UPROPERTY(EditDefaultsOnly)
+	int32 CrowdSize = 20;
+
+	/*
+	 *	Estimated bytes per second each connection may receive for characters and player states.
+	 *	Connections over it have the frequencies of everything they see scaled down to fit, never below the minimums.
+	 **/
+	UPROPERTY(EditDefaultsOnly)
+	int32 BudgetBytesPerSecond = 12000;
+
+	UPROPERTY(EditDefaultsOnly)
+	int32 CharacterBytesPerUpdate = 40;
+
+	UPROPERTY(EditDefaultsOnly)
+	int32 PlayerStateBytesPerUpdate = 12;
+};
+
+UENUM(BlueprintType)
+enum class ENetFrequencyReason : uint8
+{
+	Active,
+	Idle,
+	Unobserved,
+	Crowded,
+	Budget,
+};
+
+USTRUCT(BlueprintType)
+struct FNetFrequencyDecision
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	TWeakObjectPtr<AActor> Actor;
+
+	UPROPERTY(BlueprintReadOnly)
+	float Frequency = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Observers = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	ENetFrequencyReason Reason = ENetFrequencyReason::Idle;
+};
+
+USTRUCT(BlueprintType)
+struct FNetFrequencyStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Characters = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 ActiveCharacters = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 CrowdedCharacters = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 PlayerStates = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 ActivePlayerStates = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	float AverageCharacterFrequency = 0.f;
+
+	/*
+	 *	Connections whose estimate was over the budget in the last update
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	int32 ThrottledConnections = 0;
+
+	/*
+	 *	Highest per connection estimate before and after throttling, in bytes per second
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	float MaxDesiredBytesPerSecond = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float MaxBytesPerSecond = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float UpdateMs = 0.f;
+
+	/*
+	 *	Frequency changes pushed to actors since startup
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	int32 Changes = 0;
+};
+
+/*
+ *	Sets NetUpdateFrequency of player characters and player states from what they are doing.
+ *	Characters that moved recently and have someone nearby to see them get the maximum frequency, idle or unobserved ones
+ *	the minimum, and characters in a crowd are scaled down by their observer count. Observers are found through a coarse
+ *	grid of pawn positions with cells the size of the characters net cull distance. The per connection byte estimate of
+ *	everything it sees is then held under the budget by scaling frequencies down further.
+ *	Changes are also pushed to the replication graph, which otherwise only reads the class default frequency.
+ *	Owned and ticked by AMultiplayerExampleGameMode.
+ **/
+class MULTIPLAYEREXAMPLE_API FNetFrequencyController
+{
+public:
+
+	FNetFrequencySettings Settings;
+
+	void Initialize(UWorld* InWorld);
+	void Tick(double Now);
+
+	const FNetFrequencyStats& GetStats() const { return Stats; }
+	const TArray<FNetFrequencyDecision>& GetDecisions() const { return Decisions; }
+	void DumpStats() const;
+
+private:
+
+	struct FActorActivity
+	{
+		FVector LastLocation = FVector::ZeroVector;
+		double LastActiveTime = 0.0;
+	};
+
+	void Update(double Now);
+	void ApplyFrequency(AActor* Actor, float Frequency);
+
+	TWeakObjectPtr<UWorld> World;
+	TMap<TWeakObjectPtr<APawn>, FActorActivity> PawnActivity;
+
+	double LastUpdateTime = 0.0;
+
+	TArray<FNetFrequencyDecision> Decisions;
+	FNetFrequencyStats Stats;
+};
@@ -0,0 +1,213 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Interfaces/IHttpRequest.h"
+
+#include "ServerDirectory.generated.h"
+
+class UHttpAPI;
+
+USTRUCT(BlueprintType)
+struct FServerProbeResult
+{
+	GENERATED_BODY()
+
+	FServerProbeResult()
+	{
+		Address = "";
+		RoundTripMs = -1.f;
+		Players = 0;
+		MaxPlayers = 0;
+		bReachable = false;
+		bIdle = false;
+	}
+
+	explicit FServerProbeResult(const FString& InAddress)
+		: FServerProbeResult()
+	{
+		Address = InAddress;
+	}
+
+	FORCEINLINE bool IsFull() const { return MaxPlayers > 0 && Players >= MaxPlayers; }
+	FORCEINLINE float GetLoad() const { return MaxPlayers > 0 ? static_cast<float>(Players) / MaxPlayers : 0.f; }
+
+	/*
+	 *	Travel address of the server, host:port
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	FString Address;
+
+	UPROPERTY(BlueprintReadOnly)
+	float RoundTripMs;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Players;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 MaxPlayers;
+
+	UPROPERTY(BlueprintReadOnly)
+	bool bReachable;
+
+	/*
+	 *	The server was ticking at its idle rate when first probed and was probed again once awake
+	 **/
+	UPROPERTY(BlueprintReadOnly)
+	bool bIdle;
+};
+
+/*
+ *	Shape of the json served by the dedicated server status endpoint, see AMultiplayerExampleGameMode::StartStatusEndpoint
+ **/
+USTRUCT()
+struct FServerStatusResponse
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 Players = 0;
+
+	UPROPERTY()
+	int32 MaxPlayers = 0;
+
+	/*
+	 *	Tick governor state and CPU usage for capacity planning, see UMGameEngine
+	 **/
+	UPROPERTY()
+	bool bIdle = false;
+
+	UPROPERTY()
+	float TickRate = 0.f;
+
+	UPROPERTY()
+	float IdleCpuPercent = 0.f;
+
+	UPROPERTY()
+	float ActiveCpuPercent = 0.f;
+
+	/*
+	 *	Longest the request may have waited for an idle server's next tick, not part of the network round trip.
+	 *	The request wakes the server to full rate for a few seconds, so an immediate second probe measures the network alone.
+	 **/
+	UPROPERTY()
+	float IdleWaitMs = 0.f;
+};
+
+DECLARE_DELEGATE_OneParam(FOnServerSelected, const FServerProbeResult&);
+
+/*
+ *	Client side directory of game servers read from the [ServerDirectory] section of DefaultGame.ini
+ *	Every server is probed in parallel for its round trip time and player count, the best one is picked from the results.
+ *	Idle servers answer their first probe after up to a full idle tick, they are probed a second time once awake.
+ *	Results are cached for the rest of the session, call InvalidateProbeResults to force a new probe.
+ **/
+UCLASS()
+class MULTIPLAYEREXAMPLE_API UServerDirectory : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/*
+	 *	Calls back with the best server. Probes every server first unless results are already cached.
+	 *	If no server could be reached the first entry in the directory is returned.
+	 **/
+	void SelectBestServer(const FOnServerSelected& OnSelected);
+
+	UFUNCTION(BlueprintCallable, Category = "Server Directory")
+	void InvalidateProbeResults();
+
+	UFUNCTION(BlueprintPure, Category = "Server Directory")
+	const TArray<FServerProbeResult>& GetProbeResults() const { return ProbeResults; }
+
+	UFUNCTION(BlueprintPure, Category = "Server Directory")
+	bool HasServers() const { return ServerAddresses.Num() > 0; }
+
+	/*
+	 *	Builds the URL of the status endpoint for a travel address, the status port is the game port + StatusPortOffset
+	 **/
+	static FString GetStatusURL(const FString& Address, int32 PortOffset);
+
+	static constexpr int32 DefaultGamePort = 7777;
+	static constexpr int32 DefaultStatusPortOffset = 10;
+
+protected:
+
+	void ProbeServers();
+	void SendProbe(UHttpAPI* API, uint32 Round, int32 Index);
+	void OnProbeResponse(uint32 Round, int32 Index, URequest* Request, FHttpResponsePtr Response);
+	void FinishProbe();
+
+	/*
+	 *	Cancels every probe of the current round that has not answered yet
+	 **/
+	void CancelPendingProbes();
+
+	const FServerProbeResult* PickBestServer() const;
+
+private:
+
+	UPROPERTY()
+	TArray<FString> ServerAddresses;
+
+	UPROPERTY(Transient)
+	TArray<FServerProbeResult> ProbeResults;
+
+	/*
+	 *	Milliseconds added to a servers score when it is completely full, scaled linearly by its load
+	 **/
+	UPROPERTY()
+	float LoadPenaltyMs = 100.f;
+
+	UPROPERTY()
+	float ProbeTimeout = 2.f;
+
+	UPROPERTY()
+	int32 StatusPortOffset = DefaultStatusPortOffset;
+
+	int32 PendingProbes = 0;
+
+	/*
+	 *	Bumped every time a round starts or is abandoned, responses from an older round are dropped
+	 **/
+	uint32 ProbeRound = 0;
+
+	UPROPERTY(Transient)
+	TArray<URequest*> PendingProbeRequests;
+
+	bool bProbeInFlight = false;
+	bool bHasProbed = false;
+
+	TArray<FOnServerSelected> PendingSelections;
+
+	FTimerHandle ProbeTimeout_TimerHandle;
+};
@@ -0,0 +1,137 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
+
+class AActor;
+class AController;
+class UWorld;
+
+/*
+ *	Hands out player starts for initial spawns without collision checks.
+ *	Every player start holds one reservation. A start is reserved for the controller it was allocated to until that
+ *	player's pawn has stepped off it, the controller is gone, or ReservationTimeout seconds have passed, so concurrent
+ *	joins land on different starts instead of being pushed out of each other.
+ *	Free starts are handed out from a FIFO ring, the start freed longest ago first. Starts are bucketed into a grid of
+ *	CellSize and the ring starts out alternating between cells, so a burst of joins spreads over the map.
+ *	Reserved starts are checked for release a few per Tick, so Allocate is O(1) and never scans the starts.
+ *	Owned by AMultiplayerExampleGameMode.
+ **/
+class MULTIPLAYEREXAMPLE_API FSpawnPointAllocator
+{
+public:
+
+	/*
+	 *	Indexes every player start in the world, call again if starts are added or removed at runtime
+	 **/
+	void Initialize(UWorld* World);
+	void Initialize(const TArray<AActor*>& PlayerStarts);
+
+	/*
+	 *	Reserves the free player start that was released longest ago for Controller.
+	 *	Returns null when every start is reserved or there are none.
+	 **/
+	AActor* Allocate(AController* Controller);
+
+	/*
+	 *	Frees the start reserved for Controller, used when its spawn failed or the player left
+	 **/
+	void Release(AController* Controller);
+
+	/*
+	 *	Releases up to ReleaseChecksPerTick reserved starts whose player has stepped off, left or timed out.
+	 *	Now is in real time seconds.
+	 **/
+	void Tick(double Now);
+
+	bool IsEmpty() const { return Starts.Num() == 0; }
+	bool HasFreeStart() const { return FreeCount > 0; }
+	bool HasReservation(AController* Controller) const { return StartOfController.Contains(Controller); }
+
+	/*
+	 *	True when Controller holds a start nobody can still be standing on, its spawn can skip the overlap fix-up
+	 **/
+	bool IsReservedStartClear(AController* Controller) const;
+
+	int32 GetNumReserved() const { return ReservedStarts.Num(); }
+	void DumpStats() const;
+
+	float CellSize = 200.f;
+	int32 ReleaseChecksPerTick = 8;
+
+	/*
+	 *	Seconds a start stays reserved at most, pending spawns and players idling on the start included
+	 **/
+	float ReservationTimeout = 2.f;
+
+private:
+
+	struct FStart
+	{
+		TWeakObjectPtr<AActor> Actor;
+
+		TWeakObjectPtr<AController> Occupant;
+		TObjectKey<AController> OccupantKey;
+		double ReservedTime = 0.0;
+
+		/*
+		 *	False after a release by timeout, the previous player may still be standing on the start
+		 **/
+		bool bClear = true;
+	};
+
+	enum class EOccupancy : uint8
+	{
+		Pending,
+		OnStart,
+		Left,
+	};
+
+	EOccupancy GetOccupancy(const FStart& Start) const;
+	void FreeStart(int32 StartIndex, bool bClear);
+
+	TArray<FStart> Starts;
+
+	/*
+	 *	Ring of free start indices, FreeHead is the start that has been free the longest
+	 **/
+	TArray<int32> FreeRing;
+	int32 FreeHead = 0;
+	int32 FreeCount = 0;
+
+	TArray<int32> ReservedStarts;
+	int32 ReleaseCursor = 0;
+
+	TMap<TObjectKey<AController>, int32> StartOfController;
+
+	double LastTickTime = 0.0;
+
+	int32 Allocations = 0;
+	int32 Saturated = 0;
+	int32 Releases = 0;
+	int32 TimedOut = 0;
+};
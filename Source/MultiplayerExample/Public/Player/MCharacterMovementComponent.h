@@ -0,0 +1,156 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/CharacterMovementReplication.h"
+
+#include "MCharacterMovementComponent.generated.h"
+
+/*
+ *	Move data with compact acceleration and control rotation.
+ *	Horizontal acceleration is sent as a 10 bit direction and a 7 bit fraction of MaxAcceleration, control rotation as
+ *	12 bit yaw and 11 bit pitch. A leading bit says whether the sending client used the compact format.
+ **/
+class MULTIPLAYEREXAMPLE_API FMCharacterNetworkMoveData : public FCharacterNetworkMoveData
+{
+public:
+
+	virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType) override;
+};
+
+class MULTIPLAYEREXAMPLE_API FMCharacterNetworkMoveDataContainer : public FCharacterNetworkMoveDataContainer
+{
+public:
+
+	FMCharacterNetworkMoveDataContainer();
+
+private:
+
+	FMCharacterNetworkMoveData MoveData[3];
+};
+
+/*
+ *	Saved move that stores acceleration exactly as the server will decode it, so prediction matches the server, and
+ *	combines with the pending move across small changes in input direction
+ **/
+class MULTIPLAYEREXAMPLE_API FSavedMove_MCharacter : public FSavedMove_Character
+{
+	typedef FSavedMove_Character Super;
+
+public:
+
+	virtual void SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData) override;
+};
+
+class MULTIPLAYEREXAMPLE_API FNetworkPredictionData_Client_MCharacter : public FNetworkPredictionData_Client_Character
+{
+	typedef FNetworkPredictionData_Client_Character Super;
+
+public:
+
+	FNetworkPredictionData_Client_MCharacter(const UCharacterMovementComponent& ClientMovement) : Super(ClientMovement) {}
+
+	virtual FSavedMovePtr AllocateNewMove() override;
+};
+
+/*
+ *	Move RPCs a client sent and corrections it received, see UMCharacterMovementComponent::ConsumeSendStats
+ **/
+struct FMoveSendStats
+{
+	int32 Moves = 0;
+	int64 Bits = 0;
+	int32 Corrections = 0;
+};
+
+UCLASS()
+class MULTIPLAYEREXAMPLE_API UMCharacterMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UMCharacterMovementComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+	virtual void ServerMovePacked_ServerReceive(const FCharacterServerMovePackedBits& PackedBits) override;
+	virtual void ServerMovePacked_ClientSend(const FCharacterServerMovePackedBits& PackedBits) override;
+	virtual void OnClientCorrectionReceived(FNetworkPredictionData_Client_Character& ClientData, float TimeStamp, FVector NewLocation,
+	                                        FVector NewVelocity, UPrimitiveComponent* NewBase, FName NewBaseBoneName, bool bHasBase,
+	                                        bool bBaseRelativePosition, uint8 ServerMovementMode) override;
+
+	/*
+	 *	Total time spent in TickComponent of every movement component while collection is on, for benchmarks
+	 **/
+	static void SetCollectTickTime(bool bCollect);
+	static double ConsumeTickSeconds();
+
+	/*
+	 *	Whether this client sends compact moves, toggled with MP.Movement.CompactMoves to compare against the stock path
+	 **/
+	static bool UseCompactMoves();
+
+	/*
+	 *	Acceleration as it arrives on the server after compact serialization
+	 **/
+	static FVector QuantizeAcceleration(const FVector& Acceleration, float InMaxAcceleration);
+
+	/*
+	 *	Logs move RPCs received by this server since the last call, bits and processing time per RPC
+	 **/
+	static void DumpMoveStats(const UWorld* World);
+
+	/*
+	 *	Client side totals since the last call, used to compare compact and stock moves
+	 **/
+	static FMoveSendStats ConsumeSendStats();
+
+	/*
+	 *	Pending moves combine while the input direction changes by less than this many degrees
+	 **/
+	UPROPERTY(EditDefaultsOnly, Category = "Character Movement (Networking)")
+	float CombineAccelAngle;
+
+	/*
+	 *	Seconds between move RPCs while input has not changed since the last acknowledged move.
+	 *	Important moves such as jumps or mode changes are still sent right away.
+	 **/
+	UPROPERTY(EditDefaultsOnly, Category = "Character Movement (Networking)")
+	float SteadyInputSendDeltaTime;
+
+protected:
+
+	virtual float GetClientNetSendDeltaTime(const APlayerController* PC, const FNetworkPredictionData_Client_Character* ClientData, const FSavedMovePtr& NewMove) const override;
+
+private:
+
+	FMCharacterNetworkMoveDataContainer MoveDataContainer;
+
+	static bool bCollectTickTime;
+	static double TickSeconds;
+};
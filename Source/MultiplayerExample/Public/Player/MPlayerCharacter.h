@@ -25,9 +25,31 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Components/SkinnedMeshComponent.h"
 #include "GameFramework/Character.h"
 #include "MPlayerCharacter.generated.h"
 
+USTRUCT(BlueprintType)
+struct FMovementLOD
+{
+	GENERATED_BODY()
+
+	/*
+	 *	Used while the nearest other player is within this distance, past the last LOD's distance the last LOD is kept
+	 **/
+	UPROPERTY(EditDefaultsOnly)
+	float MaxDistance = 0.f;
+
+	UPROPERTY(EditDefaultsOnly)
+	float MovementTickInterval = 0.f;
+
+	UPROPERTY(EditDefaultsOnly)
+	float MeshTickInterval = 0.f;
+
+	UPROPERTY(EditDefaultsOnly)
+	EVisibilityBasedAnimTickOption AnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+};
+
 UCLASS(config=Game)
 class AMultiplayerExampleCharacter : public ACharacter
 {
@@ -41,7 +63,7 @@ class AMultiplayerExampleCharacter : public ACharacter
 
 public:
 	
-	AMultiplayerExampleCharacter();
+	AMultiplayerExampleCharacter(const FObjectInitializer& ObjectInitializer);
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=Camera)
 	float BaseTurnRate;
@@ -54,6 +76,16 @@ public:
 
 	virtual void SetPlayerDefaults() override;
 
+	/*
+	 *	Movement and mesh tick settings on a dedicated server by distance to the nearest other player, finest first.
+	 *	Picked through FCharacterSignificance.
+	 **/
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Movement LOD")
+	TArray<FMovementLOD> MovementLODs;
+
+	void SetMovementLOD(int32 LOD);
+	int32 GetMovementLOD() const { return MovementLOD; }
+
 protected:
 	
 	void MoveForward(float Value);
@@ -63,7 +95,12 @@ protected:
 
 	// APawn interface
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 	// End of APawn interface
+
+private:
+
+	int32 MovementLOD = 0;
 };
 
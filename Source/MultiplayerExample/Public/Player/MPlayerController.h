@@ -25,6 +25,7 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Core/ClockSync.h"
 #include "GameFramework/PlayerController.h"
 #include "Types/GlobalTypes.h"
 
@@ -37,6 +38,8 @@ class AMPlayerController : public APlayerController
 
 public:
 
+	AMPlayerController();
+
 	UFUNCTION(Client, Reliable)
 	void Client_OnConnectionComplete();
 
@@ -46,10 +49,52 @@ public:
 	UFUNCTION(Server, Reliable, WithValidation)
 	void Server_GetCharacter(const FString& CharacterID, const FString& BearerToken);
 
+	/*
+	 *	Fetches the character from the backend, called by the game mode once the admission pipeline has a free slot
+	 **/
+	void FetchCharacter(const FString& CharacterID, const FString& BearerToken);
+
+	/*
+	 *	Token the player authenticated with, used by the server for backend calls made on the players behalf.
+	 *	Only set on the server.
+	 **/
+	FORCEINLINE const FString& GetBackendToken() const { return BackendToken; }
+
+	/*
+	 *	Estimate of the server clock, only kept by the local controller on clients
+	 **/
+	const FClockSyncEstimator& GetClockSync() const { return ClockSync; }
+
+	UFUNCTION(BlueprintPure, Category = "Clock Sync")
+	const FClockSyncStats& GetClockSyncStats() const { return ClockSync.GetStats(); }
+
 protected:
 
+	virtual void BeginPlay() override;
 	virtual void OnRep_PlayerState() override;
 
+	/*
+	 *	Clock sync pings are a one byte sequence number, the server answers with it and its real time clock.
+	 *	Both ends stamp with FPlatformTime::Seconds() as doubles, frame quantized world time would add up to a frame of error.
+	 **/
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void Server_ClockSyncPing(uint8 Sequence);
+
+	UFUNCTION(Client, Unreliable)
+	void Client_ClockSyncPong(uint8 Sequence, double ServerTime);
+
+	/*
+	 *	Pings sent ClockSyncBurstInterval apart after joining to settle quickly, then one every ClockSyncInterval
+	 **/
+	UPROPERTY(EditDefaultsOnly, Category = "Clock Sync")
+	int32 ClockSyncBurstCount;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Clock Sync")
+	float ClockSyncBurstInterval;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Clock Sync")
+	float ClockSyncInterval;
+
 	UFUNCTION()
 	void OnGetCharacterCallback(const FCharacterData& CharacterData);
 
@@ -57,4 +102,29 @@ private:
 
 	UFUNCTION()
 	void PushInventoryToUserInterface(const TArray<FInventoryJson>& Inventory);
+
+	void SendClockSyncPing();
+
+	FString BackendCharacterID;
+	FString BackendToken;
+
+	struct FClockSyncPing
+	{
+		uint8 Sequence = 0;
+		bool bPending = false;
+		double SendTime = 0.0;
+	};
+
+	static constexpr int32 MaxPendingPings = 16;
+
+	FClockSyncEstimator ClockSync;
+	FClockSyncPing PendingPings[MaxPendingPings];
+	uint8 ClockSyncSequence = 0;
+	int32 ClockSyncPingsSent = 0;
+	FTimerHandle ClockSyncTimerHandle;
+
+	/*
+	 *	Server side, pings arriving faster than a burst are ignored
+	 **/
+	double LastClockSyncPingTime = 0.0;
 };
\ No newline at end of file
@@ -27,6 +27,7 @@
 #include "CoreMinimal.h"
 #include "GameFramework/PlayerState.h"
 #include "Types/GlobalTypes.h"
+#include "Types/InventoryArray.h"
 
 #include "MPlayerState.generated.h"
 
@@ -39,29 +40,93 @@ class AMPlayerState : public APlayerState
 
 public:
 
-	UFUNCTION(BlueprintAuthorityOnly, BlueprintImplementableEvent)
+	AMPlayerState();
+
+	/*
+	 *	Writes the character back to the backend, called by the autosave scheduler when the player state is dirty.
+	 *	Blueprint overrides should call the parent to keep the save.
+	 **/
+	UFUNCTION(BlueprintAuthorityOnly, BlueprintNativeEvent)
 	void SyncPlayerState();
 
 	UFUNCTION(BlueprintCallable, Server, WithValidation, Reliable)
 	void Server_AddInventoryItem();
 
+	/*
+	 *	Broadcast on the owning client with the whole inventory after each replicated update
+	 **/
 	FOnInventoryChanged OnInventoryChanged;
 
-	TArray<FInventoryJson> GetInventory() const { return Inventory; }
+	/*
+	 *	Per stack callbacks on the owning client, fired before OnInventoryChanged
+	 **/
+	FInventoryArray::FOnItem& OnInventoryItemAdded() { return Inventory.OnItemAdded; }
+	FInventoryArray::FOnItem& OnInventoryItemChanged() { return Inventory.OnItemChanged; }
+	FInventoryArray::FOnItem& OnInventoryItemRemoved() { return Inventory.OnItemRemoved; }
+
+	TArray<FInventoryJson> GetInventory() const { return Inventory.ToArray(); }
 
+	/*
+	 *	The inventory is moved into the replicated item stacks, the returned character data never has one.
+	 *	Use GetInventory or K2_GetCharacterData for the items.
+	 **/
 	void SetCharacterData(FCharacterData InData);
 	const FCharacterData& GetCharacterData() const { return CharacterData; }
 
+	/*
+	 *	The full character is only known to the server and the owning client, other clients only get the profile and
+	 *	see an empty inventory here
+	 **/
 	UFUNCTION(BlueprintPure, meta = (DisplayName="GetCharacterData"))
-	FCharacterData K2_GetCharacterData() const { return CharacterData; }
+	FCharacterData K2_GetCharacterData() const { return GetSaveData(); }
+
+	UFUNCTION(BlueprintPure)
+	const FCharacterProfile& GetProfile() const { return Profile; }
 
 	UFUNCTION()
-	void OnRep_CharacterData();
+	void OnRep_Profile();
+
+	/*
+	 *	Records an inventory change the backend has not applied, it is sent through updateInventory on the next
+	 *	persistence flush
+	 **/
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Persistence")
+	void MarkPersistenceDirty(const FInventoryJson& Item);
+
+	/*
+	 *	Takes a change the backend confirmed off the unsaved changes, true once nothing is left to save
+	 **/
+	bool ConfirmPersisted(const FInventoryJson& Item);
+
+	/*
+	 *	Changes the backend has not applied yet, one entry per item with the counts added up
+	 **/
+	const TArray<FInventoryJson>& GetUnsavedItems() const { return UnsavedItems; }
+
+	UFUNCTION(BlueprintPure, Category = "Persistence")
+	bool IsPersistenceDirty() const { return UnsavedItems.Num() > 0; }
+
+	/*
+	 *	Real time seconds when the player state last went from clean to dirty
+	 **/
+	double GetPersistenceDirtyTime() const { return PersistenceDirtyTime; }
+
+	/*
+	 *	Real time seconds when the profile or inventory last changed on the server
+	 **/
+	double GetLastReplicatedChangeTime() const { return LastReplicatedChangeTime; }
+
+	/*
+	 *	The character data with the current inventory, as it should be stored by the backend
+	 **/
+	FCharacterData GetSaveData() const;
 
 protected:
-	
-	UPROPERTY(ReplicatedUsing=OnRep_InventoryChanged)
-	TArray<FInventoryJson> Inventory;
+
+	virtual void PostInitializeComponents() override;
+
+	UPROPERTY(Replicated)
+	FInventoryArray Inventory;
 
 	UFUNCTION()
 	void OnRep_InventoryChanged();
@@ -69,9 +134,33 @@ protected:
 	UFUNCTION()
 	void OnUpdatedInventory(const TArray<FInventoryJson>& UpdatedInventory);
 
+	/*
+	 *	Profile and inventory are push model and the player state is dormant while idle, call after changing either
+	 **/
+	void WakeForReplication();
+
+	/*
+	 *	Seconds after the character is set before the player state goes dormant, 0 keeps it awake.
+	 *	While dormant the base player state properties such as ping only reach other clients along with a change.
+	 **/
+	UPROPERTY(EditDefaultsOnly, Category = "Replication")
+	float DormancyDelay;
+
 private:
 
-	UPROPERTY(ReplicatedUsing=OnRep_CharacterData)
+	UPROPERTY(ReplicatedUsing=OnRep_Profile)
+	FCharacterProfile Profile;
+
+	/*
+	 *	Authoritative on the server and rebuilt from the profile on clients, without the inventory
+	 **/
+	UPROPERTY()
 	FCharacterData CharacterData;
+
+	TArray<FInventoryJson> UnsavedItems;
+	double PersistenceDirtyTime = 0.0;
+	double LastReplicatedChangeTime = 0.0;
+
+	FTimerHandle DormancyTimerHandle;
 	
 };
\ No newline at end of file
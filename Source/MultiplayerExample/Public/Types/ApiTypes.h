@@ -41,6 +41,28 @@ struct FUpdateInventoryRequest
 	
 };
 
+/*
+ *	One journaled inventory change, replayed to the backend as an updateInventory request with token as the bearer.
+ *	Seq is unique within the journal and orders the changes of a character.
+ **/
+USTRUCT()
+struct FInventoryMutation
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int64 seq = 0;
+
+	UPROPERTY()
+	FString id;
+
+	UPROPERTY()
+	FString token;
+
+	UPROPERTY()
+	FInventoryJson item;
+};
+
 USTRUCT(BlueprintType)
 struct FDeleteCharacterRequest
 {
@@ -63,6 +85,44 @@ struct FGetCharacterRequest
 	FString id;
 };
 
+/*
+ *	Asks the backend for every character that changed since Revision. A revision of 0 requests the full list.
+ **/
+USTRUCT()
+struct FSyncCharactersRequest
+{
+	GENERATED_BODY()
+
+	FSyncCharactersRequest() {}
+	explicit FSyncCharactersRequest(const int64 InRevision)
+		: revision(InRevision) {}
+
+	UPROPERTY()
+	int64 revision = 0;
+};
+
+/*
+ *	The "data" field of the syncCharacters response.
+ *	When full is set, changed holds the whole list and anything not in it has to be dropped.
+ **/
+USTRUCT()
+struct FSyncCharactersResponse
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int64 revision = 0;
+
+	UPROPERTY()
+	bool full = true;
+
+	UPROPERTY()
+	TArray<FCharacterData> changed;
+
+	UPROPERTY()
+	TArray<FString> removed;
+};
+
 USTRUCT(BlueprintType)
 struct FLoginResponse
 {
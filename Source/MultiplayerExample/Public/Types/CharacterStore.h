@@ -0,0 +1,126 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/SparseArray.h"
+#include "Types/GlobalTypes.h"
+
+/*
+ *	Stable reference to a character in a FCharacterStore.
+ *	Stays valid while the character is in the store, even when other characters are added or removed.
+ **/
+struct FCharacterHandle
+{
+	FCharacterHandle() = default;
+	FCharacterHandle(const int32 InSlot, const uint32 InSerial) : Slot(InSlot), Serial(InSerial) {}
+
+	FORCEINLINE bool IsValid() const { return Slot != INDEX_NONE; }
+
+	bool operator==(const FCharacterHandle& Other) const { return Slot == Other.Slot && Serial == Other.Serial; }
+	bool operator!=(const FCharacterHandle& Other) const { return !(*this == Other); }
+
+private:
+
+	friend class FCharacterStore;
+
+	int32 Slot = INDEX_NONE;
+	uint32 Serial = 0;
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnCharacterAdded, const FCharacterData&);
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnCharacterUpdated, const FCharacterData&);
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnCharacterRemoved, const FString& /* CharacterID */);
+
+/*
+ *	Character list keyed by character ID.
+ *	Characters are kept densely in the order they were received so the list can be handed to widgets without a copy,
+ *	lookups by ID or handle are constant time.
+ **/
+class MULTIPLAYEREXAMPLE_API FCharacterStore
+{
+public:
+
+	/*
+	 *	Adds the character, or updates it in place if a character with the same ID is already stored
+	 **/
+	FCharacterHandle AddOrUpdate(const FCharacterData& Character);
+
+	bool Remove(const FString& CharacterID);
+
+	/*
+	 *	Makes the store match NewList, including its order. Only characters that were actually added, changed or removed fire a delegate.
+	 **/
+	void Assign(const TArray<FCharacterData>& NewList);
+
+	/*
+	 *	Merges a delta received from the backend and moves the store to NewRevision.
+	 *	A full delta replaces the list with Changed. A delta that is not newer than the stored revision is ignored, false
+	 *	when nothing was applied.
+	 **/
+	bool ApplyDelta(const TArray<FCharacterData>& Changed, const TArray<FString>& Removed, int64 NewRevision, bool bFull);
+
+	void Reset();
+
+	/*
+	 *	Backend revision the store was last synchronized to, 0 if it never was
+	 **/
+	FORCEINLINE int64 GetRevision() const { return Revision; }
+	FORCEINLINE void SetRevision(const int64 NewRevision) { Revision = NewRevision; }
+
+	const FCharacterData* Find(const FString& CharacterID) const;
+	const FCharacterData* Find(FCharacterHandle Handle) const;
+	FCharacterHandle FindHandle(const FString& CharacterID) const;
+
+	FORCEINLINE const TArray<FCharacterData>& GetAll() const { return Characters; }
+	FORCEINLINE TArrayView<const FCharacterData> View() const { return Characters; }
+	FORCEINLINE int32 Num() const { return Characters.Num(); }
+
+	FOnCharacterAdded OnCharacterAdded;
+	FOnCharacterUpdated OnCharacterUpdated;
+	FOnCharacterRemoved OnCharacterRemoved;
+
+private:
+
+	struct FSlot
+	{
+		int32 Index;
+		uint32 Serial;
+	};
+
+	TArray<FCharacterData> Characters;
+
+	/*
+	 *	Slot owning each entry in Characters, used to patch the slots when an entry moves
+	 **/
+	TArray<int32> SlotOfIndex;
+
+	TSparseArray<FSlot> Slots;
+	TMap<FString, int32> IdToSlot;
+
+	uint32 NextSerial = 1;
+
+	int64 Revision = 0;
+};
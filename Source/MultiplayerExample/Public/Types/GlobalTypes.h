@@ -25,6 +25,7 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
 #include "GlobalTypes.generated.h"
 
 USTRUCT(BlueprintType)
@@ -37,6 +38,9 @@ struct FInventoryJson
 
 	UPROPERTY(BlueprintReadOnly)
 	FString ItemId;
+
+	bool operator==(const FInventoryJson& Other) const { return ItemCount == Other.ItemCount && ItemId == Other.ItemId; }
+	bool operator!=(const FInventoryJson& Other) const { return !(*this == Other); }
 };
 
 USTRUCT(BlueprintType)
@@ -57,6 +61,13 @@ struct FCharacterData
 	FString ID;
 
 	bool IsValid() const { return !Name.IsEmpty() && !ID.IsEmpty(); }
+
+	bool operator==(const FCharacterData& Other) const
+	{
+		return ID == Other.ID && Name == Other.Name && Level == Other.Level && Inventory == Other.Inventory;
+	}
+
+	bool operator!=(const FCharacterData& Other) const { return !(*this == Other); }
 	
 	FString ToString() const
 	{
@@ -73,4 +84,65 @@ struct FCharacterData
 		Out += "Inventory: " + InventoryString;
 		return Out;
 	}
+};
+
+/*
+ *	The part of a character every client may see.
+ *	Replicated with a per connection baseline: each update starts with a mask of the fields that differ from what the
+ *	connection last acknowledged, so ID and Name go out once and later updates usually carry just the packed Level.
+ **/
+USTRUCT(BlueprintType)
+struct FCharacterProfile
+{
+	GENERATED_BODY()
+
+	FCharacterProfile() {}
+	explicit FCharacterProfile(const FCharacterData& Character)
+		: Name(Character.Name)
+		, Level(Character.Level)
+		, ID(Character.ID)
+	{}
+
+	UPROPERTY(BlueprintReadOnly)
+	FString Name;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Level = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	FString ID;
+
+	bool operator==(const FCharacterProfile& Other) const { return ID == Other.ID && Name == Other.Name && Level == Other.Level; }
+	bool operator!=(const FCharacterProfile& Other) const { return !(*this == Other); }
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms);
+
+	enum EField : uint8
+	{
+		Field_ID	= 1 << 0,
+		Field_Name	= 1 << 1,
+		Field_Level	= 1 << 2,
+		Field_All	= Field_ID | Field_Name | Field_Level,
+	};
+
+	static constexpr uint32 NumFieldBits = 3;
+
+	uint8 GetChangedFields(const FCharacterProfile& Baseline) const;
+
+	/*
+	 *	Reads or writes the fields in Fields, Level as a zigzag encoded variable length integer
+	 **/
+	void SerializeFields(FArchive& Ar, uint8 Fields);
+};
+
+template<>
+struct TStructOpsTypeTraits<FCharacterProfile> : public TStructOpsTypeTraitsBase2<FCharacterProfile>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithNetDeltaSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
 };
\ No newline at end of file
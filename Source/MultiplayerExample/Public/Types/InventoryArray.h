@@ -0,0 +1,119 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "Types/GlobalTypes.h"
+#include "Types/ItemRegistry.h"
+
+#include "InventoryArray.generated.h"
+
+struct FInventoryArray;
+
+/*
+ *	One inventory stack, identified by its item handle, or by its item id when the item is not in the registry
+ **/
+USTRUCT()
+struct FInventoryArrayEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	FInventoryArrayEntry() {}
+	FInventoryArrayEntry(const FItemHandle InItem, const FString& InUnregisteredId, const int32 InCount)
+		: Item(InItem), UnregisteredId(InUnregisteredId), Count(InCount) {}
+
+	UPROPERTY()
+	FItemHandle Item;
+
+	/*
+	 *	Only set when Item is invalid, so items the backend knows and this build does not still reach the owner
+	 **/
+	UPROPERTY()
+	FString UnregisteredId;
+
+	UPROPERTY()
+	int32 Count = 0;
+
+	const FString& GetItemId() const;
+
+	void PreReplicatedRemove(const FInventoryArray& InArraySerializer) const;
+	void PostReplicatedAdd(const FInventoryArray& InArraySerializer) const;
+	void PostReplicatedChange(const FInventoryArray& InArraySerializer) const;
+};
+
+/*
+ *	Inventory replicated as a fast array, only stacks that were added, changed or removed are sent.
+ *	The server changes it through Assign, clients get a callback per changed stack followed by OnReceived once the whole
+ *	update has been applied.
+ *	Stacks are keyed by FItemHandle, item ids missing from the registry replicate their id string instead.
+ **/
+USTRUCT()
+struct MULTIPLAYEREXAMPLE_API FInventoryArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	DECLARE_MULTICAST_DELEGATE_OneParam(FOnItem, const FInventoryArrayEntry&);
+
+	/*
+	 *	Makes the stacks match NewInventory and marks only the ones that differ dirty.
+	 *	Several stacks of the same item are added up into one.
+	 **/
+	void Assign(const TArray<FInventoryJson>& NewInventory);
+
+	/*
+	 *	Converts back to item id strings for the backend and the user interface
+	 **/
+	TArray<FInventoryJson> ToArray() const;
+
+	int32 GetCount(FItemHandle Item) const;
+	int32 Num() const { return Items.Num(); }
+
+	FOnItem OnItemAdded;
+	FOnItem OnItemChanged;
+	FOnItem OnItemRemoved;
+	FSimpleMulticastDelegate OnReceived;
+
+	void PostReplicatedReceive(const FPostReplicatedReceiveParameters& Parameters) const { OnReceived.Broadcast(); }
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FInventoryArrayEntry, FInventoryArray>(Items, DeltaParms, *this);
+	}
+
+private:
+
+	UPROPERTY()
+	TArray<FInventoryArrayEntry> Items;
+};
+
+template<>
+struct TStructOpsTypeTraits<FInventoryArray> : public TStructOpsTypeTraitsBase2<FInventoryArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
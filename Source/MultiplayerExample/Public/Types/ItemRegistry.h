@@ -0,0 +1,99 @@
+/**
+* MIT License
+*
+* Copyright (c) 2021 Chris
+* 
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+* 
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+* 
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+**/
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "ItemRegistry.generated.h"
+
+/*
+ *	Compact identifier of an item type, used instead of the item id string for inventory storage and replication.
+ *	Only valid for the registry it came from, the same config gives the same handles on server and clients.
+ **/
+USTRUCT(BlueprintType)
+struct MULTIPLAYEREXAMPLE_API FItemHandle
+{
+	GENERATED_BODY()
+
+	FItemHandle() {}
+	explicit FItemHandle(const uint16 InIndex) : Index(InIndex) {}
+
+	bool IsValid() const { return Index != 0; }
+
+	bool operator==(const FItemHandle& Other) const { return Index == Other.Index; }
+	bool operator!=(const FItemHandle& Other) const { return Index != Other.Index; }
+
+	friend uint32 GetTypeHash(const FItemHandle& Handle) { return Handle.Index; }
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+	{
+		Ar << Index;
+		bOutSuccess = true;
+		return true;
+	}
+
+	/*
+	 *	One based position in the registry, 0 is the invalid handle
+	 **/
+	UPROPERTY()
+	uint16 Index = 0;
+};
+
+template<>
+struct TStructOpsTypeTraits<FItemHandle> : public TStructOpsTypeTraitsBase2<FItemHandle>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
+
+/*
+ *	Maps the item id strings the backend uses to FItemHandles.
+ *	Items are read from the Items array of the [ItemRegistry] section in DefaultGame.ini once, in file order, so every
+ *	build with the same config agrees on the handles. Strings only come back out at the backend and UI boundaries.
+ **/
+class MULTIPLAYEREXAMPLE_API FItemRegistry
+{
+public:
+
+	static const FItemRegistry& Get();
+
+	/*
+	 *	Invalid handle for ids missing from the registry
+	 **/
+	FItemHandle FindHandle(const FString& ItemId) const;
+	const FString& GetItemId(FItemHandle Handle) const;
+
+	int32 Num() const { return ItemIds.Num(); }
+
+private:
+
+	FItemRegistry();
+
+	TArray<FString> ItemIds;
+	TMap<FString, FItemHandle> HandleOfId;
+};
@@ -26,6 +26,7 @@
 
 #include "CoreMinimal.h"
 #include "Blueprint/UserWidget.h"
+#include "Core/ServerDirectory.h"
 #include "Types/GlobalTypes.h"
 
 #include "CharacterSelectWidget.generated.h"
@@ -42,4 +43,8 @@ public:
 
 	UFUNCTION(BlueprintCallable)
 	void PlaySelectedCharacter(const FString& CharacterID, bool bForceLocal);
+
+protected:
+
+	void OnServerSelected(const FServerProbeResult& Server);
 };
\ No newline at end of file
@@ -10,5 +10,10 @@ public class MultiplayerExampleServerTarget : TargetRules
 		Type = TargetType.Server;
 		DefaultBuildSettings = BuildSettingsVersion.V2;
 		ExtraModuleNames.Add("MultiplayerExample");
+
+		// AMPlayerState marks its replicated properties dirty itself. Changing bWithPushModel needs its own engine build,
+		// so this target requires a source engine. Game and editor targets share the installed engine and run without it.
+		BuildEnvironment = TargetBuildEnvironment.Unique;
+		bWithPushModel = true;
 	}
 }